@@ -0,0 +1,448 @@
+/*
+    Microbenchmarks of the hashing, generation and lookup primitives of the password cracker, each next to its replacement
+    C++ Version: C++17
+
+    Compilation Instructions:
+        > Linux:   g++ -std=c++17 -O2 -pthread bench/microbench.cpp ./hashlib++_md5/hl_*.cpp -o microbench
+        (from the repository root; see the README for the one-line command that builds it together with the cracker)
+
+    Usage: ./microbench [filter]   (only runs the benchmarks whose name contains 'filter')
+
+    Description: every benchmark is calibrated to take about 10 ms per repetition, run once as a warm-up, then repeated; the table shows
+    the minimum, median, mean and standard deviation of the time per operation over the repetitions.
+*/
+
+//Native C libraries
+#include <cstdlib>      //EXIT_SUCCESS
+#include <cstdint>     //Counters
+#include <cstdio>     //std::remove
+
+//Native C++ Libraries
+#include <iostream>              //Result table
+#include <iomanip>              //Formatting the table
+#include <fstream>             //The old way of reading a dictionary
+#include <string>             //Candidates, hex hashes
+#include <string_view>       //Filter
+#include <vector>           //Samples, candidate sets
+#include <unordered_map>   //passwd_hashmap
+#include <optional>       //passwd_hashmap values
+#include <chrono>        //Timing
+#include <algorithm>    //std::sort
+#include <numeric>     //std::accumulate
+#include <cmath>      //std::sqrt
+#include <random>    //Synthetic data
+#include <functional>   //std::function
+
+//Native POSIX Libraries
+#include <unistd.h>     //mkstemp(), close()
+
+//External Libraries (dependencies)
+#include "../hashlib++_md5/hashlibpp.h"
+
+//Custom Libraries
+#include "../cracker/digest.hpp"
+#include "../cracker/md5_lanes.hpp"
+#include "../cracker/targets.hpp"
+#include "../cracker/dictionary.hpp"
+#include "../cracker/batch.hpp"
+#include "../cracker/brute_lanes.hpp"
+#include "../cracker/bloom.hpp"
+#include "../cracker/pool.hpp"
+#include "../permuter/permute.hpp"
+#include "../rules/rules.hpp"
+#include "../rainbow/rainbow.hpp"
+#include "../hashindex/hashindex.hpp"
+
+//Typedefs
+typedef std::unordered_map<std::string, std::optional<std::string>> passwd_hashmap;   //Same as main.cpp
+
+//Keep a value alive without the compiler seeing it used (stops it from deleting the measured code)
+template <typename T>
+inline void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//md5wrapper with its hex conversion made callable
+struct exposed_md5wrapper : md5wrapper
+{
+    using md5wrapper::convToString;
+};
+
+//Timing summary of one benchmark (nanoseconds per operation)
+struct summary
+{
+    double min, median, mean, stddev;
+};
+
+//Function prototypes
+summary measure(const std::function<void(std::uint64_t)>& body);    //Calibrate, warm up and repeat a benchmark body
+void report(const std::string& name, const summary& result);        //Print one row of the result table
+
+
+// DRIVER CODE //
+int main(int argc, char* argv[])
+{
+    const std::string_view filter = (argc > 1 ? argv[1] : "");
+    std::mt19937_64 random(42);
+
+    //Synthetic data: candidates, a target list and a dictionary file
+    std::vector<std::string> candidates(4096);
+    for(std::string& candidate : candidates)
+    {
+        candidate.resize(8);
+        for(char& c : candidate)
+            c = static_cast<char>('a' + random() % 26);
+    }
+
+    passwd_hashmap hashes;
+    cracker::TargetTable targets;
+    std::vector<cracker::digest> probes;    //Half targets, half misses
+
+    for(std::size_t i=0; i < 1000; ++i)
+    {
+        cracker::digest d = cracker::md5(candidates[i]);
+        hashes.insert({cracker::to_hex(d), std::nullopt});
+        targets.insert(d, cracker::to_hex(d));
+        probes.push_back(d);
+        probes.push_back(cracker::md5(candidates[i + 1000]));
+    }
+    targets.build_filter();
+
+    char dictionary_name[] = "/tmp/microbench-dict-XXXXXX";
+    ::close(::mkstemp(dictionary_name));
+    {
+        std::ofstream dictionary(dictionary_name);
+        for(std::size_t i=0; i < 100000; ++i)
+            dictionary << candidates[i % candidates.size()] << i << '\n';
+    }
+
+    //Benchmarks: name + body(iterations)
+    std::vector<std::pair<std::string, std::function<void(std::uint64_t)>>> benchmarks;
+
+    unsigned char block[64] = {};
+    benchmarks.push_back({"MD5Update (one 64-byte block = one MD5Transform)", [&](std::uint64_t n)
+    {
+        MD5 md5;
+        HL_MD5_CTX ctx;
+        md5.MD5Init(&ctx);
+        for(std::uint64_t i=0; i < n; ++i)
+            md5.MD5Update(&ctx, block, 64);
+        keep(ctx);
+    }});
+
+    benchmarks.push_back({"MD5Init+MD5Update+MD5Final (8 bytes, cracker::md5)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(cracker::md5(candidates[i & 4095]));
+    }});
+
+    benchmarks.push_back({"md5_short (8 bytes, scalar single block)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(cracker::md5_short(candidates[i & 4095].data(), 8));
+    }});
+
+    benchmarks.push_back({"md5_compress<vec<4>> (per candidate)", [&](std::uint64_t n)
+    {
+        cracker::SoaBlock<4> soa{};
+        cracker::vec<4> out[4];
+        for(std::uint64_t i=0; i < n; i += 4)
+        {
+            soa.w[0] += 1;
+            cracker::md5_compress(soa.w, out);
+            keep(out);
+        }
+    }});
+
+    benchmarks.push_back({"md5_compress<vec<8>> (per candidate)", [&](std::uint64_t n)
+    {
+        cracker::SoaBlock<8> soa{};
+        cracker::vec<8> out[4];
+        for(std::uint64_t i=0; i < n; i += 8)
+        {
+            soa.w[0] += 1;
+            cracker::md5_compress(soa.w, out);
+            keep(out);
+        }
+    }});
+
+    benchmarks.push_back({"md5_compress<vec<16>> (per candidate)", [&](std::uint64_t n)
+    {
+        cracker::SoaBlock<16> soa{};
+        cracker::vec<16> out[4];
+        for(std::uint64_t i=0; i < n; i += 16)
+        {
+            soa.w[0] += 1;
+            cracker::md5_compress(soa.w, out);
+            keep(out);
+        }
+    }});
+
+    exposed_md5wrapper wrapper;
+    benchmarks.push_back({"md5wrapper::convToString (16-byte digest to hex)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(wrapper.convToString(block));
+    }});
+
+    benchmarks.push_back({"cracker::to_hex (16-byte digest to hex)", [&](std::uint64_t n)
+    {
+        cracker::digest d{};
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            d[0] = static_cast<std::uint8_t>(i);
+            keep(cracker::to_hex(d));
+        }
+    }});
+
+    benchmarks.push_back({"md5wrapper::getHashFromString (8 bytes, hash + hex)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(wrapper.getHashFromString(candidates[i & 4095]));
+    }});
+
+    //gen_brute_str() was replaced by Keyspace: at() decodes an index like it did, increment() is what the loops use now
+    Permute::Keyspace keyspace(Permute::alphanum, 6);
+    benchmarks.push_back({"Keyspace::at (6 chars, index to candidate)", [&](std::uint64_t n)
+    {
+        char out[6];
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            keyspace.at(i * 7919 % keyspace.size(), out);
+            keep(out);
+        }
+    }});
+
+    benchmarks.push_back({"Keyspace::increment (6 chars, next candidate)", [&](std::uint64_t n)
+    {
+        char out[6];
+        keyspace.at(0, out);
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            keyspace.increment(out);
+            keep(out);
+        }
+    }});
+
+    benchmarks.push_back({"std::getline (dictionary line)", [&](std::uint64_t n)
+    {
+        std::ifstream dictionary(dictionary_name);
+        std::string line;
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            if (not std::getline(dictionary, line))
+            {
+                dictionary.clear();
+                dictionary.seekg(0);
+            }
+            keep(line);
+        }
+    }});
+
+    cracker::Dictionary mapped(dictionary_name);
+    benchmarks.push_back({"Dictionary::line (mmap, dictionary line)", [&](std::uint64_t n)
+    {
+        std::uint64_t offset = 0;
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            if (offset >= mapped.size())
+                offset = 0;
+
+            std::string_view line = mapped.line(offset);
+            offset += line.size() + 1;
+            keep(line);
+        }
+    }});
+
+    std::vector<std::string> hex_probes;
+    for(const cracker::digest& d : probes)
+        hex_probes.push_back(cracker::to_hex(d));
+
+    benchmarks.push_back({"passwd_hashmap::find (hex key, 1k targets, 50% hits)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(hashes.find(hex_probes[i % hex_probes.size()]) != hashes.end());
+    }});
+
+    benchmarks.push_back({"TargetTable::find (digest, 1k targets, 50% hits)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+            keep(targets.find(probes[i % probes.size()]));
+    }});
+
+    benchmarks.push_back({"TargetTable::maybe (prefilter, 1k targets, 50% hits)", [&](std::uint64_t n)
+    {
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            const cracker::digest& d = probes[i % probes.size()];
+            keep(targets.maybe(d[0] | (d[1] << 8) | (d[2] << 16) | (static_cast<std::uint32_t>(d[3]) << 24)));
+        }
+    }});
+
+    //The hot loops: candidates are hashed in SIMD batches (Batch) or generated and hashed in place (BruteLanes) instead of one
+    //gen_brute_str() + md5() per candidate
+    auto no_match = [](const std::string&, const cracker::digest&, const std::string&) {};
+
+    benchmarks.push_back({"Keyspace::at + md5_short (6 chars, gen_brute_str-style)", [&](std::uint64_t n)
+    {
+        char out[6];
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            keyspace.at(i % keyspace.size(), out);
+            keep(cracker::md5_short(out, 6));
+        }
+    }});
+
+    cracker::BruteLanes<cracker::simd_lanes> brute_lanes(keyspace);
+    benchmarks.push_back({"BruteLanes<simd_lanes>::run (6 chars, per candidate)", [&](std::uint64_t n)
+    {
+        std::uint64_t begin = 0;
+        while (n != 0)
+        {
+            const std::uint64_t end = std::min(keyspace.size(), begin + n);
+            n -= brute_lanes.run(begin, end, targets, no_match, []() { return false; }) - begin;
+            begin = 0;
+        }
+    }});
+
+    benchmarks.push_back({"Batch<simd_lanes>::add+flush (8 bytes, 1k targets)", [&](std::uint64_t n)
+    {
+        cracker::Batch<cracker::simd_lanes> batch;
+        for(std::uint64_t i=0; i < n; ++i)
+            batch.add(candidates[i & 4095], targets, no_match);
+        batch.flush(targets, no_match);
+    }});
+
+    cracker::Bloom bloom(64);
+    benchmarks.push_back({"Bloom::insert (8+ bytes, 64 MiB, '--dedup')", [&](std::uint64_t n)
+    {
+        std::string candidate;
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            candidate = candidates[i & 4095];
+            candidate += static_cast<char>('0' + (i >> 12) % 10);
+            keep(bloom.insert(candidate));
+        }
+    }});
+
+    rules::RuleSet rule_set;
+    rule_set.add("c");
+    rule_set.add("$1");
+    rule_set.add("sa@");
+    benchmarks.push_back({"Rule::apply (c, $1, sa@ on 8 bytes, per rule)", [&](std::uint64_t n)
+    {
+        std::string out;
+        for(std::uint64_t i=0; i < n; ++i)
+        {
+            keep(rule_set[i % rule_set.size()].apply(candidates[i & 4095], out));
+            keep(out);
+        }
+    }});
+
+    //Rainbow chains: one link (hash + reduce) of 'simd_lanes' chains at a time, and the lookups of a digest index
+    rainbow::Chains chains(std::vector<std::string>(6, Permute::lower), 6, 1000, 0, 1);
+    benchmarks.push_back({"rainbow::Chains::step<simd_lanes> (6 chars, per link)", [&](std::uint64_t n)
+    {
+        std::uint64_t index[cracker::simd_lanes], next[cracker::simd_lanes];
+        std::uint32_t columns[cracker::simd_lanes];
+
+        for(std::size_t lane=0; lane < cracker::simd_lanes; ++lane)
+        {
+            index[lane] = lane * 7919;
+            columns[lane] = static_cast<std::uint32_t>(lane);
+        }
+
+        for(std::uint64_t i=0; i < n; i += cracker::simd_lanes)
+        {
+            chains.step<cracker::simd_lanes>(index, columns, next);
+            std::copy_n(next, cracker::simd_lanes, index);
+        }
+        keep(index);
+    }});
+
+    char index_name[] = "/tmp/microbench-index-XXXXXX";
+    ::close(::mkstemp(index_name));
+    {
+        cracker::ThreadPool pool(1);
+        hashindex::build(index_name, dictionary_name, rules::RuleSet(), pool);
+    }
+
+    std::vector<cracker::digest> index_probes;    //Half words of the dictionary, half misses
+    for(std::size_t i=0; i < 2000; ++i)
+        index_probes.push_back(cracker::md5(candidates[i % candidates.size()] + std::to_string(i % 2 == 0 ? i : i + 100000)));
+
+    hashindex::Index digest_index(index_name);
+    benchmarks.push_back({"hashindex::Index::candidates (100k digests, 50% hits)", [&](std::uint64_t n)
+    {
+        std::uint64_t found = 0;
+        for(std::uint64_t i=0; i < n; ++i)
+            digest_index.candidates(index_probes[i % index_probes.size()], [&found](std::uint64_t, std::uint64_t) { ++found; });
+        keep(found);
+    }});
+
+    //Run the benchmarks
+    std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(12) << "min ns/op" << std::setw(12) << "median"
+              << std::setw(12) << "mean" << std::setw(12) << "stddev" << '\n'
+              << std::string(104, '=') << '\n';
+
+    for(const auto& [name, body] : benchmarks)
+        if (name.find(filter) != std::string::npos)
+            report(name, measure(body));
+
+    std::remove(dictionary_name);
+    std::remove(index_name);
+    return EXIT_SUCCESS;
+}
+
+
+
+
+  // =============================================== //
+ // *********** FUNTION IMPLEMENTATIONS **********  //
+// =============================================== //
+
+//Calibrate the number of iterations to about 10 ms, run it once as a warm-up, then time 'repetitions' runs
+summary measure(const std::function<void(std::uint64_t)>& body)
+{
+    constexpr int repetitions = 15;
+    constexpr double target_seconds = 0.01;
+
+    auto time = [&body](std::uint64_t iterations)
+                {
+                    auto begin = std::chrono::steady_clock::now();
+                    body(iterations);
+                    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                };
+
+    //Calibration: double the iterations until a run takes long enough to time reliably
+    std::uint64_t iterations = 16;
+    while (time(iterations) < target_seconds / 4)
+        iterations *= 2;
+
+    iterations *= 4;
+    time(iterations);   //Warm-up
+
+    std::vector<double> samples;
+    for(int i=0; i < repetitions; ++i)
+        samples.push_back(time(iterations) * 1e9 / iterations);
+
+    std::sort(samples.begin(), samples.end());
+
+    summary result{samples.front(), samples[samples.size() / 2], 0, 0};
+    result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+
+    for(double sample : samples)
+        result.stddev += (sample - result.mean) * (sample - result.mean);
+
+    result.stddev = std::sqrt(result.stddev / (samples.size() - 1));
+    return result;
+}
+
+//Print one row of the result table
+void report(const std::string& name, const summary& result)
+{
+    std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << result.min << std::setw(12) << result.median << std::setw(12) << result.mean
+              << std::setw(12) << result.stddev << '\n';
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Session file name, mode and cracked passwords
+#include <string_view>          //Hashing the options without copying them
+#include <vector>              //Per-worker positions and the list of cracked hashes
+#include <utility>            //std::pair
+#include <optional>          //A session file may not exist (or may be corrupt)
+#include <fstream>          //Reading and writing the session file
+#include <sstream>         //Parsing individual lines of the session file
+#include <chrono>         //Deciding when the next periodic checkpoint is due
+#include <cstdint>       //Fixed width offsets and indices
+#include <cstdio>       //std::rename() for atomically replacing the session file
+#include <csignal>     //SIGINT + SIGTERM handlers
+
+namespace checkpoint
+{
+    //Version of the session file format (bumped whenever the layout changes)
+    constexpr unsigned format_version = 2;
+
+    //Position of one worker: the part of the dictionary (byte offsets) or keyspace (indices) it has not finished yet
+    struct Worker
+    {
+        std::uint64_t begin;   //First byte/index that has NOT been tested
+        std::uint64_t end;    //One past the last byte/index this worker owns (UINT64_MAX = until the end of the input)
+    };
+
+    //Everything needed to continue an interrupted attack
+    struct State
+    {
+        std::uint64_t options_hash = 0;                               //Hash of the options the session was started with
+        std::string mode;                                            //Which attack was running ("dict" or "brute")
+        std::uint64_t progress = 0;                                 //Number of candidates tested so far (for the progress counter)
+        std::vector<Worker> workers;                               //Unfinished work for each worker
+        std::vector<std::pair<std::string, std::string>> cracked; //Targets cracked so far (hash -> plaintext)
+    };
+
+    //Class 'Checkpointer' periodically writes the state of a running attack to a session file
+    class Checkpointer final
+    {
+        private:
+            std::string filename;                                   //Name of the session file
+            std::uint64_t options_hash;                            //Hash of the options for the current run
+            std::string mode;                                     //Attack that is running
+            std::chrono::seconds interval;                       //Time between two checkpoints
+            std::chrono::steady_clock::time_point next_save;    //When the next checkpoint is due
+
+        public:
+            //Special methods
+            Checkpointer(std::string, std::uint64_t, std::string, std::chrono::seconds = std::chrono::seconds(60));
+
+            //General methods
+            [[nodiscard]] bool due() const noexcept;
+            [[nodiscard]] const std::string& file() const noexcept;
+            bool save(std::uint64_t, std::vector<Worker>, std::vector<std::pair<std::string, std::string>>);
+            void discard() const;
+    };
+
+
+    // ***** FREE FUNCTIONS ***** //
+
+    //Hash the options of a run (FNV-1a, 64 bit) so that '--restore' can refuse to continue a different job
+    inline std::uint64_t hash_options(std::initializer_list<std::string_view> options) noexcept
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+        for(const auto& option : options)
+        {
+            for(unsigned char c : option)
+            {
+                hash ^= c;
+                hash *= 0x100000001b3ULL;
+            }
+
+            //Separate the options so that ("ab", "c") and ("a", "bc") hash differently
+            hash ^= 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    //Encode an arbitrary string as hex so passwords with spaces or newlines survive the text format
+    inline std::string to_hex(std::string_view text)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(text.size() * 2);
+
+        for(unsigned char c : text)
+        {
+            hex += digits[c >> 4];
+            hex += digits[c & 0x0f];
+        }
+
+        return hex;
+    }
+
+    //Decode a string produced by 'to_hex' (std::nullopt if it is malformed)
+    inline std::optional<std::string> from_hex(std::string_view hex)
+    {
+        auto nibble = [](char c) -> int
+                      {
+                          if (c >= '0' and c <= '9') return c - '0';
+                          if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+                          if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+                          return -1;
+                      };
+
+        if (hex.size() % 2 != 0)
+            return std::nullopt;
+
+        std::string text;
+        text.reserve(hex.size() / 2);
+
+        for(std::size_t i=0; i < hex.size(); i += 2)
+        {
+            int high = nibble(hex[i]), low = nibble(hex[i+1]);
+
+            if (high < 0 or low < 0)
+                return std::nullopt;
+
+            text += static_cast<char>((high << 4) | low);
+        }
+
+        return text;
+    }
+
+    //Write the state to 'filename' -- written to a temporary file first and renamed, so a crash never leaves half a session behind
+    inline bool save(const std::string& filename, const State& state)
+    {
+        const std::string temp_file = filename + ".tmp";
+        std::ofstream out(temp_file, std::ios::trunc);
+
+        if (not out.good())
+            return false;
+
+        out << "MD5CRACKER-SESSION " << format_version << '\n'
+            << "options " << std::hex << state.options_hash << std::dec << '\n'
+            << "mode " << state.mode << '\n'
+            << "progress " << state.progress << '\n';
+
+        for(std::size_t i=0; i < state.workers.size(); ++i)
+            out << "worker " << i << ' ' << state.workers[i].begin << ' ' << state.workers[i].end << '\n';
+
+        for(const auto& [hash, password] : state.cracked)
+            out << "cracked " << hash << ' ' << to_hex(password) << '\n';
+
+        out << "end\n";
+        out.close();
+
+        if (out.fail())
+            return false;
+
+        return std::rename(temp_file.c_str(), filename.c_str()) == 0;
+    }
+
+    //Read a session file back (std::nullopt if it does not exist, is from another version, or was truncated)
+    inline std::optional<State> load(const std::string& filename)
+    {
+        std::ifstream in(filename);
+        std::string line, key;
+        State state;
+        bool complete = false;
+
+        if (not in.good())
+            return std::nullopt;
+
+        //Header: magic + version
+        unsigned version = 0;
+        if (not std::getline(in, line) or (std::istringstream(line) >> key >> version, key != "MD5CRACKER-SESSION" or version != format_version))
+            return std::nullopt;
+
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            fields >> key;
+
+            if (key == "options")
+                fields >> std::hex >> state.options_hash >> std::dec;
+            else if (key == "mode")
+                fields >> state.mode;
+            else if (key == "progress")
+                fields >> state.progress;
+            else if (key == "worker")
+            {
+                std::size_t id;
+                Worker worker{};
+                fields >> id >> worker.begin >> worker.end;
+
+                if (id != state.workers.size())   //Workers are written in order, anything else is corruption
+                    return std::nullopt;
+
+                state.workers.push_back(worker);
+            }
+            else if (key == "cracked")
+            {
+                std::string hash, hex;
+                fields >> hash >> hex;
+
+                auto password = from_hex(hex);
+                if (not password)
+                    return std::nullopt;
+
+                state.cracked.emplace_back(std::move(hash), std::move(*password));
+            }
+            else if (key == "end")
+            {
+                complete = true;
+                break;
+            }
+
+            if (fields.fail())
+                return std::nullopt;
+        }
+
+        if (not complete)
+            return std::nullopt;
+
+        return state;
+    }
+
+
+    // ***** SIGNAL HANDLING ***** //
+
+    //Set by SIGINT/SIGTERM; the cracking loops poll it and stop at the next candidate
+    inline volatile std::sig_atomic_t stop_requested = 0;
+
+    //Signal handler: request a graceful stop. A second signal falls back to the default action (so ^C^C still kills the process)
+    extern "C" inline void handle_stop_signal(int signal)
+    {
+        stop_requested = 1;
+        std::signal(signal, SIG_DFL);
+    }
+
+    //Install the SIGINT/SIGTERM handlers
+    inline void install_signal_handlers()
+    {
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+    }
+
+    //Whether a stop has been requested
+    [[nodiscard]] inline bool interrupted() noexcept
+    {
+        return stop_requested != 0;
+    }
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor
+    inline Checkpointer::Checkpointer(std::string in_filename, std::uint64_t in_options_hash, std::string in_mode, std::chrono::seconds in_interval)
+        : filename(std::move(in_filename)), options_hash(in_options_hash), mode(std::move(in_mode)), interval(in_interval),
+          next_save(std::chrono::steady_clock::now() + in_interval)
+    {
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return whether the periodic checkpoint interval has elapsed (cheap enough to call every few thousand candidates)
+    [[nodiscard]] inline bool Checkpointer::due() const noexcept
+    {
+        return std::chrono::steady_clock::now() >= next_save;
+    }
+
+    //Return the name of the session file
+    [[nodiscard]] inline const std::string& Checkpointer::file() const noexcept
+    {
+        return filename;
+    }
+
+    //Write a checkpoint and schedule the next one
+    inline bool Checkpointer::save(std::uint64_t progress, std::vector<Worker> workers, std::vector<std::pair<std::string, std::string>> cracked)
+    {
+        next_save = std::chrono::steady_clock::now() + interval;
+        return checkpoint::save(filename, State{options_hash, mode, progress, std::move(workers), std::move(cracked)});
+    }
+
+    //Remove the session file once the attack ran to completion (there is nothing left to restore)
+    inline void Checkpointer::discard() const
+    {
+        std::remove(filename.c_str());
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Usernames and candidates
+#include <string_view>          //Splitting usernames without copies
+#include <vector>              //Bases and suffixes
+#include <unordered_set>      //Bases are only tried once
+#include <algorithm>         //std::reverse
+#include <cctype>           //std::isalnum, std::isdigit, std::tolower, std::toupper
+
+//Custom Libraries
+#include "../rules/rules.hpp"
+
+namespace cracker
+{
+    //Class 'Association' generates the candidates of an association attack: passwords derived from the username (or email address) of
+    //the account they belong to. Each candidate is only compared with that account's hash, so thousands of candidates per account cost
+    //less than a single pass of a wordlist against every target.
+    //  bases:     the username, the local part of an email, its domain name, every '.', '_', '-', '+' separated part, all parts joined,
+    //             first initial + last part, and the same without trailing digits ('jsmith84' -> 'jsmith')
+    //  variants:  lowercase, Capitalized, UPPERCASE and reversed
+    //  suffixes:  none, common digit/symbol endings, every year from first_year to last_year (also as two digits and followed by '!')
+    //  rules:     every rule of the rule set applied to every base (on top of the variants and suffixes)
+    class Association final
+    {
+        private:
+            static constexpr int first_year = 1950;
+            static constexpr int last_year = 2030;
+
+            const rules::RuleSet& rules;              //Rules applied to every base ('--rules')
+            std::vector<std::string> suffixes;       //Endings appended to every variant
+
+        public:
+            //Special methods
+            explicit Association(const rules::RuleSet&);
+
+            //General methods
+            [[nodiscard]] static std::vector<std::string> bases(std::string_view);
+
+            template <typename Test>
+            bool run(std::string_view, Test&&) const;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: build the suffix list once
+    inline Association::Association(const rules::RuleSet& in_rules) : rules(in_rules)
+    {
+        suffixes = {"", "1", "12", "123", "1234", "12345", "!", "1!", "123!", "01", "69", "007"};
+
+        for(int year = first_year; year <= last_year; ++year)
+        {
+            std::string full = std::to_string(year);
+            std::string two = full.substr(2);
+
+            suffixes.insert(suffixes.end(), {full, full + "!", two});
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the distinct lowercase base words of a username or email address
+    [[nodiscard]] inline std::vector<std::string> Association::bases(std::string_view user)
+    {
+        std::vector<std::string> found;
+        std::unordered_set<std::string> seen;
+
+        auto add = [&](std::string base)
+                   {
+                       for(char& c : base)
+                           c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+                       if (not base.empty() and seen.insert(base).second)
+                           found.push_back(std::move(base));
+                   };
+
+        std::string_view local = user.substr(0, user.find('@'));
+        std::vector<std::string> parts;
+
+        add(std::string(user));
+        add(std::string(local));
+
+        //Domain name of an email address ('john@acme.com' -> 'acme')
+        if (local.size() < user.size())
+        {
+            std::string_view domain = user.substr(local.size() + 1);
+            add(std::string(domain.substr(0, domain.find('.'))));
+        }
+
+        //Parts of the local part ('john.smith' -> 'john', 'smith', 'johnsmith', 'jsmith')
+        for(std::size_t i=0; i < local.size();)
+        {
+            std::size_t end = i;
+
+            while (end < local.size() and std::isalnum(static_cast<unsigned char>(local[end])))
+                ++end;
+
+            if (end > i)
+                parts.emplace_back(local.substr(i, end - i));
+
+            i = end + 1;
+        }
+
+        if (parts.size() > 1)
+        {
+            std::string joined;
+
+            for(const std::string& part : parts)
+            {
+                add(part);
+                joined += part;
+            }
+
+            add(joined);
+            add(parts.front().substr(0, 1) + parts.back());
+        }
+
+        //Without trailing digits ('jsmith84' -> 'jsmith')
+        for(std::size_t i=0, count = found.size(); i < count; ++i)
+        {
+            std::string base = found[i];
+
+            while (not base.empty() and std::isdigit(static_cast<unsigned char>(base.back())))
+                base.pop_back();
+
+            add(std::move(base));
+        }
+
+        return found;
+    }
+
+    //Call 'test(candidate)' for every candidate of a username until it returns true -- returns whether it did
+    template <typename Test>
+    inline bool Association::run(std::string_view user, Test&& test) const
+    {
+        std::string candidate;
+
+        for(const std::string& base : bases(user))
+        {
+            std::string capitalized = base, upper = base, reversed = base;
+
+            capitalized[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(capitalized[0])));
+            for(char& c : upper)
+                c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            std::reverse(reversed.begin(), reversed.end());
+
+            for(const std::string& variant : {base, capitalized, upper, reversed})
+            {
+                for(const std::string& suffix : suffixes)
+                {
+                    candidate.assign(variant);
+                    candidate.append(suffix);
+
+                    if (test(candidate))
+                        return true;
+                }
+            }
+
+            for(const rules::Rule& rule : rules)
+                if (rule.apply(base, candidate) and test(candidate))
+                    return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,300 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Plaintexts of the lanes
+#include <string_view>          //Candidates are added without copies
+#include <array>               //One plaintext per lane
+#include <cstdint>            //Message words
+#include <cstddef>           //std::size_t
+#include <cstring>          //std::memcpy, std::memset
+#include <algorithm>       //std::fill_n
+
+//Custom Libraries
+#include "md5_lanes.hpp"
+#include "targets.hpp"
+#include "stats.hpp"
+
+namespace cracker
+{
+    //Class 'Batch' collects arbitrary candidates (dictionary words, rule outputs, combinations...) into a SIMD message block, one
+    //candidate per lane, and hashes them 'Lanes' at a time. Candidates that do not fit one MD5 block are hashed on their own.
+    //'match(hash, digest, plaintext)' is called for every candidate whose digest is a target.
+    //Candidates that share a head (the left word of a combination, the word of a hybrid attack...) can be added as tails: fix() writes
+    //the head into the message words of every lane once, and add_tail() only writes the words from the end of the head on. The other
+    //way round, fix_tail() writes a shared tail (and the padding) once for heads of a given length, which add_head() then fills in.
+    template <std::size_t Lanes>
+    class Batch final
+    {
+        private:
+            alignas(64) std::uint32_t words[16][Lanes];       //Message words of the queued candidates (word i of lane j: words[i][j])
+            char parts[Lanes][max_block_message];            //The part of each queued candidate that is not shared (to report a crack)
+            std::array<std::uint8_t, Lanes> part_lengths;   //Length of each part
+            std::size_t count = 0;                         //Number of queued candidates
+
+            enum class Shared { none, head, tail };
+
+            std::string head;                        //Head set by fix()
+            std::string tail;                       //Tail set by fix_tail()
+            std::size_t head_length = 0;           //Length of the heads of add_head()
+            Shared fixed = Shared::none;          //Which part is in the words of every lane (none after add())
+            unsigned char message[64] = {};      //Scratch message: the shared part + the part of the current candidate
+
+            static std::uint32_t load(const unsigned char*) noexcept;
+            void queue(std::string_view);
+            [[nodiscard]] std::string plaintext(std::size_t) const;
+
+        public:
+            //General methods
+            template <typename Match>
+            void add(std::string_view, const TargetTable&, Match&&);
+
+            template <typename Match>
+            void fix(std::string_view, const TargetTable&, Match&&);
+
+            template <typename Match>
+            void add_tail(std::string_view, const TargetTable&, Match&&);
+
+            template <typename Match>
+            void fix_tail(std::string_view, std::size_t, const TargetTable&, Match&&);
+
+            template <typename Match>
+            void add_head(std::string_view, const TargetTable&, Match&&);
+
+            template <typename Match>
+            void flush(const TargetTable&, Match&&);
+    };
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Read a little-endian message word
+    template <std::size_t Lanes>
+    inline std::uint32_t Batch<Lanes>::load(const unsigned char* bytes) noexcept
+    {
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+    }
+
+    //Remember the varying part of the candidate in the next lane (its words are already written)
+    template <std::size_t Lanes>
+    inline void Batch<Lanes>::queue(std::string_view part)
+    {
+        std::memcpy(parts[count], part.data(), part.size());
+        part_lengths[count] = static_cast<std::uint8_t>(part.size());
+    }
+
+    //Return the full candidate of a lane
+    template <std::size_t Lanes>
+    inline std::string Batch<Lanes>::plaintext(std::size_t lane) const
+    {
+        std::string candidate(parts[lane], part_lengths[lane]);
+
+        if (fixed == Shared::head)
+            candidate.insert(0, head);
+        else if (fixed == Shared::tail)
+            candidate.append(tail);
+
+        return candidate;
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Queue a candidate (the batch is hashed as soon as every lane is used)
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::add(std::string_view candidate, const TargetTable& targets, Match&& match)
+    {
+        if (candidate.size() > max_block_message)
+        {
+            digest d;
+            const std::string* hash;
+
+            { CRACKER_STAGE(hash); d = md5(candidate); }
+            { CRACKER_STAGE(probe); hash = targets.find(d); }
+
+            if (hash != nullptr)
+                match(*hash, d, std::string(candidate));
+
+            return;
+        }
+
+        if (fixed != Shared::none)
+        {
+            flush(targets, match);   //The queued lanes rely on the shared words that this candidate overwrites
+            fixed = Shared::none;
+        }
+
+        std::uint32_t padded[16];
+        pad_block(candidate.data(), candidate.size(), padded);
+
+        for(std::size_t i=0; i < 16; ++i)
+            words[i][count] = padded[i];
+
+        queue(candidate);
+
+        if (++count == Lanes)
+            flush(targets, match);
+    }
+
+    //Set the head of the following add_tail() candidates (hashes the queued candidates first, they may have another head)
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::fix(std::string_view new_head, const TargetTable& targets, Match&& match)
+    {
+        flush(targets, match);
+        head.assign(new_head);
+        fixed = Shared::head;
+
+        if (head.size() > max_block_message)
+            return;   //Every candidate with this head is hashed on its own
+
+        std::memcpy(message, head.data(), head.size());
+
+        //Broadcast the words that only contain head bytes
+        for(std::size_t i=0; i < head.size() / 4; ++i)
+            std::fill_n(words[i], Lanes, load(message + 4*i));
+    }
+
+    //Queue the candidate head + 'tail' (fix() must have been called since the last add())
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::add_tail(std::string_view tail, const TargetTable& targets, Match&& match)
+    {
+        const std::size_t length = head.size() + tail.size();
+
+        if (length > max_block_message)
+        {
+            std::string candidate = head;
+            candidate.append(tail);
+
+            digest d;
+            const std::string* hash;
+
+            { CRACKER_STAGE(hash); d = md5(candidate); }
+            { CRACKER_STAGE(probe); hash = targets.find(d); }
+
+            if (hash != nullptr)
+                match(*hash, d, candidate);
+
+            return;
+        }
+
+        //Complete the scratch message behind the head, then write the words that are not pure head bytes into this lane
+        std::memcpy(message + head.size(), tail.data(), tail.size());
+        message[length] = 0x80;
+        std::memset(message + length + 1, 0, 56 - (length + 1));
+
+        for(std::size_t i = head.size() / 4; i < 14; ++i)
+            words[i][count] = load(message + 4*i);
+
+        words[14][count] = static_cast<std::uint32_t>(length * 8);
+        words[15][count] = 0;
+
+        queue(tail);
+
+        if (++count == Lanes)
+            flush(targets, match);
+    }
+
+    //Set the tail of the following add_head() candidates, whose heads are all 'length' bytes long (hashes the queued candidates first)
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::fix_tail(std::string_view new_tail, std::size_t length, const TargetTable& targets, Match&& match)
+    {
+        flush(targets, match);
+        tail.assign(new_tail);
+        head_length = length;
+        fixed = Shared::tail;
+
+        const std::size_t total = head_length + tail.size();
+
+        if (total > max_block_message)
+            return;   //Every candidate with this tail is hashed on its own
+
+        std::memset(message, 0, sizeof(message));
+        std::memcpy(message + head_length, tail.data(), tail.size());
+        message[total] = 0x80;
+
+        //Broadcast the words that contain no head bytes (tail, padding and the bit length)
+        for(std::size_t i = (head_length + 3) / 4; i < 14; ++i)
+            std::fill_n(words[i], Lanes, load(message + 4*i));
+
+        std::fill_n(words[14], Lanes, static_cast<std::uint32_t>(total * 8));
+        std::fill_n(words[15], Lanes, 0);
+    }
+
+    //Queue the candidate 'head' + tail (fix_tail() must have been called since the last add(), with the length of 'head')
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::add_head(std::string_view new_head, const TargetTable& targets, Match&& match)
+    {
+        if (head_length + tail.size() > max_block_message)
+        {
+            std::string candidate(new_head);
+            candidate.append(tail);
+
+            digest d;
+            const std::string* hash;
+
+            { CRACKER_STAGE(hash); d = md5(candidate); }
+            { CRACKER_STAGE(probe); hash = targets.find(d); }
+
+            if (hash != nullptr)
+                match(*hash, d, candidate);
+
+            return;
+        }
+
+        //Only the words that hold head bytes differ between the lanes
+        std::memcpy(message, new_head.data(), head_length);
+
+        for(std::size_t i=0; i < (head_length + 3) / 4; ++i)
+            words[i][count] = load(message + 4*i);
+
+        queue(new_head);
+
+        if (++count == Lanes)
+            flush(targets, match);
+    }
+
+    //Hash the queued candidates (call before the work they came from is reported as done)
+    template <std::size_t Lanes>
+    template <typename Match>
+    inline void Batch<Lanes>::flush(const TargetTable& targets, Match&& match)
+    {
+        if (count == 0)
+            return;
+
+        CRACKER_BATCH_TIMER();
+        SoaBlock<Lanes> block;
+        vec<Lanes> out[4];
+        std::size_t hits[Lanes], hit_count = 0;    //Lanes that pass the prefilter
+
+        {
+            CRACKER_STAGE(hash);
+            std::memcpy(block.w, words, sizeof(words));
+            md5_compress(block.w, out);
+        }
+
+        {
+            CRACKER_STAGE(prefilter);
+            for(std::size_t lane=0; lane < count; ++lane)
+                if (targets.maybe(out[0][lane]))
+                    hits[hit_count++] = lane;
+        }
+
+        for(std::size_t i=0; i < hit_count; ++i)
+        {
+            const std::size_t lane = hits[i];
+            digest d = words_to_digest(out[0][lane], out[1][lane], out[2][lane], out[3][lane]);
+            const std::string* hash;
+
+            { CRACKER_STAGE(probe); hash = targets.find(d); }
+
+            if (hash != nullptr)
+                match(*hash, d, plaintext(lane));
+        }
+
+        count = 0;
+    }
+}
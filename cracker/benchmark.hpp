@@ -0,0 +1,246 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Candidates, kernel names
+#include <vector>               //Candidate sets, results
+#include <ostream>             //JSON output
+#include <iomanip>            //std::setprecision
+#include <chrono>            //Timing
+#include <thread>           //Thread scaling tests
+#include <atomic>          //Sink for the results of the scalar kernels
+#include <random>         //Synthetic candidates and targets
+#include <algorithm>     //std::min
+#include <cstdint>      //Counters
+
+//Custom Libraries
+#include "digest.hpp"
+#include "md5_lanes.hpp"
+#include "targets.hpp"
+#include "batch.hpp"
+
+namespace cracker
+{
+    //One measurement of '--benchmark'
+    struct BenchmarkResult
+    {
+        std::string test;               //"kernel", "targets" or "threads"
+        std::string kernel;            //"hashlib", "scalar", "simd4", "simd8" or "simd16"
+        std::size_t length;           //Length of the candidates
+        std::size_t targets;         //Number of targets looked up
+        unsigned threads;           //Number of threads hashing
+        double hashes_per_second;
+    };
+
+    //Class 'Benchmark' measures the hashing speed on synthetic candidates and targets, without a hashfile, a dictionary or a progress line:
+    //  kernel:   every kernel (hashlib's MD5Transform, the scalar single-block kernel, each SIMD width) for several candidate lengths
+    //  targets:  the default SIMD kernel against 1, 1k and 1M targets (prefilter + table probe)
+    //  threads:  the default SIMD kernel on 1, 2, 4... threads up to the given maximum
+    //Every measurement hashes the same candidates over and over for a fixed time, then reports the hashes per second.
+    class Benchmark final
+    {
+        private:
+            std::chrono::duration<double> duration;       //Time spent on each measurement
+
+            static std::vector<std::string> candidates(std::size_t, std::uint64_t);
+            static TargetTable random_targets(std::size_t);
+
+            template <typename Pass>
+            double measure(unsigned, Pass&&) const;
+
+            template <std::size_t Lanes>
+            double batch_speed(std::size_t, const TargetTable&, unsigned) const;
+
+            double scalar_speed(std::size_t, const TargetTable&, bool) const;
+
+        public:
+            //Special methods
+            explicit Benchmark(double = 0.25);
+
+            //General methods
+            std::vector<BenchmarkResult> run(unsigned);
+            static void write_json(std::ostream&, const std::vector<BenchmarkResult>&, double);
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: the time spent on each measurement, in seconds
+    inline Benchmark::Benchmark(double seconds) : duration(seconds)
+    {
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Generate 4096 random printable candidates of the given length
+    inline std::vector<std::string> Benchmark::candidates(std::size_t length, std::uint64_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::uniform_int_distribution<int> printable(' ', '~');
+        std::vector<std::string> set(4096, std::string(length, ' '));
+
+        for(std::string& candidate : set)
+            for(char& c : candidate)
+                c = static_cast<char>(printable(random));
+
+        return set;
+    }
+
+    //Build a target table of random digests (practically never hit, so every candidate pays the full lookup)
+    inline TargetTable Benchmark::random_targets(std::size_t count)
+    {
+        std::mt19937_64 random(count);
+        TargetTable targets;
+
+        for(std::size_t i=0; i < count; ++i)
+        {
+            digest d;
+
+            for(std::uint8_t& byte : d)
+                byte = static_cast<std::uint8_t>(random());
+
+            targets.insert(d, to_hex(d));
+        }
+
+        targets.build_filter();
+        return targets;
+    }
+
+    //Run 'pass(id)' (which hashes a whole candidate set and returns how many candidates it hashed) on 'threads' threads until the
+    //duration is over -- returns the hashes per second of all threads together
+    template <typename Pass>
+    inline double Benchmark::measure(unsigned threads, Pass&& pass) const
+    {
+        std::vector<double> speeds(threads, 0.0);     //Hashes per second of each thread
+        std::vector<std::thread> workers;
+
+        for(unsigned id=0; id < threads; ++id)
+            workers.emplace_back([&, id]()
+                                 {
+                                     std::uint64_t hashed = 0;
+                                     std::chrono::duration<double> elapsed(0);
+
+                                     pass(id);   //Warm-up: caches, page faults, frequency
+                                     const auto begin = std::chrono::steady_clock::now();
+
+                                     while ((elapsed = std::chrono::steady_clock::now() - begin) < duration)
+                                         hashed += pass(id);
+
+                                     speeds[id] = hashed / elapsed.count();
+                                 });
+
+        for(std::thread& worker : workers)
+            worker.join();
+
+        double total = 0;
+        for(double speed : speeds)
+            total += speed;
+
+        return total;
+    }
+
+    //Hashes per second of Batch<Lanes> on candidates of the given length
+    template <std::size_t Lanes>
+    inline double Benchmark::batch_speed(std::size_t length, const TargetTable& targets, unsigned threads) const
+    {
+        std::vector<std::vector<std::string>> sets;
+
+        for(unsigned id=0; id < threads; ++id)
+            sets.push_back(candidates(length, id));
+
+        return measure(threads, [&](unsigned id)
+                                {
+                                    Batch<Lanes> batch;
+                                    auto match = [](const std::string&, const digest&, const std::string&) {};
+
+                                    for(const std::string& candidate : sets[id])
+                                        batch.add(candidate, targets, match);
+
+                                    batch.flush(targets, match);
+                                    return sets[id].size();
+                                });
+    }
+
+    //Hashes per second of hashlib (MD5Init/MD5Update/MD5Final) or of the scalar single-block kernel, one thread
+    inline double Benchmark::scalar_speed(std::size_t length, const TargetTable& targets, bool hashlib) const
+    {
+        const std::vector<std::string> set = candidates(length, 0);
+        std::atomic<std::size_t> found(0);   //Keeps the digests alive
+
+        return measure(1, [&](unsigned)
+                          {
+                              for(const std::string& candidate : set)
+                              {
+                                  digest d = (hashlib or length > max_block_message ? md5(candidate) : md5_short(candidate.data(), length));
+
+                                  if (targets.find(d) != nullptr)
+                                      found.fetch_add(1, std::memory_order_relaxed);
+                              }
+
+                              return set.size();
+                          });
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Run every measurement, using up to 'max_threads' threads for the thread scaling test
+    inline std::vector<BenchmarkResult> Benchmark::run(unsigned max_threads)
+    {
+        const std::string native = "simd" + std::to_string(simd_lanes);
+        std::vector<BenchmarkResult> results;
+
+        TargetTable one = random_targets(1);
+
+        //Kernels x lengths (one target, one thread)
+        for(std::size_t length : {4, 8, 16, 32, 55})
+        {
+            results.push_back({"kernel", "hashlib", length, 1, 1, scalar_speed(length, one, true)});
+            results.push_back({"kernel", "scalar", length, 1, 1, scalar_speed(length, one, false)});
+            results.push_back({"kernel", "simd4", length, 1, 1, batch_speed<4>(length, one, 1)});
+            results.push_back({"kernel", "simd8", length, 1, 1, batch_speed<8>(length, one, 1)});
+            results.push_back({"kernel", "simd16", length, 1, 1, batch_speed<16>(length, one, 1)});
+        }
+
+        //Target set sizes (the probe cost grows once the table no longer fits the caches)
+        for(std::size_t count : {1, 1000, 1000000})
+        {
+            TargetTable targets = random_targets(count);
+            results.push_back({"targets", native, 8, count, 1, batch_speed<simd_lanes>(8, targets, 1)});
+        }
+
+        //Thread scaling: 1, 2, 4... and the maximum itself
+        TargetTable thousand = random_targets(1000);
+
+        for(unsigned threads = 1; ; threads = std::min(threads * 2, max_threads))
+        {
+            results.push_back({"threads", native, 8, 1000, threads, batch_speed<simd_lanes>(8, thousand, threads)});
+
+            if (threads >= max_threads)
+                break;
+        }
+
+        return results;
+    }
+
+    //Write the results as a JSON document (one object per measurement, plus the build they were measured on)
+    inline void Benchmark::write_json(std::ostream& out, const std::vector<BenchmarkResult>& results, double seconds)
+    {
+        out << "{\n"
+            << "  \"build\": {\"compiler\": \"" << __VERSION__ << "\", \"simd_lanes\": " << simd_lanes
+            << ", \"hardware_threads\": " << std::thread::hardware_concurrency() << ", \"seconds_per_test\": " << seconds << "},\n"
+            << "  \"results\": [\n";
+
+        for(std::size_t i=0; i < results.size(); ++i)
+        {
+            const BenchmarkResult& result = results[i];
+
+            out << "    {\"test\": \"" << result.test << "\", \"kernel\": \"" << result.kernel << "\", \"length\": " << result.length
+                << ", \"targets\": " << result.targets << ", \"threads\": " << result.threads << ", \"hashes_per_second\": "
+                << std::fixed << std::setprecision(0) << result.hashes_per_second << std::defaultfloat << '}'
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+
+        out << "  ]\n}\n";
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string_view>           //Candidates are checked without copies
+#include <functional>           //std::hash<std::string_view>
+#include <vector>              //The filter blocks
+#include <atomic>             //Lock-free bit setting, statistics
+#include <cstdint>           //Bit words, counters
+#include <cstddef>          //std::size_t
+#include <algorithm>       //std::max
+
+namespace cracker
+{
+    //Class 'Bloom' drops candidates that were already generated (a rule that lowercases an already lowercase word, a word that appears
+    //twice in a wordlist...) before they are hashed. It is a blocked Bloom filter: every candidate maps to one 64-byte block (one cache
+    //line, the "shard") and sets 'probes' bits inside it with atomic ORs, so any number of workers share it without a lock.
+    //A false positive skips a candidate that was never hashed: budget about 2 bytes per distinct candidate to keep that near 0.1%.
+    class Bloom final
+    {
+        private:
+            static constexpr unsigned probes = 6;         //Bits set per candidate (9 bits of the hash each)
+
+            struct alignas(64) Block
+            {
+                std::atomic<std::uint64_t> words[8];
+            };
+
+            std::vector<Block> blocks;                      //Zero-initialized
+            std::atomic<std::uint64_t> checked = 0;       //Candidates checked (reported by the workers)
+            std::atomic<std::uint64_t> duplicates = 0;   //Candidates reported as already seen
+
+            static std::uint64_t mix(std::uint64_t) noexcept;
+
+        public:
+            //Special methods
+            explicit Bloom(std::size_t);
+
+            //General methods
+            [[nodiscard]] bool insert(std::string_view) noexcept;
+            void count(std::uint64_t, std::uint64_t) noexcept;
+
+            [[nodiscard]] std::uint64_t size() const noexcept;
+            [[nodiscard]] std::uint64_t candidates() const noexcept;
+            [[nodiscard]] std::uint64_t duplicate_count() const noexcept;
+            [[nodiscard]] double duplicate_rate() const noexcept;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: a filter of 'megabytes' MiB (at least one block)
+    inline Bloom::Bloom(std::size_t megabytes) : blocks(std::max<std::size_t>(megabytes * (1 << 20) / sizeof(Block), 1))
+    {
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Finalizer of splitmix64: spreads every input bit over the whole word
+    inline std::uint64_t Bloom::mix(std::uint64_t x) noexcept
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Add a candidate -- returns true if it was (probably) added before, i.e. it does not have to be hashed again
+    [[nodiscard]] inline bool Bloom::insert(std::string_view candidate) noexcept
+    {
+        const std::uint64_t h = mix(std::hash<std::string_view>{}(candidate));
+        const std::uint64_t bits = mix(h ^ 0x9e3779b97f4a7c15ULL);
+        Block& block = blocks[static_cast<std::size_t>((static_cast<unsigned __int128>(h) * blocks.size()) >> 64)];
+        bool present = true;
+
+        for(unsigned i=0; i < probes; ++i)
+        {
+            const unsigned bit = (bits >> (9 * i)) & 511;
+            const std::uint64_t mask = std::uint64_t(1) << (bit & 63);
+            std::atomic<std::uint64_t>& word = block.words[bit >> 6];
+
+            //Read first: the word is usually shared with other candidates, so skip the write when the bit is set already
+            if ((word.load(std::memory_order_relaxed) & mask) == 0)
+            {
+                word.fetch_or(mask, std::memory_order_relaxed);
+                present = false;
+            }
+        }
+
+        return present;
+    }
+
+    //Add a worker's statistics: 'seen' candidates checked, 'dropped' of them duplicates
+    inline void Bloom::count(std::uint64_t seen, std::uint64_t dropped) noexcept
+    {
+        checked.fetch_add(seen, std::memory_order_relaxed);
+        duplicates.fetch_add(dropped, std::memory_order_relaxed);
+    }
+
+    //Return the size of the filter in bytes
+    [[nodiscard]] inline std::uint64_t Bloom::size() const noexcept
+    {
+        return blocks.size() * sizeof(Block);
+    }
+
+    //Return the number of candidates checked
+    [[nodiscard]] inline std::uint64_t Bloom::candidates() const noexcept
+    {
+        return checked.load(std::memory_order_relaxed);
+    }
+
+    //Return the number of candidates that were dropped as duplicates
+    [[nodiscard]] inline std::uint64_t Bloom::duplicate_count() const noexcept
+    {
+        return duplicates.load(std::memory_order_relaxed);
+    }
+
+    //Return the fraction of the checked candidates that were dropped
+    [[nodiscard]] inline double Bloom::duplicate_rate() const noexcept
+    {
+        return (candidates() != 0 ? static_cast<double>(duplicate_count()) / candidates() : 0.0);
+    }
+}
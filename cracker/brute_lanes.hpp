@@ -0,0 +1,163 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Candidate prefix buffer
+#include <vector>               //Per-group lane tables
+#include <array>               //Lane tables per previous character (Markov order)
+#include <algorithm>          //std::min
+#include <cstdint>            //Keyspace indices, message words
+
+//Custom Libraries
+#include "md5_lanes.hpp"
+#include "targets.hpp"
+#include "stats.hpp"
+#include "../permuter/permute.hpp"
+
+namespace cracker
+{
+    //Class 'BruteLanes' generates the candidates of one keyspace straight into SIMD message blocks. The keyspace is walked in rows:
+    //all positions but the last are fixed in a row, and the last (fastest-changing) position runs through its charset in groups of
+    //'Lanes'. The row's message words are built and broadcast once; per group only the word holding the last character changes,
+    //and it is produced with one vector OR of the broadcast row word and a precomputed per-group table of lane characters.
+    //Lanes are only turned back into plaintext (by index) when their digest matches a target. In Markov order the last position's
+    //order depends on the character before it, so there is one set of tables per previous character.
+    template <std::size_t Lanes>
+    class BruteLanes final
+    {
+        private:
+            const Permute::Keyspace& keyspace;        //Keyspace being enumerated (length <= 55)
+            std::uint64_t radix;                     //Size of the last position's charset = candidates per row
+            std::size_t word;                       //Message word holding the last character
+            unsigned shift;                        //Bit offset of the last character within that word
+            std::array<std::vector<vec<Lanes>>, 256> lane_chars;   //[previous character][group]: the last character of every lane, shifted into place
+
+        public:
+            //Special methods
+            explicit BruteLanes(const Permute::Keyspace&);
+
+            //General methods
+            [[nodiscard]] static bool suitable(const Permute::Keyspace&) noexcept;
+
+            template <typename Match, typename Stop>
+            std::uint64_t run(std::uint64_t, std::uint64_t, const TargetTable&, Match&&, Stop&&) const;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: precompute the lane tables of the last position
+    template <std::size_t Lanes>
+    BruteLanes<Lanes>::BruteLanes(const Permute::Keyspace& in_keyspace)
+        : keyspace(in_keyspace), radix(in_keyspace.charset(in_keyspace.length() - 1).size()),
+          word((in_keyspace.length() - 1) / 4), shift(8 * ((in_keyspace.length() - 1) % 4))
+    {
+        const std::size_t last = keyspace.length() - 1;
+
+        for(char prev : (last > 0 ? keyspace.charset(last - 1) : std::string(1, '\0')))
+        {
+            const std::string& charset = keyspace.charset(last, prev);
+
+            for(std::uint64_t group=0; group * Lanes < radix; ++group)
+            {
+                vec<Lanes> chars{};
+
+                for(std::size_t lane=0; lane < Lanes and group * Lanes + lane < radix; ++lane)
+                    chars[lane] = static_cast<std::uint32_t>(static_cast<unsigned char>(charset[group * Lanes + lane])) << shift;
+
+                lane_chars[static_cast<unsigned char>(prev)].push_back(chars);
+            }
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return whether a keyspace can use the SIMD generator: single-block candidates, and enough characters in the last position
+    //to keep at least half of the lanes busy
+    template <std::size_t Lanes>
+    [[nodiscard]] bool BruteLanes<Lanes>::suitable(const Permute::Keyspace& keyspace) noexcept
+    {
+        return keyspace.length() <= max_block_message and keyspace.charset(keyspace.length() - 1).size() * 2 >= Lanes;
+    }
+
+    //Test the candidates [begin, end) of the keyspace. 'match(hash, digest, plaintext)' is called for every crack; 'stop()' is
+    //polled once per row. Returns the index of the first candidate that was not tested (end, unless stopped).
+    template <std::size_t Lanes>
+    template <typename Match, typename Stop>
+    std::uint64_t BruteLanes<Lanes>::run(std::uint64_t begin, std::uint64_t end, const TargetTable& targets, Match&& match, Stop&& stop) const
+    {
+        const std::size_t length = keyspace.length();
+
+        std::uint64_t row = begin / radix;
+        std::uint64_t first = begin % radix;                     //First column to test in the current row
+        std::string candidate = keyspace.at(row * radix);       //Current row (last character = first of its charset)
+
+        SoaBlock<Lanes> block;
+        vec<Lanes> out[4];
+        std::uint32_t words[16];
+
+        while (row * radix + first < end)
+        {
+            if (stop())
+                return row * radix + first;
+
+            //Build the row's message once: pad the candidate, clear the last character and broadcast every word to all lanes
+            {
+                CRACKER_STAGE(generate);
+                pad_block(candidate.data(), length, words);
+                words[word] &= ~(std::uint32_t(0xff) << shift);
+
+                for(std::size_t i=0; i < 16; ++i)
+                    block.w[i] = vec<Lanes>{} + words[i];
+            }
+
+            const vec<Lanes> row_word = block.w[word];
+            const char prev = (length > 1 ? candidate[length - 2] : '\0');
+            const std::vector<vec<Lanes>>& row_chars = lane_chars[static_cast<unsigned char>(prev)];
+            const std::uint64_t last = std::min(radix, end - row * radix);   //One past the last column to test in this row
+
+            for(std::uint64_t group = first / Lanes; group * Lanes < last; ++group)
+            {
+                CRACKER_BATCH_TIMER();
+                std::size_t hits[Lanes], hit_count = 0;    //Lanes that pass the prefilter
+
+                {
+                    CRACKER_STAGE(hash);
+                    block.w[word] = row_word | row_chars[group];
+                    md5_compress(block.w, out);
+                }
+
+                {
+                    CRACKER_STAGE(prefilter);
+                    for(std::size_t lane=0; lane < Lanes; ++lane)
+                    {
+                        std::uint64_t column = group * Lanes + lane;
+
+                        if (column >= first and column < last and targets.maybe(out[0][lane]))
+                            hits[hit_count++] = lane;
+                    }
+                }
+
+                for(std::size_t i=0; i < hit_count; ++i)
+                {
+                    const std::size_t lane = hits[i];
+                    digest d = words_to_digest(out[0][lane], out[1][lane], out[2][lane], out[3][lane]);
+                    const std::string* hash;
+
+                    { CRACKER_STAGE(probe); hash = targets.find(d); }
+
+                    if (hash != nullptr)
+                        match(*hash, d, keyspace.at(row * radix + group * Lanes + lane));
+                }
+            }
+
+            //Next row: carry out of the last position into the prefix
+            candidate[length - 1] = keyspace.charset(length - 1, prev).back();
+            keyspace.increment(candidate.data());
+            ++row;
+            first = 0;
+        }
+
+        return end;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Dictionary file name
+#include <string_view>          //Words are views into the mapping
+#include <stdexcept>           //std::runtime_error
+#include <algorithm>          //std::min
+#include <cstdint>           //Byte offsets
+#include <cstring>          //std::memchr, std::strerror
+#include <cerrno>          //errno
+
+//Native POSIX Libraries
+#include <fcntl.h>          //open()
+#include <unistd.h>        //close()
+#include <sys/mman.h>     //mmap(), munmap(), madvise()
+#include <sys/stat.h>    //fstat()
+
+namespace cracker
+{
+    //Class 'Dictionary' maps a wordlist into memory so any number of worker threads can read any byte range of it without I/O calls.
+    //Work is split by byte offsets: a line belongs to the range its first byte falls in, so ranges may be cut anywhere and every
+    //line is still read exactly once.
+    class Dictionary final
+    {
+        private:
+            const char* map = nullptr;        //The file, read-only
+            std::uint64_t bytes = 0;         //Size of the file
+            int fd = -1;                    //Descriptor of the file
+
+        public:
+            //Special methods
+            explicit Dictionary(const std::string&);
+            ~Dictionary();
+            Dictionary(const Dictionary&) = delete;
+            Dictionary& operator=(const Dictionary&) = delete;
+
+            //General methods
+            [[nodiscard]] std::uint64_t size() const noexcept;
+            [[nodiscard]] std::uint64_t line_start(std::uint64_t) const noexcept;
+            [[nodiscard]] std::string_view line(std::uint64_t) const noexcept;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: map the whole file -- CAN THROW std::runtime_error
+    inline Dictionary::Dictionary(const std::string& filename)
+    {
+        struct stat info;
+
+        fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            throw std::runtime_error("the file \"" + filename + "\" could not be found");
+
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot stat \"" + filename + "\": " + std::strerror(errno));
+        }
+
+        bytes = static_cast<std::uint64_t>(info.st_size);
+
+        //An empty file cannot be mapped (and has nothing to read anyway)
+        if (bytes != 0)
+        {
+            void* region = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (region == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot map \"" + filename + "\": " + std::strerror(errno));
+            }
+
+            ::madvise(region, bytes, MADV_SEQUENTIAL);
+            map = static_cast<const char*>(region);
+        }
+    }
+
+    //Destructor
+    inline Dictionary::~Dictionary()
+    {
+        if (map != nullptr)
+            ::munmap(const_cast<char*>(map), bytes);
+
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the size of the file in bytes
+    [[nodiscard]] inline std::uint64_t Dictionary::size() const noexcept
+    {
+        return bytes;
+    }
+
+    //Return the offset of the first line that starts at or after 'offset' (size() if there is none)
+    [[nodiscard]] inline std::uint64_t Dictionary::line_start(std::uint64_t offset) const noexcept
+    {
+        if (offset == 0 or offset >= bytes or map[offset - 1] == '\n')
+            return std::min(offset, bytes);
+
+        const void* newline = std::memchr(map + offset, '\n', bytes - offset);
+        return (newline != nullptr ? static_cast<std::uint64_t>(static_cast<const char*>(newline) - map) + 1 : bytes);
+    }
+
+    //Return the line starting at 'offset' without its '\n' (the next line starts at offset + line.size() + 1)
+    [[nodiscard]] inline std::string_view Dictionary::line(std::uint64_t offset) const noexcept
+    {
+        const void* newline = std::memchr(map + offset, '\n', bytes - offset);
+        std::uint64_t end = (newline != nullptr ? static_cast<std::uint64_t>(static_cast<const char*>(newline) - map) : bytes);
+
+        return std::string_view(map + offset, end - offset);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+//Native C++ Libraries
+#include <array>                 //Fixed size binary digest
+#include <string>               //Hex representation of a digest
+#include <string_view>         //Hashing candidates without copying them
+#include <optional>           //Parsing a hex string may fail
+#include <cstdint>           //Fixed width integers
+#include <cstring>          //std::memcpy for the hash functor
+
+//External Libraries (dependencies)
+#include "../hashlib++_md5/hl_md5.h"   //MD5Init/MD5Update/MD5Final
+
+namespace cracker
+{
+    //A binary MD5 digest (16 bytes) -- a quarter of the size of the hex string and compared with a single memcmp
+    using digest = std::array<std::uint8_t, 16>;
+
+    //Hash functor for unordered containers: the digest is already uniformly distributed, so its first 8 bytes are a perfect hash
+    struct digest_hash
+    {
+        std::size_t operator()(const digest& d) const noexcept
+        {
+            std::uint64_t h;
+            std::memcpy(&h, d.data(), sizeof(h));
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    //Parse a 32 character hex string (either case) into a binary digest (std::nullopt if it is not a valid MD5 hash)
+    inline std::optional<digest> parse_digest(std::string_view hex) noexcept
+    {
+        auto nibble = [](char c) -> int
+                      {
+                          if (c >= '0' and c <= '9') return c - '0';
+                          if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+                          if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+                          return -1;
+                      };
+
+        //Tolerate the '\r' left behind by files with Windows line endings
+        if (not hex.empty() and hex.back() == '\r')
+            hex.remove_suffix(1);
+
+        if (hex.size() != 32)
+            return std::nullopt;
+
+        digest result;
+        for(std::size_t i=0; i < result.size(); ++i)
+        {
+            int high = nibble(hex[2*i]), low = nibble(hex[2*i + 1]);
+
+            if (high < 0 or low < 0)
+                return std::nullopt;
+
+            result[i] = static_cast<std::uint8_t>((high << 4) | low);
+        }
+
+        return result;
+    }
+
+    //Convert a binary digest to the usual lowercase hex string
+    inline std::string to_hex(const digest& d)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string hex(32, '0');
+
+        for(std::size_t i=0; i < d.size(); ++i)
+        {
+            hex[2*i]     = digits[d[i] >> 4];
+            hex[2*i + 1] = digits[d[i] & 0x0f];
+        }
+
+        return hex;
+    }
+
+    //MD5 a candidate straight into a binary digest (skips md5wrapper's ostringstream hex conversion)
+    inline digest md5(std::string_view text)
+    {
+        MD5 md5;
+        HL_MD5_CTX ctx;
+        digest result;
+
+        md5.MD5Init(&ctx);
+        md5.MD5Update(&ctx, reinterpret_cast<unsigned char*>(const_cast<char*>(text.data())), static_cast<unsigned int>(text.size()));
+        md5.MD5Final(result.data(), &ctx);
+
+        return result;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Cracked plaintexts
+#include <deque>                //Queue of plaintexts waiting to go through the rules
+#include <unordered_set>       //Plaintexts that were already queued once
+#include <mutex>              //Cracks are pushed and popped by every worker thread
+#include <atomic>            //Lock-free check for an empty queue
+#include <cstdint>          //Counters
+
+namespace cracker
+{
+    //Class 'Loopback' feeds freshly cracked plaintexts back into a dictionary attack: workers take them ahead of the next dictionary word
+    //and run them through the active rule set, since passwords of one leak are correlated ('Summer2019' -> 'Summer2020!').
+    //Every plaintext is queued at most once, so cracks found by the loopback itself cannot make it loop forever.
+    class Loopback final
+    {
+        private:
+            mutable std::mutex lock;                       //Guards the queue and the seen set
+            std::deque<std::string> queue;                //Plaintexts waiting to go through the rules
+            std::unordered_set<std::string> seen;        //Every plaintext ever queued
+            std::atomic<std::size_t> waiting = 0;       //Size of the queue (checked without the lock before every word)
+            std::uint64_t fed = 0;                     //Number of plaintexts queued so far
+
+        public:
+            //General methods
+            void push(const std::string&);
+            bool pop(std::string&);
+            [[nodiscard]] bool empty() const noexcept;
+            [[nodiscard]] std::uint64_t size() const;
+    };
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Queue a cracked plaintext (ignored if it was queued before)
+    inline void Loopback::push(const std::string& plaintext)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (seen.insert(plaintext).second)
+        {
+            queue.push_back(plaintext);
+            waiting.store(queue.size(), std::memory_order_release);
+            ++fed;
+        }
+    }
+
+    //Take the oldest queued plaintext -- returns false if there is none
+    inline bool Loopback::pop(std::string& plaintext)
+    {
+        if (empty())
+            return false;
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (queue.empty())
+            return false;
+
+        plaintext = std::move(queue.front());
+        queue.pop_front();
+        waiting.store(queue.size(), std::memory_order_release);
+        return true;
+    }
+
+    //Return whether nothing is waiting (cheap enough to call for every dictionary word)
+    [[nodiscard]] inline bool Loopback::empty() const noexcept
+    {
+        return waiting.load(std::memory_order_acquire) == 0;
+    }
+
+    //Return the number of plaintexts that were fed back so far
+    [[nodiscard]] inline std::uint64_t Loopback::size() const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return fed;
+    }
+}
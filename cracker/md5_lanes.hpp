@@ -0,0 +1,164 @@
+#pragma once
+
+//Native C++ Libraries
+#include <cstdint>               //32-bit message words
+#include <cstddef>              //std::size_t
+#include <cstring>             //std::memcpy
+
+//Custom Libraries
+#include "digest.hpp"
+
+//Vectors wider than the target's registers are passed differently between ABIs; they never cross a library boundary here (scoped to
+//this header: files that include it keep the warning)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace cracker
+{
+    //Number of MD5 computations per kernel call on this build: one per 32-bit lane of the widest vector unit the compiler targets
+    #if defined(__AVX512F__)
+        constexpr std::size_t simd_lanes = 16;
+    #elif defined(__AVX2__) || defined(__ARM_NEON)
+        constexpr std::size_t simd_lanes = 8;
+    #else
+        constexpr std::size_t simd_lanes = 4;
+    #endif
+
+    //Vector of 'Lanes' 32-bit words (GCC/Clang vector extension, so the same code compiles to SSE2, AVX2, AVX-512 or NEON)
+    template <std::size_t Lanes>
+    struct lane_vector
+    {
+        typedef std::uint32_t type __attribute__((vector_size(sizeof(std::uint32_t) * Lanes)));
+    };
+
+    template <std::size_t Lanes>
+    using vec = typename lane_vector<Lanes>::type;
+
+    //Structure-of-arrays message block: word i of lane j is w[i][j]. Candidates are written straight into this layout.
+    template <std::size_t Lanes>
+    struct SoaBlock
+    {
+        vec<Lanes> w[16];
+    };
+
+
+    // ***** KERNEL ***** //
+
+    //The MD5 compression function for a single, already padded block, written once for plain words (V = std::uint32_t) and for
+    //vectors of words (V = vec<N>), which hash N independent messages in lockstep. Same rounds as MD5::MD5Transform in hl_md5.cpp.
+    namespace detail
+    {
+        //Each helper updates 'a' in place: vectors never travel by value, so no 64-byte argument or return value crosses a call
+        template <typename V> [[gnu::always_inline]] inline void rotl(V& a, int s) { a = (a << s) | (a >> (32 - s)); }
+        template <typename V> [[gnu::always_inline]] inline void F(V& a, const V& x, const V& y, const V& z) { a += z ^ (x & (y ^ z)); }
+        template <typename V> [[gnu::always_inline]] inline void G(V& a, const V& x, const V& y, const V& z) { a += y ^ (z & (x ^ y)); }
+        template <typename V> [[gnu::always_inline]] inline void H(V& a, const V& x, const V& y, const V& z) { a += x ^ y ^ z; }
+        template <typename V> [[gnu::always_inline]] inline void I(V& a, const V& x, const V& y, const V& z) { a += y ^ (x | ~z); }
+    }
+
+    #define CRACKER_MD5_STEP(f, a, b, c, d, x, s, ac) \
+        detail::f(a, b, c, d); \
+        a += (x) + static_cast<std::uint32_t>(ac); \
+        detail::rotl(a, s); \
+        a += b;
+
+    template <typename V>
+    inline void md5_compress(const V w[16], V out[4])
+    {
+        V a = V{} + 0x67452301u, b = V{} + 0xefcdab89u, c = V{} + 0x98badcfeu, d = V{} + 0x10325476u;
+
+        //Round 1
+        CRACKER_MD5_STEP(F, a, b, c, d, w[ 0],  7, 0xd76aa478) CRACKER_MD5_STEP(F, d, a, b, c, w[ 1], 12, 0xe8c7b756)
+        CRACKER_MD5_STEP(F, c, d, a, b, w[ 2], 17, 0x242070db) CRACKER_MD5_STEP(F, b, c, d, a, w[ 3], 22, 0xc1bdceee)
+        CRACKER_MD5_STEP(F, a, b, c, d, w[ 4],  7, 0xf57c0faf) CRACKER_MD5_STEP(F, d, a, b, c, w[ 5], 12, 0x4787c62a)
+        CRACKER_MD5_STEP(F, c, d, a, b, w[ 6], 17, 0xa8304613) CRACKER_MD5_STEP(F, b, c, d, a, w[ 7], 22, 0xfd469501)
+        CRACKER_MD5_STEP(F, a, b, c, d, w[ 8],  7, 0x698098d8) CRACKER_MD5_STEP(F, d, a, b, c, w[ 9], 12, 0x8b44f7af)
+        CRACKER_MD5_STEP(F, c, d, a, b, w[10], 17, 0xffff5bb1) CRACKER_MD5_STEP(F, b, c, d, a, w[11], 22, 0x895cd7be)
+        CRACKER_MD5_STEP(F, a, b, c, d, w[12],  7, 0x6b901122) CRACKER_MD5_STEP(F, d, a, b, c, w[13], 12, 0xfd987193)
+        CRACKER_MD5_STEP(F, c, d, a, b, w[14], 17, 0xa679438e) CRACKER_MD5_STEP(F, b, c, d, a, w[15], 22, 0x49b40821)
+
+        //Round 2
+        CRACKER_MD5_STEP(G, a, b, c, d, w[ 1],  5, 0xf61e2562) CRACKER_MD5_STEP(G, d, a, b, c, w[ 6],  9, 0xc040b340)
+        CRACKER_MD5_STEP(G, c, d, a, b, w[11], 14, 0x265e5a51) CRACKER_MD5_STEP(G, b, c, d, a, w[ 0], 20, 0xe9b6c7aa)
+        CRACKER_MD5_STEP(G, a, b, c, d, w[ 5],  5, 0xd62f105d) CRACKER_MD5_STEP(G, d, a, b, c, w[10],  9, 0x02441453)
+        CRACKER_MD5_STEP(G, c, d, a, b, w[15], 14, 0xd8a1e681) CRACKER_MD5_STEP(G, b, c, d, a, w[ 4], 20, 0xe7d3fbc8)
+        CRACKER_MD5_STEP(G, a, b, c, d, w[ 9],  5, 0x21e1cde6) CRACKER_MD5_STEP(G, d, a, b, c, w[14],  9, 0xc33707d6)
+        CRACKER_MD5_STEP(G, c, d, a, b, w[ 3], 14, 0xf4d50d87) CRACKER_MD5_STEP(G, b, c, d, a, w[ 8], 20, 0x455a14ed)
+        CRACKER_MD5_STEP(G, a, b, c, d, w[13],  5, 0xa9e3e905) CRACKER_MD5_STEP(G, d, a, b, c, w[ 2],  9, 0xfcefa3f8)
+        CRACKER_MD5_STEP(G, c, d, a, b, w[ 7], 14, 0x676f02d9) CRACKER_MD5_STEP(G, b, c, d, a, w[12], 20, 0x8d2a4c8a)
+
+        //Round 3
+        CRACKER_MD5_STEP(H, a, b, c, d, w[ 5],  4, 0xfffa3942) CRACKER_MD5_STEP(H, d, a, b, c, w[ 8], 11, 0x8771f681)
+        CRACKER_MD5_STEP(H, c, d, a, b, w[11], 16, 0x6d9d6122) CRACKER_MD5_STEP(H, b, c, d, a, w[14], 23, 0xfde5380c)
+        CRACKER_MD5_STEP(H, a, b, c, d, w[ 1],  4, 0xa4beea44) CRACKER_MD5_STEP(H, d, a, b, c, w[ 4], 11, 0x4bdecfa9)
+        CRACKER_MD5_STEP(H, c, d, a, b, w[ 7], 16, 0xf6bb4b60) CRACKER_MD5_STEP(H, b, c, d, a, w[10], 23, 0xbebfbc70)
+        CRACKER_MD5_STEP(H, a, b, c, d, w[13],  4, 0x289b7ec6) CRACKER_MD5_STEP(H, d, a, b, c, w[ 0], 11, 0xeaa127fa)
+        CRACKER_MD5_STEP(H, c, d, a, b, w[ 3], 16, 0xd4ef3085) CRACKER_MD5_STEP(H, b, c, d, a, w[ 6], 23, 0x04881d05)
+        CRACKER_MD5_STEP(H, a, b, c, d, w[ 9],  4, 0xd9d4d039) CRACKER_MD5_STEP(H, d, a, b, c, w[12], 11, 0xe6db99e5)
+        CRACKER_MD5_STEP(H, c, d, a, b, w[15], 16, 0x1fa27cf8) CRACKER_MD5_STEP(H, b, c, d, a, w[ 2], 23, 0xc4ac5665)
+
+        //Round 4
+        CRACKER_MD5_STEP(I, a, b, c, d, w[ 0],  6, 0xf4292244) CRACKER_MD5_STEP(I, d, a, b, c, w[ 7], 10, 0x432aff97)
+        CRACKER_MD5_STEP(I, c, d, a, b, w[14], 15, 0xab9423a7) CRACKER_MD5_STEP(I, b, c, d, a, w[ 5], 21, 0xfc93a039)
+        CRACKER_MD5_STEP(I, a, b, c, d, w[12],  6, 0x655b59c3) CRACKER_MD5_STEP(I, d, a, b, c, w[ 3], 10, 0x8f0ccc92)
+        CRACKER_MD5_STEP(I, c, d, a, b, w[10], 15, 0xffeff47d) CRACKER_MD5_STEP(I, b, c, d, a, w[ 1], 21, 0x85845dd1)
+        CRACKER_MD5_STEP(I, a, b, c, d, w[ 8],  6, 0x6fa87e4f) CRACKER_MD5_STEP(I, d, a, b, c, w[15], 10, 0xfe2ce6e0)
+        CRACKER_MD5_STEP(I, c, d, a, b, w[ 6], 15, 0xa3014314) CRACKER_MD5_STEP(I, b, c, d, a, w[13], 21, 0x4e0811a1)
+        CRACKER_MD5_STEP(I, a, b, c, d, w[ 4],  6, 0xf7537e82) CRACKER_MD5_STEP(I, d, a, b, c, w[11], 10, 0xbd3af235)
+        CRACKER_MD5_STEP(I, c, d, a, b, w[ 2], 15, 0x2ad7d2bb) CRACKER_MD5_STEP(I, b, c, d, a, w[ 9], 21, 0xeb86d391)
+
+        out[0] = a + 0x67452301u;
+        out[1] = b + 0xefcdab89u;
+        out[2] = c + 0x98badcfeu;
+        out[3] = d + 0x10325476u;
+    }
+
+    #undef CRACKER_MD5_STEP
+
+
+    // ***** HELPERS ***** //
+
+    //Longest message that fits into one padded MD5 block (55 bytes + 0x80 + 8 byte bit length)
+    constexpr std::size_t max_block_message = 55;
+
+    //Pad a message of at most 55 bytes into 16 little-endian words
+    inline void pad_block(const char* message, std::size_t length, std::uint32_t w[16]) noexcept
+    {
+        unsigned char bytes[64] = {};
+        std::memcpy(bytes, message, length);
+        bytes[length] = 0x80;
+
+        for(std::size_t i=0; i < 16; ++i)
+            w[i] = bytes[4*i] | (bytes[4*i + 1] << 8) | (bytes[4*i + 2] << 16) | (static_cast<std::uint32_t>(bytes[4*i + 3]) << 24);
+
+        w[14] = static_cast<std::uint32_t>(length * 8);
+    }
+
+    //Convert the four state words of one lane into the digest byte order
+    inline digest words_to_digest(std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t d) noexcept
+    {
+        digest result;
+        const std::uint32_t words[4] = {a, b, c, d};
+
+        for(std::size_t i=0; i < 4; ++i)
+        {
+            result[4*i]     = static_cast<std::uint8_t>(words[i]);
+            result[4*i + 1] = static_cast<std::uint8_t>(words[i] >> 8);
+            result[4*i + 2] = static_cast<std::uint8_t>(words[i] >> 16);
+            result[4*i + 3] = static_cast<std::uint8_t>(words[i] >> 24);
+        }
+
+        return result;
+    }
+
+    //MD5 of a short message (<= 55 bytes) with the single-block scalar kernel
+    inline digest md5_short(const char* message, std::size_t length) noexcept
+    {
+        std::uint32_t w[16], out[4];
+        pad_block(message, length, w);
+        md5_compress(w, out);
+        return words_to_digest(out[0], out[1], out[2], out[3]);
+    }
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,174 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //sysfs paths
+#include <string_view>          //CPU lists
+#include <vector>              //Nodes and their CPUs
+#include <fstream>            //Reading sysfs
+#include <algorithm>         //std::fill
+#include <stdexcept>        //std::invalid_argument
+#include <utility>         //std::pair
+#include <cstddef>        //std::size_t
+
+//Native POSIX Libraries
+#include <sched.h>      //sched_getaffinity(), cpu_set_t
+
+namespace cracker
+{
+    //Class 'Topology' lists the NUMA nodes of the host and the CPUs of each, as the kernel reports them in /sys/devices/system/node
+    //(only the CPUs this process is allowed to run on). Without that directory -- or without NUMA -- the host is a single node.
+    class Topology final
+    {
+        private:
+            std::vector<std::vector<int>> nodes;     //CPUs of every node (nodes without usable CPUs are left out)
+
+        public:
+            //Special methods
+            explicit Topology(const std::string& = "/sys/devices/system/node");
+
+            //General methods
+            [[nodiscard]] std::size_t size() const noexcept;
+            [[nodiscard]] const std::vector<int>& cpus(std::size_t) const;
+            [[nodiscard]] std::vector<std::pair<int, std::size_t>> placement(unsigned) const;
+    };
+
+    std::vector<int> parse_cpulist(std::string_view);
+
+
+    // ***** HELPERS ***** //
+
+    //Parse a kernel CPU list ("0-3,8-11", "5", "") -- CAN THROW std::invalid_argument
+    inline std::vector<int> parse_cpulist(std::string_view list)
+    {
+        std::vector<int> cpus;
+
+        while (not list.empty() and (list.back() == '\n' or list.back() == ' '))
+            list.remove_suffix(1);
+
+        auto number = [&list](std::size_t& pos)
+                      {
+                          if (pos >= list.size() or list[pos] < '0' or list[pos] > '9')
+                              throw std::invalid_argument("invalid CPU list \"" + std::string(list) + "\"");
+
+                          int value = 0;
+                          for(; pos < list.size() and list[pos] >= '0' and list[pos] <= '9'; ++pos)
+                              value = value * 10 + (list[pos] - '0');
+
+                          return value;
+                      };
+
+        for(std::size_t pos = 0; pos < list.size();)
+        {
+            int first = number(pos), last = first;
+
+            if (pos < list.size() and list[pos] == '-')
+                last = number(++pos);
+
+            if (pos < list.size() and list[pos] != ',')
+                throw std::invalid_argument("invalid CPU list \"" + std::string(list) + "\"");
+
+            for(int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+
+            pos += (pos < list.size());
+        }
+
+        return cpus;
+    }
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: read the nodes under 'root' ("node0", "node1", ...), keeping the CPUs of the process's affinity mask
+    inline Topology::Topology(const std::string& root)
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+
+        if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            for(int cpu=0; cpu < CPU_SETSIZE; ++cpu)
+                CPU_SET(cpu, &allowed);
+
+        //Node numbers can have gaps (e.g. after hot-removal), so every number up to the last CPU slot is tried
+        for(int node=0; node < CPU_SETSIZE; ++node)
+        {
+            std::ifstream file(root + "/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+
+            if (not file.is_open() or not std::getline(file, list))
+                continue;
+
+            std::vector<int> usable;
+
+            try
+            {
+                for(int cpu : parse_cpulist(list))
+                    if (cpu < CPU_SETSIZE and CPU_ISSET(cpu, &allowed))
+                        usable.push_back(cpu);
+            }
+            catch (const std::invalid_argument&)
+            {
+                continue;
+            }
+
+            if (not usable.empty())
+                nodes.push_back(std::move(usable));
+        }
+
+        //No NUMA information: one node with every allowed CPU
+        if (nodes.empty())
+        {
+            nodes.emplace_back();
+
+            for(int cpu=0; cpu < CPU_SETSIZE; ++cpu)
+                if (CPU_ISSET(cpu, &allowed))
+                    nodes.back().push_back(cpu);
+
+            if (nodes.back().empty())
+                nodes.back().push_back(0);
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the number of nodes (at least one)
+    [[nodiscard]] inline std::size_t Topology::size() const noexcept
+    {
+        return nodes.size();
+    }
+
+    //Return the CPUs of a node -- CAN THROW std::out_of_range
+    [[nodiscard]] inline const std::vector<int>& Topology::cpus(std::size_t node) const
+    {
+        return nodes.at(node);
+    }
+
+    //Return the (CPU, node) of each of 'threads' workers: consecutive workers go to different nodes, so any number of threads is spread
+    //evenly over the sockets, and no CPU gets a second thread before every CPU has one
+    [[nodiscard]] inline std::vector<std::pair<int, std::size_t>> Topology::placement(unsigned threads) const
+    {
+        std::vector<std::pair<int, std::size_t>> placed;
+        std::vector<std::size_t> used(nodes.size(), 0);
+        std::size_t node = 0;
+
+        while (placed.size() < threads)
+        {
+            std::size_t tries = 0;
+
+            while (tries < nodes.size() and used[node] == nodes[node].size())
+            {
+                node = (node + 1) % nodes.size();
+                ++tries;
+            }
+
+            if (tries == nodes.size())      //Every CPU has a thread: start over
+                std::fill(used.begin(), used.end(), 0);
+
+            placed.emplace_back(nodes[node][used[node]++], node);
+            node = (node + 1) % nodes.size();
+        }
+
+        return placed;
+    }
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+//Native C++ Libraries
+#include <vector>                //The threads
+#include <thread>               //Worker threads
+#include <mutex>               //Guards the task and the counters
+#include <condition_variable> //Waking the workers, waiting for them
+#include <functional>        //The task
+#include <cstddef>          //std::size_t
+#include <cstdint>         //Task generations
+#include <utility>        //std::pair
+#include <algorithm>     //std::max
+
+//Native POSIX Libraries
+#include <pthread.h>    //pthread_setaffinity_np()
+#include <sched.h>     //cpu_set_t
+
+namespace cracker
+{
+    //Class 'ThreadPool' keeps a fixed number of worker threads alive between attacks, so a long-lived session does not pay for thread
+    //creation on every job. start() hands one task to every thread at once -- task(id) runs once on each of them, with id = 0..size()-1
+    //(the worker ids the schedulers expect) -- and wait() returns when all of them are done. The threads are created on the first start().
+    //pin() binds every thread to one CPU and records its NUMA node, so workers can pick data that lives on their own node.
+    class ThreadPool final
+    {
+        private:
+            std::vector<std::thread> threads;
+            unsigned count;                                    //Number of threads
+            std::mutex lock;                                  //Guards everything below
+            std::condition_variable wake;                    //A new task (or the destructor) is waiting
+            std::condition_variable done;                   //The last thread finished the task
+            std::function<void(std::size_t)> task;         //Task of the current generation
+            std::uint64_t generation = 0;                 //Incremented by every start()
+            unsigned busy = 0;                           //Threads still running the current task
+            bool closing = false;                       //Set by the destructor
+            std::vector<std::pair<int, std::size_t>> placement;    //(CPU, NUMA node) of every thread (empty: not pinned)
+
+            void loop(std::size_t);
+            void bind(std::size_t, pthread_t);
+
+        public:
+            //Special methods
+            explicit ThreadPool(unsigned);
+            ~ThreadPool();
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            //General methods
+            [[nodiscard]] unsigned size() const noexcept;
+            void pin(std::vector<std::pair<int, std::size_t>>);
+            [[nodiscard]] std::size_t node(std::size_t) const noexcept;
+            [[nodiscard]] std::size_t nodes() const noexcept;
+            void start(std::function<void(std::size_t)>);
+            [[nodiscard]] bool running();
+            void wait();
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: a pool of 'in_count' threads (at least one)
+    inline ThreadPool::ThreadPool(unsigned in_count) : count(in_count != 0 ? in_count : 1)
+    {
+    }
+
+    //Destructor: let the threads finish their task, then stop them
+    inline ThreadPool::~ThreadPool()
+    {
+        wait();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closing = true;
+        }
+
+        wake.notify_all();
+
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Body of every thread: run each new task once
+    inline void ThreadPool::loop(std::size_t id)
+    {
+        std::uint64_t seen = 0;
+
+        //Pinned before the first task, so everything the thread allocates is placed on its own node
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            bind(id, ::pthread_self());
+        }
+
+        while (true)
+        {
+            std::function<void(std::size_t)>* current;
+
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&]() { return closing or generation != seen; });
+
+                if (closing)
+                    return;
+
+                seen = generation;
+                current = &task;
+            }
+
+            (*current)(id);   //start() does not replace the task before every thread is done with it
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+
+    //Bind thread 'id' to its CPU, with 'lock' held (a failure -- e.g. a CPU taken away by a cgroup -- leaves the thread floating)
+    inline void ThreadPool::bind(std::size_t id, pthread_t thread)
+    {
+        if (id >= placement.size())
+            return;
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement[id].first, &cpus);
+        ::pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the number of threads
+    [[nodiscard]] inline unsigned ThreadPool::size() const noexcept
+    {
+        return count;
+    }
+
+    //Bind thread i to the CPU placement[i].first of NUMA node placement[i].second (threads past the end of the list float); threads that
+    //already run are moved right away, the others are bound when they are created
+    inline void ThreadPool::pin(std::vector<std::pair<int, std::size_t>> new_placement)
+    {
+        wait();
+
+        std::lock_guard<std::mutex> guard(lock);
+        placement = std::move(new_placement);
+
+        for(std::size_t id=0; id < threads.size(); ++id)
+            bind(id, threads[id].native_handle());
+    }
+
+    //Return the NUMA node of a thread (0 when the pool is not pinned)
+    [[nodiscard]] inline std::size_t ThreadPool::node(std::size_t id) const noexcept
+    {
+        return (id < placement.size() ? placement[id].second : 0);
+    }
+
+    //Return the number of NUMA nodes the threads are spread over (1 when the pool is not pinned)
+    [[nodiscard]] inline std::size_t ThreadPool::nodes() const noexcept
+    {
+        std::size_t count = 1;
+
+        for(const auto& [cpu, node] : placement)
+            count = std::max(count, node + 1);
+
+        return count;
+    }
+
+    //Run 'new_task(id)' on every thread (waits for the previous task first)
+    inline void ThreadPool::start(std::function<void(std::size_t)> new_task)
+    {
+        wait();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            task = std::move(new_task);
+            busy = count;
+            ++generation;
+        }
+
+        for(std::size_t id = threads.size(); id < count; ++id)
+            threads.emplace_back([this, id]() { loop(id); });
+
+        wake.notify_all();
+    }
+
+    //Return whether any thread is still running the current task
+    [[nodiscard]] inline bool ThreadPool::running()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return busy != 0;
+    }
+
+    //Wait until every thread is done with the current task
+    inline void ThreadPool::wait()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&]() { return busy == 0; });
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+//Native C++ Libraries
+#include <iostream>              //The progress line goes to std::cout (it is skipped by 'awk NR > 3')
+#include <iomanip>              //Formatting percentages and rates
+#include <chrono>              //Speed and ETA
+#include <cstdint>            //Candidate counts
+
+namespace cracker
+{
+    //Class 'Progress' prints a single self-overwriting progress line: candidates tested, percentage, speed and ETA.
+    //The line is redrawn at most a few times per second, so calling update() for every candidate is cheap.
+    class Progress final
+    {
+        private:
+            using clock = std::chrono::steady_clock;
+
+            std::uint64_t total;                      //Size of the keyspace (0 if unknown, e.g. a dictionary)
+            std::uint64_t start;                     //Candidates already tested when this run started (restored sessions)
+            clock::time_point started;              //When this run started
+            clock::time_point next_draw;           //When the line may be redrawn
+
+            void draw(std::uint64_t);
+
+        public:
+            //Special methods
+            explicit Progress(std::uint64_t = 0, std::uint64_t = 0);
+
+            //General methods
+            void update(std::uint64_t);
+            void refresh(std::uint64_t);
+            void finish(std::uint64_t);
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor
+    inline Progress::Progress(std::uint64_t in_total, std::uint64_t in_start)
+        : total(in_total), start(in_start), started(clock::now()), next_draw(started)
+    {
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Redraw the line
+    inline void Progress::draw(std::uint64_t done)
+    {
+        double seconds = std::chrono::duration<double>(clock::now() - started).count();
+        double speed = (seconds > 0 ? (done - start) / seconds : 0.0);
+
+        std::cout << "Progress: " << done;
+
+        if (total != 0)
+        {
+            std::cout << '/' << total << " (" << std::fixed << std::setprecision(2) << (100.0 * done / total) << "%)";
+        }
+
+        std::cout << " | " << std::fixed << std::setprecision(2) << speed / 1e6 << " MH/s";
+
+        if (total != 0 and speed > 0)
+        {
+            auto eta = static_cast<std::uint64_t>((total - done) / speed);
+            std::cout << " | ETA " << std::setfill('0') << std::setw(2) << eta / 3600 << ':' << std::setw(2) << (eta / 60) % 60
+                      << ':' << std::setw(2) << eta % 60 << std::setfill(' ');
+        }
+
+        std::cout << "   \r" << std::flush;   // '\r' overwrites the current line, acting as a progress bar
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Report that 'done' candidates have been tested (the clock is only read every 4096 candidates)
+    inline void Progress::update(std::uint64_t done)
+    {
+        if ((done & 0xfff) == 0)
+            refresh(done);
+    }
+
+    //Report that 'done' candidates have been tested (for callers that only report every now and then, e.g. a monitor thread)
+    inline void Progress::refresh(std::uint64_t done)
+    {
+        if (clock::now() >= next_draw)
+        {
+            draw(done);
+            next_draw = clock::now() + std::chrono::milliseconds(250);
+        }
+    }
+
+    //Draw the final state and end the line
+    inline void Progress::finish(std::uint64_t done)
+    {
+        draw(done);
+        std::cout << '\n';
+    }
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+//Native C++ Libraries
+#include <vector>                //One queue per worker
+#include <deque>                //Ranges owned by a worker
+#include <mutex>               //Per-queue locks
+#include <memory>             //std::unique_ptr (mutexes cannot be moved)
+#include <algorithm>         //std::sort, std::clamp
+#include <cstdint>          //64-bit indices/offsets
+
+namespace cracker
+{
+    //Half-open range [begin, end) of keyspace indices or dictionary bytes
+    struct Range
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+
+        [[nodiscard]] std::uint64_t size() const noexcept { return end - begin; }
+        [[nodiscard]] bool empty() const noexcept { return begin >= end; }
+    };
+
+    [[nodiscard]] std::vector<Range> subtract(std::vector<Range>, std::vector<Range>);
+
+    //Class 'Scheduler' hands out chunks of a keyspace to worker threads. Every worker starts with a contiguous share of the work
+    //and takes chunks from the front of it; a worker that runs dry steals the back half of the busiest worker's share, so threads
+    //slowed down by noisy neighbours do not hold up the others. The unfinished work can be snapshotted at any time for checkpoints.
+    class Scheduler final
+    {
+        private:
+            struct alignas(64) Queue
+            {
+                std::mutex lock;               //Held by the owner, by thieves and by snapshots
+                std::deque<Range> ranges;     //Work owned by this worker that has not been started
+                Range active{0, 0};          //Chunk the worker is currently testing
+            };
+
+            std::vector<std::unique_ptr<Queue>> queues;    //One queue per worker
+            std::uint64_t chunk;                          //Number of indices handed out at once
+
+            bool steal(std::size_t);
+
+        public:
+            //Special methods
+            Scheduler(const std::vector<Range>&, std::size_t, std::uint64_t);
+
+            //General methods
+            bool next(std::size_t, Range&);
+            void release(std::size_t, std::uint64_t);
+            [[nodiscard]] std::vector<Range> remaining() const;
+            [[nodiscard]] std::size_t workers() const noexcept;
+
+            //Chunk size: small enough for every worker to get hundreds of chunks, large enough to amortize the locking
+            [[nodiscard]] static std::uint64_t chunk_size(std::uint64_t, std::size_t, std::uint64_t = 1 << 12, std::uint64_t = 1 << 20) noexcept;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: split the work into one contiguous share per worker
+    inline Scheduler::Scheduler(const std::vector<Range>& work, std::size_t worker_count, std::uint64_t chunk_size)
+        : chunk(std::max<std::uint64_t>(chunk_size, 1))
+    {
+        std::uint64_t total = 0;
+        worker_count = std::max<std::size_t>(worker_count, 1);
+
+        for(const Range& range : work)
+            total += range.size();
+
+        for(std::size_t i=0; i < worker_count; ++i)
+            queues.push_back(std::make_unique<Queue>());
+
+        //Walk the ranges, giving every worker total/workers indices (the first workers get the remainder)
+        std::size_t worker = 0;
+        std::uint64_t share = total / worker_count + (total % worker_count != 0);
+        std::uint64_t assigned = 0;
+
+        for(Range range : work)
+        {
+            while (not range.empty())
+            {
+                std::uint64_t take = std::min(range.size(), share - assigned);
+                queues[worker]->ranges.push_back({range.begin, range.begin + take});
+                range.begin += take;
+                assigned += take;
+
+                if (assigned == share and worker + 1 < worker_count)
+                {
+                    ++worker;
+                    assigned = 0;
+                }
+            }
+        }
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Move the back half of the busiest other worker's share to 'thief' (false if there is nothing left anywhere)
+    inline bool Scheduler::steal(std::size_t thief)
+    {
+        while (true)
+        {
+            //Find the victim with the most unstarted work (sizes are read under each lock, so they are only a hint)
+            std::size_t victim = queues.size();
+            std::uint64_t most = 0;
+
+            for(std::size_t i=0; i < queues.size(); ++i)
+            {
+                if (i == thief)
+                    continue;
+
+                std::lock_guard<std::mutex> guard(queues[i]->lock);
+                std::uint64_t size = 0;
+
+                for(const Range& range : queues[i]->ranges)
+                    size += range.size();
+
+                if (size > most)
+                {
+                    most = size;
+                    victim = i;
+                }
+            }
+
+            if (victim == queues.size())
+                return false;
+
+            //Lock both queues at once, so a concurrent snapshot never sees the stolen work in neither of them
+            std::scoped_lock guard(queues[victim]->lock, queues[thief]->lock);
+            std::deque<Range>& from = queues[victim]->ranges;
+
+            if (from.empty())   //Somebody else got there first, look again
+                continue;
+
+            if (from.size() > 1)
+            {
+                //Several ranges: take the back half of them whole
+                std::size_t keep = from.size() / 2;
+                queues[thief]->ranges.insert(queues[thief]->ranges.end(), from.begin() + keep, from.end());
+                from.erase(from.begin() + keep, from.end());
+            }
+            else
+            {
+                //One range: split it, keeping at least one chunk for the victim
+                Range& range = from.front();
+
+                if (range.size() <= chunk)
+                {
+                    queues[thief]->ranges.push_back(range);
+                    from.clear();
+                }
+                else
+                {
+                    std::uint64_t middle = range.begin + std::max(chunk, range.size() / 2);
+                    queues[thief]->ranges.push_back({middle, range.end});
+                    range.end = middle;
+                }
+            }
+
+            return true;
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Hand the next chunk to a worker (marking its previous chunk as finished); returns false when all the work is done
+    inline bool Scheduler::next(std::size_t worker, Range& out)
+    {
+        Queue& queue = *queues[worker];
+
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.active = {0, 0};
+
+                if (not queue.ranges.empty())
+                {
+                    Range& front = queue.ranges.front();
+                    out = {front.begin, std::min(front.end, front.begin + chunk)};
+                    front.begin = out.end;
+
+                    if (front.empty())
+                        queue.ranges.pop_front();
+
+                    queue.active = out;
+                    return true;
+                }
+            }
+
+            if (not steal(worker))
+                return false;
+        }
+    }
+
+    //A worker stops in the middle of its chunk: [position, end of chunk) stays part of the unfinished work
+    inline void Scheduler::release(std::size_t worker, std::uint64_t position)
+    {
+        std::lock_guard<std::mutex> guard(queues[worker]->lock);
+        queues[worker]->active.begin = std::max(queues[worker]->active.begin, position);
+    }
+
+    //Snapshot of all the unfinished work (chunks in progress included), sorted and with adjacent ranges merged
+    [[nodiscard]] inline std::vector<Range> Scheduler::remaining() const
+    {
+        std::vector<std::unique_lock<std::mutex>> guards;
+        std::vector<Range> work;
+
+        for(const auto& queue : queues)
+            guards.emplace_back(queue->lock);
+
+        for(const auto& queue : queues)
+        {
+            if (not queue->active.empty())
+                work.push_back(queue->active);
+
+            work.insert(work.end(), queue->ranges.begin(), queue->ranges.end());
+        }
+
+        guards.clear();
+
+        std::sort(work.begin(), work.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+        std::vector<Range> merged;
+        for(const Range& range : work)
+        {
+            if (not merged.empty() and merged.back().end == range.begin)
+                merged.back().end = range.end;
+            else
+                merged.push_back(range);
+        }
+
+        return merged;
+    }
+
+    //Return the number of workers
+    [[nodiscard]] inline std::size_t Scheduler::workers() const noexcept
+    {
+        return queues.size();
+    }
+
+    //Chunk size for a keyspace of 'total' indices shared by 'workers' threads (about 256 chunks per worker, clamped)
+    [[nodiscard]] inline std::uint64_t Scheduler::chunk_size(std::uint64_t total, std::size_t workers, std::uint64_t smallest, std::uint64_t largest) noexcept
+    {
+        return std::clamp<std::uint64_t>(total / (std::max<std::size_t>(workers, 1) * 256), smallest, largest);
+    }
+
+
+    // ***** RANGES ***** //
+
+    //Return the parts of 'work' that are not in 'done' (e.g. what an interrupted pass covered: its work minus what it left), sorted
+    [[nodiscard]] inline std::vector<Range> subtract(std::vector<Range> work, std::vector<Range> done)
+    {
+        auto by_begin = [](const Range& a, const Range& b) { return a.begin < b.begin; };
+        std::vector<Range> rest;
+
+        std::sort(work.begin(), work.end(), by_begin);
+        std::sort(done.begin(), done.end(), by_begin);
+
+        for(Range range : work)
+        {
+            for(const Range& cut : done)
+            {
+                if (cut.end <= range.begin or cut.empty())
+                    continue;
+                if (cut.begin >= range.end)
+                    break;
+
+                if (cut.begin > range.begin)
+                    rest.push_back({range.begin, cut.begin});
+
+                range.begin = std::max(range.begin, cut.end);
+                if (range.empty())
+                    break;
+            }
+
+            if (not range.empty())
+                rest.push_back(range);
+        }
+
+        return rest;
+    }
+}
@@ -0,0 +1,601 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                    //Candidates, kernel names
+#include <string_view>              //Escaping failed candidates
+#include <vector>                  //Plans, keyspace charsets, results
+#include <unordered_map>          //Expected cracks of a round
+#include <utility>               //std::pair
+#include <ostream>              //Failed candidates are reported as they are found
+#include <iomanip>             //Summary table
+#include <random>              //Fuzzed candidates
+#include <algorithm>          //std::min
+#include <cstdint>           //Counters
+#include <cstdio>           //std::snprintf
+
+//External Libraries (dependencies)
+#include "../hashlib++_md5/hashlibpp.h"     //md5wrapper (reference implementation and its own self-test)
+
+//Custom Libraries
+#include "digest.hpp"
+#include "md5_lanes.hpp"
+#include "targets.hpp"
+#include "batch.hpp"
+#include "brute_lanes.hpp"
+#include "../permuter/permute.hpp"
+#include "../permuter/markov.hpp"
+
+namespace cracker
+{
+    //One kernel's result of '--selftest'
+    struct SelfTestResult
+    {
+        std::string kernel;                 //"hashlib", "scalar", "simd8 add", "brute16"...
+        std::uint64_t cases = 0;           //Candidates checked
+        std::uint64_t failures = 0;       //Candidates whose digest (or crack) differed from the reference
+    };
+
+    //Class 'SelfTest' checks every MD5 kernel against the RFC 1321 test vectors and against hashlib++'s hl_md5.cpp (the reference):
+    //  hashlib:  md5wrapper's own test() and the vectors, then cracker::md5 against md5wrapper on random messages of 0-200 bytes
+    //  scalar:   md5_short on every length that fits one block
+    //  simd*:    Batch<4/8/16> through add(), fix()/add_tail(), fix_tail()/add_head() and a random mix of the three, with every message
+    //            length 0-200, every head/tail length, and batches of 1-16 candidates (so every lane position and every tail size)
+    //  brute*:   BruteLanes<4/8/16> on keyspaces of length 1-55 (plain and Markov ordered) over random [begin, end) ranges
+    //The SIMD kernels only report cracks, so every candidate of a round is made a target: a candidate passes if it is cracked exactly as
+    //often as it was queued, with the reference digest and hash. Candidates use every byte value but '\0'. The seed is fixed, so a
+    //failure can be reproduced.
+    class SelfTest final
+    {
+        private:
+            static constexpr unsigned max_reported = 5;     //Failed candidates printed per kernel
+            static constexpr std::size_t max_length = 200;  //Longest fuzzed message
+
+            //One step of a Batch plan
+            struct Op
+            {
+                enum class Kind { add, fix, add_tail, fix_tail, add_head, flush } kind;
+                std::string text;
+                std::size_t length = 0;     //Head length of fix_tail()
+            };
+
+            //A sequence of Batch calls and the candidates they queue
+            struct Plan
+            {
+                std::string name;
+                std::vector<Op> ops;
+                std::vector<std::string> plaintexts;
+            };
+
+            //Targets of one round: plaintext -> (times queued, times cracked)
+            struct Round
+            {
+                std::unordered_map<std::string, std::pair<std::uint64_t, std::uint64_t>> counts;
+                TargetTable targets;
+            };
+
+            std::mt19937_64 random;
+            std::ostream& log;                          //Failed candidates are reported here
+            std::vector<SelfTestResult> results;
+
+            static const std::vector<std::pair<std::string, std::string>>& vectors();
+            static digest reference(const std::string&);
+            static std::string escape(std::string_view);
+
+            std::string random_text(std::size_t);
+            std::size_t random_length(std::size_t);
+            void fail(SelfTestResult&, const std::string&, const std::string&);
+            void compare(SelfTestResult&, const std::string&, const digest&, const digest&);
+
+            void expect(Round&, const std::string&, std::uint64_t);
+            void crack(Round&, SelfTestResult&, const std::string&, const digest&, const std::string&);
+            void finish(Round&, SelfTestResult&);
+
+            void test_hashlib();
+            void test_scalar();
+            std::vector<Plan> batch_plans();
+
+            template <std::size_t Lanes>
+            void test_batch(const Plan&);
+
+            template <std::size_t Lanes>
+            void test_brute(const std::string&, const Permute::Keyspace&, std::uint64_t, std::uint64_t);
+
+            template <std::size_t Lanes>
+            void test_brute();
+
+        public:
+            //Special methods
+            explicit SelfTest(std::ostream&);
+
+            //General methods
+            bool run();
+            [[nodiscard]] const std::vector<SelfTestResult>& summary() const noexcept;
+            void print(std::ostream&) const;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: failures are reported to 'out' as they are found
+    inline SelfTest::SelfTest(std::ostream& out) : random(1321), log(out)
+    {
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //The test suite of RFC 1321 (appendix A.5), plus the string of hashlib++'s own test()
+    inline const std::vector<std::pair<std::string, std::string>>& SelfTest::vectors()
+    {
+        static const std::vector<std::pair<std::string, std::string>> suite = {
+            {"", "d41d8cd98f00b204e9800998ecf8427e"},
+            {"a", "0cc175b9c0f1b6a831c399e269772661"},
+            {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+            {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+            {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+            {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+            {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"},
+            {"The quick brown fox jumps over the lazy dog", "9e107d9d372bb6826bd81d3542a419d6"}
+        };
+
+        return suite;
+    }
+
+    //Return the digest a kernel must produce: the published one for the test vectors, hl_md5.cpp's for everything else
+    inline digest SelfTest::reference(const std::string& plaintext)
+    {
+        for(const auto& [message, hex] : vectors())
+            if (message == plaintext)
+                return *parse_digest(hex);
+
+        return md5(plaintext);
+    }
+
+    //Make a candidate printable (non-printable bytes as \xNN)
+    inline std::string SelfTest::escape(std::string_view text)
+    {
+        std::string out;
+
+        for(unsigned char c : text)
+        {
+            if (c >= ' ' and c <= '~' and c != '\\')
+                out += static_cast<char>(c);
+            else
+            {
+                char code[5];
+                std::snprintf(code, sizeof(code), "\\x%02x", c);
+                out += code;
+            }
+        }
+
+        return out;
+    }
+
+    //Return 'length' random bytes (1-255: a '\0' could not come from a wordlist line or a charset anyway)
+    inline std::string SelfTest::random_text(std::size_t length)
+    {
+        std::uniform_int_distribution<int> byte(1, 255);
+        std::string text(length, ' ');
+
+        for(char& c : text)
+            c = static_cast<char>(byte(random));
+
+        return text;
+    }
+
+    //Return a random length up to 'max' (half of them short enough for the single-block kernels)
+    inline std::size_t SelfTest::random_length(std::size_t max)
+    {
+        const std::size_t limit = (random() % 2 == 0 ? std::min(max, max_block_message) : max);
+        return static_cast<std::size_t>(random() % (limit + 1));
+    }
+
+    //Count a failed candidate (and print the first few of every kernel)
+    inline void SelfTest::fail(SelfTestResult& result, const std::string& plaintext, const std::string& detail)
+    {
+        if (result.failures++ < max_reported)
+            log << "***MISMATCH*** " << result.kernel << ": \"" << escape(plaintext) << "\" (length " << plaintext.size() << "): " << detail << '\n';
+    }
+
+    //Compare the digest of a kernel with the reference
+    inline void SelfTest::compare(SelfTestResult& result, const std::string& plaintext, const digest& got, const digest& expected)
+    {
+        ++result.cases;
+
+        if (got != expected)
+            fail(result, plaintext, "got " + to_hex(got) + ", expected " + to_hex(expected));
+    }
+
+    //Make a candidate a target of the round, expected to be cracked 'times' times (0: it is outside the tested range)
+    inline void SelfTest::expect(Round& round, const std::string& plaintext, std::uint64_t times)
+    {
+        const digest d = reference(plaintext);
+
+        round.counts[plaintext].first += times;
+        round.targets.insert(d, to_hex(d));
+    }
+
+    //Check a crack reported by a kernel
+    inline void SelfTest::crack(Round& round, SelfTestResult& result, const std::string& hash, const digest& d, const std::string& plaintext)
+    {
+        auto itr = round.counts.find(plaintext);
+
+        if (itr == round.counts.end())
+            fail(result, plaintext, "cracked " + hash + " with a candidate that was never queued");
+        else if (d != reference(plaintext) or hash != to_hex(d))
+            fail(result, plaintext, "cracked " + hash + " with digest " + to_hex(d) + ", expected " + to_hex(reference(plaintext)));
+        else
+            ++itr->second.second;
+    }
+
+    //Check that every candidate of the round was cracked exactly as often as it was queued
+    inline void SelfTest::finish(Round& round, SelfTestResult& result)
+    {
+        for(const auto& [plaintext, count] : round.counts)
+        {
+            result.cases += count.first;
+
+            if (count.first != count.second)
+                fail(result, plaintext, "cracked " + std::to_string(count.second) + " times, expected " + std::to_string(count.first));
+        }
+
+        results.push_back(result);
+    }
+
+    //hashlib++ itself: md5wrapper::test(), the vectors, and cracker::md5 (MD5Init/MD5Update/MD5Final without the hex step) against it
+    inline void SelfTest::test_hashlib()
+    {
+        SelfTestResult result{"hashlib", 0, 0};
+        md5wrapper wrapper;
+
+        ++result.cases;
+        try
+        {
+            wrapper.test();
+        }
+        catch (hlException& error)
+        {
+            fail(result, "", "md5wrapper::test(): " + error.error_message());
+        }
+
+        for(const auto& [message, hex] : vectors())
+        {
+            compare(result, message, *parse_digest(wrapper.getHashFromString(message)), *parse_digest(hex));
+            compare(result, message, md5(message), *parse_digest(hex));
+        }
+
+        for(std::size_t length=0; length <= max_length; ++length)
+        {
+            for(int i=0; i < 8; ++i)
+            {
+                const std::string message = random_text(length);
+                compare(result, message, md5(message), *parse_digest(wrapper.getHashFromString(message)));
+            }
+        }
+
+        results.push_back(result);
+    }
+
+    //The scalar single-block kernel on every length it accepts
+    inline void SelfTest::test_scalar()
+    {
+        SelfTestResult result{"scalar", 0, 0};
+
+        for(const auto& [message, hex] : vectors())
+            if (message.size() <= max_block_message)
+                compare(result, message, md5_short(message.data(), message.size()), *parse_digest(hex));
+
+        for(std::size_t length=0; length <= max_block_message; ++length)
+        {
+            for(int i=0; i < 64; ++i)
+            {
+                const std::string message = random_text(length);
+                compare(result, message, md5_short(message.data(), message.size()), md5(message));
+            }
+        }
+
+        results.push_back(result);
+    }
+
+    //Build the Batch plans (the same calls are replayed on every SIMD width). Batches of 1-16 candidates followed by a flush cover
+    //every lane position and every tail size of all widths.
+    inline std::vector<SelfTest::Plan> SelfTest::batch_plans()
+    {
+        using Kind = Op::Kind;
+        std::vector<Plan> plans;
+
+        //add(): the vectors, then every length 0-200
+        {
+            Plan plan{"add", {}, {}};
+
+            for(const auto& vector : vectors())
+            {
+                plan.ops.push_back({Kind::add, vector.first});
+                plan.plaintexts.push_back(vector.first);
+            }
+            plan.ops.push_back({Kind::flush, ""});
+
+            for(std::size_t length=0; length <= max_length; ++length)
+            {
+                for(std::size_t batch=1; batch <= 16; ++batch)
+                {
+                    for(std::size_t i=0; i < batch; ++i)
+                    {
+                        plan.ops.push_back({Kind::add, random_text(length)});
+                        plan.plaintexts.push_back(plan.ops.back().text);
+                    }
+
+                    plan.ops.push_back({Kind::flush, ""});
+                }
+            }
+
+            plans.push_back(std::move(plan));
+        }
+
+        //fix()/add_tail(): every head length 0-60 (past one block too) with random tails
+        {
+            Plan plan{"fix/add_tail", {}, {}};
+
+            for(std::size_t head_length=0; head_length <= max_block_message + 5; ++head_length)
+            {
+                for(std::size_t batch=1; batch <= 16; ++batch)
+                {
+                    const std::string head = random_text(head_length);
+                    plan.ops.push_back({Kind::fix, head});
+
+                    for(std::size_t i=0; i < batch; ++i)
+                    {
+                        plan.ops.push_back({Kind::add_tail, random_text(random_length(max_length - head_length))});
+                        plan.plaintexts.push_back(head + plan.ops.back().text);
+                    }
+
+                    plan.ops.push_back({Kind::flush, ""});
+                }
+            }
+
+            plans.push_back(std::move(plan));
+        }
+
+        //fix_tail()/add_head(): every head length 0-60 with random tails
+        {
+            Plan plan{"fix_tail/add_head", {}, {}};
+
+            for(std::size_t head_length=0; head_length <= max_block_message + 5; ++head_length)
+            {
+                for(std::size_t batch=1; batch <= 16; ++batch)
+                {
+                    const std::string tail = random_text(random_length(max_length - head_length));
+                    plan.ops.push_back({Kind::fix_tail, tail, head_length});
+
+                    for(std::size_t i=0; i < batch; ++i)
+                    {
+                        plan.ops.push_back({Kind::add_head, random_text(head_length)});
+                        plan.plaintexts.push_back(plan.ops.back().text + tail);
+                    }
+
+                    plan.ops.push_back({Kind::flush, ""});
+                }
+            }
+
+            plans.push_back(std::move(plan));
+        }
+
+        //Random mix without flushes: switching between the modes must hash the queued lanes before their shared words change
+        {
+            Plan plan{"mixed", {}, {}};
+            std::string head, tail;
+            std::size_t head_length = 0;
+            Kind mode = Kind::add;
+
+            for(int i=0; i < 5000; ++i)
+            {
+                if (random() % 8 == 0)
+                {
+                    const Kind modes[] = {Kind::add, Kind::add_tail, Kind::add_head};
+                    mode = modes[random() % 3];
+
+                    if (mode == Kind::add_tail)
+                    {
+                        head = random_text(random_length(max_block_message + 5));
+                        plan.ops.push_back({Kind::fix, head});
+                    }
+                    else if (mode == Kind::add_head)
+                    {
+                        head_length = random_length(max_block_message + 5);
+                        tail = random_text(random_length(max_length - head_length));
+                        plan.ops.push_back({Kind::fix_tail, tail, head_length});
+                    }
+                }
+
+                if (mode == Kind::add)
+                {
+                    plan.ops.push_back({Kind::add, random_text(random_length(max_length))});
+                    plan.plaintexts.push_back(plan.ops.back().text);
+                }
+                else if (mode == Kind::add_tail)
+                {
+                    plan.ops.push_back({Kind::add_tail, random_text(random_length(max_length - head.size()))});
+                    plan.plaintexts.push_back(head + plan.ops.back().text);
+                }
+                else
+                {
+                    plan.ops.push_back({Kind::add_head, random_text(head_length)});
+                    plan.plaintexts.push_back(plan.ops.back().text + tail);
+                }
+            }
+
+            plans.push_back(std::move(plan));
+        }
+
+        return plans;
+    }
+
+    //Replay a plan on Batch<Lanes>
+    template <std::size_t Lanes>
+    inline void SelfTest::test_batch(const Plan& plan)
+    {
+        using Kind = Op::Kind;
+        SelfTestResult result{"simd" + std::to_string(Lanes) + " " + plan.name, 0, 0};
+        Round round;
+
+        for(const std::string& plaintext : plan.plaintexts)
+            expect(round, plaintext, 1);
+        round.targets.build_filter();
+
+        Batch<Lanes> batch;
+        auto match = [&](const std::string& hash, const digest& d, const std::string& plaintext) { crack(round, result, hash, d, plaintext); };
+
+        for(const Op& op : plan.ops)
+        {
+            switch (op.kind)
+            {
+                case Kind::add:       batch.add(op.text, round.targets, match); break;
+                case Kind::fix:       batch.fix(op.text, round.targets, match); break;
+                case Kind::add_tail:  batch.add_tail(op.text, round.targets, match); break;
+                case Kind::fix_tail:  batch.fix_tail(op.text, op.length, round.targets, match); break;
+                case Kind::add_head:  batch.add_head(op.text, round.targets, match); break;
+                case Kind::flush:     batch.flush(round.targets, match); break;
+            }
+        }
+
+        batch.flush(round.targets, match);
+        finish(round, result);
+    }
+
+    //Run BruteLanes<Lanes> on [begin, end) of a keyspace with every candidate of the keyspace as a target (the ones outside the range
+    //must not be cracked)
+    template <std::size_t Lanes>
+    inline void SelfTest::test_brute(const std::string& kernel, const Permute::Keyspace& keyspace, std::uint64_t begin, std::uint64_t end)
+    {
+        SelfTestResult result{kernel, 0, 0};
+        Round round;
+
+        for(std::uint64_t i=0; i < keyspace.size(); ++i)
+            expect(round, keyspace.at(i), (i >= begin and i < end ? 1 : 0));
+        round.targets.build_filter();
+
+        BruteLanes<Lanes> lanes(keyspace);
+        std::uint64_t stopped = lanes.run(begin, end, round.targets,
+                                          [&](const std::string& hash, const digest& d, const std::string& plaintext) { crack(round, result, hash, d, plaintext); },
+                                          []() { return false; });
+
+        if (stopped != end)
+            fail(result, "", "run() returned " + std::to_string(stopped) + ", expected " + std::to_string(end));
+
+        finish(round, result);
+    }
+
+    //BruteLanes<Lanes>: the vectors (one candidate each among a few fillers of the last position), then random keyspaces of length 1-55
+    template <std::size_t Lanes>
+    inline void SelfTest::test_brute()
+    {
+        const std::string kernel = "brute" + std::to_string(Lanes);
+        const std::string filler = "0123456789ABCDEFGHIJ";
+
+        for(const auto& vector : vectors())
+        {
+            const std::string& message = vector.first;
+
+            if (message.empty() or message.size() > max_block_message)
+                continue;
+
+            std::vector<std::string> charsets;
+            for(char c : message)
+                charsets.emplace_back(1, c);
+            charsets.back() += filler;
+
+            Permute::Keyspace keyspace(charsets);
+            test_brute<Lanes>(kernel, keyspace, 0, keyspace.size());
+        }
+
+        //The last 1-3 positions vary (charsets of Lanes/2-24 characters, so every group layout shows up), the others are fixed
+        Permute::Markov markov;
+        for(const char* word : {"password", "passw0rd", "dragon12", "letmein!", "monkey", "qwerty99"})
+            markov.train(word);
+
+        for(std::size_t length : {1, 2, 3, 4, 5, 7, 8, 9, 13, 16, 31, 32, 33, 53, 54, 55})
+        {
+            for(bool ordered : {false, true})
+            {
+                std::vector<std::string> charsets;
+
+                for(std::size_t pos=0; pos < length; ++pos)
+                {
+                    std::size_t size = (pos + 3 >= length ? Lanes / 2 + random() % (25 - Lanes / 2) : 1);
+                    std::string charset;
+
+                    while (charset.size() < size)
+                    {
+                        char c = static_cast<char>(1 + random() % 255);
+
+                        if (charset.find(c) == std::string::npos)
+                            charset += c;
+                    }
+
+                    charsets.push_back(std::move(charset));
+                }
+
+                Permute::Keyspace keyspace(charsets, (ordered ? &markov : nullptr));
+                const std::uint64_t begin = random() % (keyspace.size() / 3 + 1);
+                const std::uint64_t end = keyspace.size() - random() % (keyspace.size() / 3 + 1);
+
+                test_brute<Lanes>(kernel, keyspace, begin, end);
+            }
+        }
+
+        //Merge the keyspaces into one line of the summary
+        SelfTestResult total{kernel, 0, 0};
+
+        while (not results.empty() and results.back().kernel == kernel)
+        {
+            total.cases += results.back().cases;
+            total.failures += results.back().failures;
+            results.pop_back();
+        }
+
+        results.push_back(total);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Run every test -- returns whether every kernel matched the reference in every case
+    inline bool SelfTest::run()
+    {
+        results.clear();
+
+        test_hashlib();
+        test_scalar();
+
+        for(const Plan& plan : batch_plans())
+        {
+            test_batch<4>(plan);
+            test_batch<8>(plan);
+            test_batch<16>(plan);
+        }
+
+        test_brute<4>();
+        test_brute<8>();
+        test_brute<16>();
+
+        for(const SelfTestResult& result : results)
+            if (result.failures != 0)
+                return false;
+
+        return true;
+    }
+
+    //Return the result of every kernel of the last run()
+    [[nodiscard]] inline const std::vector<SelfTestResult>& SelfTest::summary() const noexcept
+    {
+        return results;
+    }
+
+    //Print one line per kernel of the last run(): its name, PASS/FAIL, the cases checked and the mismatches
+    inline void SelfTest::print(std::ostream& out) const
+    {
+        for(const SelfTestResult& result : results)
+            out << std::left << std::setw(28) << result.kernel << (result.failures == 0 ? "PASS" : "FAIL") << std::right << std::setw(12)
+                << result.cases << " cases" << (result.failures == 0 ? "" : ", " + std::to_string(result.failures) + " mismatches") << '\n';
+    }
+}
@@ -0,0 +1,1747 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Hashes, passwords, file names
+#include <string_view>          //Words of the mapped dictionaries
+#include <vector>              //Targets, work ranges, guesses
+#include <unordered_map>      //Result table, warm dictionaries
+#include <optional>          //Cracked passwords, masks and grammars of a job
+#include <memory>           //Potfile, dictionaries, per-job filters
+#include <functional>      //Crack callback
+#include <deque>          //Crack queue
+#include <mutex>         //Serializing cracks coming from several workers
+#include <atomic>       //Progress counters read by other threads
+#include <chrono>      //Elapsed time, statistics interval
+#include <thread>     //std::this_thread::sleep_for, std::thread::hardware_concurrency
+#include <tuple>     //Association accounts
+#include <stdexcept>          //std::runtime_error
+#include <istream>           //Hash lists from any stream
+#include <fstream>          //Hash lists from files
+#include <algorithm>       //std::min, std::max, std::min_element
+#include <cstdint>        //Keyspace indices, byte offsets
+
+//Custom Libraries
+#include "digest.hpp"
+#include "targets.hpp"
+#include "numa.hpp"
+#include "progress.hpp"
+#include "scheduler.hpp"
+#include "slice.hpp"
+#include "brute_lanes.hpp"
+#include "batch.hpp"
+#include "dictionary.hpp"
+#include "loopback.hpp"
+#include "association.hpp"
+#include "bloom.hpp"
+#include "stats.hpp"
+#include "pool.hpp"
+#include "../permuter/mask.hpp"
+#include "../checkpoint/checkpoint.hpp"
+#include "../potfile/potfile.hpp"
+#include "../rules/rules.hpp"
+#include "../pcfg/pcfg.hpp"
+#include "../rainbow/rainbow.hpp"
+#include "../hashindex/hashindex.hpp"
+
+namespace cracker
+{
+    typedef std::unordered_map<std::string, std::optional<std::string>> passwd_hashmap;   //Hash as written -> optional<cracked password>
+    typedef std::vector<std::pair<std::string, std::string>> user_list;                   //(username or email, hash) of 'user:hash' lines
+
+    //Error of a session (unreadable file, bad session file, incomplete job), with the exit status the command line client uses for it
+    class SessionError final : public std::runtime_error
+    {
+        private:
+            int code;
+
+        public:
+            SessionError(const std::string& message, int in_code) : std::runtime_error(message), code(in_code) {}
+            [[nodiscard]] int status() const noexcept { return code; }
+    };
+
+    //Process-wide settings of a session (they stay the same for every job it runs)
+    struct SessionOptions
+    {
+        unsigned threads = 0;               //Worker threads (0: one per core)
+        std::string potfile;               //Potfile that is consulted and appended to (empty: none)
+        std::string stats_file;           //File the per-stage statistics are written to (empty: none)
+        bool progress_line = false;      //Draw the progress line on std::cout while an attack runs
+        bool queue_cracks = false;      //Keep every crack for next_crack() (on top of the callback)
+        bool numa = false;             //Pin the workers to CPUs node by node (their batch buffers are then allocated on their node)
+        bool numa_replicas = false;   //With 'numa': one copy of the targets and their prefilter per node, read by that node's workers
+    };
+
+    //One attack of a session and its inputs
+    struct Job
+    {
+        enum class Mode { dict, combinator, hybrid, brute, pcfg, rainbow, index };
+
+        Mode mode = Mode::dict;
+        std::string dictionary = "top-10-million-passwords.txt";   //Wordlist of dict/hybrid, left list of combinator
+        std::string right_dictionary;                             //Right list of combinator
+        rules::RuleSet rules;                                    //Rules of dict, association and loopback
+        rules::RuleSet left_rules, right_rules;                 //Rules of the combinator lists
+        std::optional<Permute::Mask> mask;                     //Keyspace of brute/hybrid
+        bool append = true;                                   //Hybrid: word+mask (true) or mask+word (false)
+        std::optional<pcfg::Grammar> grammar;                //Finished grammar of pcfg
+        std::vector<std::string> tables;                    //Table files of rainbow
+        std::string index;                                  //Index file of index (built with hashindex::build())
+        Slice slice;                                        //'--skip'/'--limit'/'--node'
+        bool association = false;                          //Username-derived candidates first
+        bool loopback = false;                            //Feed cracks back through the rules
+        std::size_t dedup = 0;                           //Size of the duplicate filter in MiB (0: none)
+        std::string checkpoint_file;                    //Session file for periodic checkpoints (empty: none)
+        std::uint64_t options_hash = 0;                //Identifies the job in its checkpoints
+        bool restore = false;                         //Continue from the checkpoint instead of starting over
+        std::vector<Range> ranges;                   //Only test these ranges of the attack (e.g. Report::left of an earlier run); empty: all
+    };
+
+    //A cracked target, as handed to the callback and the queue
+    struct Crack
+    {
+        std::string hash;          //As written in the hash list
+        std::string password;
+    };
+
+    //Snapshot of a session for pollers (safe to take from any thread, also while a job runs)
+    struct Status
+    {
+        bool running = false;                //A job is running
+        std::uint64_t tested = 0;           //Candidates tested by the current/last attack (including restored progress)
+        std::uint64_t total = 0;           //Candidates of that attack (0 if unknown)
+        std::uint64_t targets = 0;        //Hashes loaded
+        std::uint64_t cracked = 0;       //Of which cracked (potfile hits included)
+        double seconds = 0;             //Time the current/last attack has been running
+        double hashes_per_second = 0;
+    };
+
+    //What the last job did besides cracking
+    struct Report
+    {
+        bool finished = true;                           //False if it was stopped with work left (saved in the checkpoint)
+        std::size_t association_accounts = 0;          //Accounts the association pass tried
+        std::size_t association_cracked = 0;          //Of which cracked
+        std::uint64_t association_candidates = 0;    //Username-based candidates tested
+        std::uint64_t loopback = 0;                 //Cracks fed back through the rules
+        std::uint64_t candidates = 0;              //Candidates checked by the duplicate filter
+        std::uint64_t duplicates = 0;             //Of which dropped
+        std::uint64_t pcfg_dropped = 0;          //Guesses dropped to keep the PCFG queue bounded
+        std::vector<Range> work;                //Ranges the attack started with (dictionary bytes, keyspace indices or guess numbers)
+        std::vector<Range> left;               //Of which not tested (empty unless stopped; Job::ranges continues from them)
+    };
+
+    //Class 'Session' is the cracker as a library: the targets (and their results), the potfile, a pool of worker threads and the warm
+    //dictionaries live as long as the session, and run() cracks the current targets with one job at a time. Cracks are reported to a
+    //callback and/or a queue as they happen, and status() can be polled from any thread. Errors are thrown as SessionError, nothing is
+    //printed except the optional progress line and warnings. Several jobs can run one after the other (clear() starts a new target list).
+    class Session final
+    {
+        private:
+            SessionOptions options;
+            std::unique_ptr<potfile::Potfile> pot;                //nullptr without a potfile
+            ThreadPool pool;
+
+            passwd_hashmap hashes;                              //All targets (hash -> optional<cracked password>)
+            user_list users;                                   //Usernames of the 'user:hash' lines
+            TargetTable targets;                              //Targets still uncracked when the job started (digest -> hash)
+            std::vector<std::unique_ptr<TargetTable>> replicas;    //Per-node copies of 'targets' (empty: every worker reads 'targets')
+            std::unordered_map<digest, std::vector<std::string>, digest_hash> aliases;   //Every spelling of digests written more than once
+            std::unordered_map<std::string, std::unique_ptr<Dictionary>> dictionaries;   //Mapped wordlists, kept between jobs
+            std::unordered_map<std::string, std::unique_ptr<rainbow::Table>> tables;    //Mapped rainbow tables, kept between jobs
+            std::unordered_map<std::string, std::unique_ptr<hashindex::Index>> indexes;  //Mapped digest indexes, kept between jobs
+
+            std::mutex crack_lock;                          //Guards 'hashes', the potfile appends and the callback
+            std::function<void(const Crack&)> handler;     //Called for every crack (serialized)
+            std::mutex queue_lock;                        //Guards 'queue'
+            std::deque<Crack> queue;                     //Cracks not taken by next_crack() yet
+
+            std::atomic<bool> busy = false;                      //run() is in progress
+            std::atomic<bool> stop_requested = false;           //stop() was called
+            std::atomic<std::uint64_t> loaded = 0;             //Size of 'hashes'
+            std::atomic<std::uint64_t> cracked = 0;           //Cracked entries of 'hashes'
+            std::atomic<std::uint64_t> tested = 0;           //Progress of the current attack (refreshed by the monitor)
+            std::atomic<std::uint64_t> total = 0;           //Size of the current attack
+            std::atomic<std::uint64_t> start_done = 0;     //Candidates tested before this run (restored sessions)
+            std::atomic<std::int64_t> started = 0;        //Start of the current attack (steady clock, nanoseconds)
+
+            //State of the running job
+            const Job* job = nullptr;
+            std::optional<checkpoint::State> resume;                     //Checkpoint to continue from
+            std::unique_ptr<checkpoint::Checkpointer> checkpointer;     //nullptr without a checkpoint file
+            std::unique_ptr<Loopback> loopback;                        //nullptr unless the job loops back
+            std::unique_ptr<Bloom> dedup;                             //nullptr unless the job dedups
+            Report report;
+
+            void count_cracked();
+            void restore();
+            void build_targets();
+            [[nodiscard]] const TargetTable& node_targets(std::size_t) const;
+            bool execute();
+
+            void record_crack(const std::string&, const digest&, const std::string&);
+            [[nodiscard]] bool stopping() const;
+            [[nodiscard]] std::vector<std::pair<std::string, std::string>> cracked_hashes() const;
+
+            template <typename Remaining, typename Work>
+            bool run_workers(Remaining&&, std::uint64_t, std::uint64_t, Work&&);
+
+            const Dictionary& dictionary(const std::string&);
+            const rainbow::Table& table(const std::string&);
+            const hashindex::Index& digest_index(const std::string&);
+            std::vector<Range> dictionary_work(const std::string&, const Dictionary&, std::uint64_t&);
+            std::vector<std::string> load_words(const std::string&, const rules::RuleSet&);
+
+            void crack_association();
+            bool crack_dictionary();
+            bool crack_combinator();
+            bool crack_hybrid();
+            bool crack_brute();
+            bool crack_pcfg();
+            bool crack_rainbow();
+            bool crack_index();
+
+        public:
+            //Special methods
+            explicit Session(SessionOptions = {});
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+            //Targets
+            void load(const std::string&, std::vector<std::string>* = nullptr);
+            void load(std::istream&, std::vector<std::string>* = nullptr);
+            void clear();
+            [[nodiscard]] const passwd_hashmap& results() const noexcept;
+            [[nodiscard]] const user_list& accounts() const noexcept;
+            [[nodiscard]] const potfile::Potfile* potfile() const noexcept;
+
+            //Cracks
+            void on_crack(std::function<void(const Crack&)>);
+            bool next_crack(Crack&);
+
+            //Running
+            bool run(const Job&);
+            void stop() noexcept;
+            [[nodiscard]] Status status() const;
+            [[nodiscard]] const Report& last_report() const noexcept;
+            void drop_dictionaries();
+
+            [[nodiscard]] static const char* mode_name(Job::Mode) noexcept;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: open the potfile (CAN THROW SessionError) -- the worker threads are started by the first job
+    inline Session::Session(SessionOptions in_options)
+        : options(std::move(in_options)), pool(options.threads != 0 ? options.threads : std::max(std::thread::hardware_concurrency(), 1u))
+    {
+        if (options.numa)
+            pool.pin(Topology().placement(pool.size()));
+
+        if (options.potfile.empty())
+            return;
+
+        try
+        {
+            pot = std::make_unique<potfile::Potfile>(options.potfile);
+        }
+        catch (const std::runtime_error& error)
+        {
+            throw SessionError(error.what(), 2);
+        }
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Recount the cracked entries of the result table (after it changed wholesale)
+    inline void Session::count_cracked()
+    {
+        std::uint64_t count = 0;
+
+        for(const auto& map_entry : hashes)
+            count += map_entry.second.has_value();
+
+        loaded = hashes.size();
+        cracked = count;
+    }
+
+    //Load the checkpoint of the job, refusing to continue a session that was started with different options (CAN THROW SessionError)
+    inline void Session::restore()
+    {
+        resume = checkpoint::load(job->checkpoint_file);
+
+        if (not resume)
+            throw SessionError("the session file \"" + job->checkpoint_file + "\" is missing or corrupt", 3);
+
+        if (resume->options_hash != job->options_hash or resume->mode != mode_name(job->mode))
+            throw SessionError("the session \"" + job->checkpoint_file + "\" was started with different options", 3);
+
+        //Put back everything that was cracked before the interruption
+        for(auto& [hash, password] : resume->cracked)
+        {
+            auto itr = hashes.find(hash);
+            if (itr != hashes.end())
+                itr->second = std::move(password);
+        }
+
+        count_cracked();
+    }
+
+    //Build the hot lookup table from the hashes that are still uncracked (malformed lines can never match and are left out)
+    //Hex digits are parsed without regard to case, so one digest can be written several ways; the table keeps one of them and the rest
+    //are remembered as aliases, so a crack fills every spelling.
+    inline void Session::build_targets()
+    {
+        TargetTable table;
+        aliases.clear();
+
+        for(const auto& map_entry : hashes)
+        {
+            if (map_entry.second.has_value())
+                continue;
+
+            if (std::optional<digest> d = parse_digest(map_entry.first))
+            {
+                table.insert(*d, map_entry.first);
+
+                if (const std::string* first = table.find(*d); *first != map_entry.first)
+                {
+                    std::vector<std::string>& spellings = aliases[*d];
+
+                    if (spellings.empty())
+                        spellings.push_back(*first);
+
+                    spellings.push_back(map_entry.first);
+                }
+            }
+        }
+
+        table.build_filter();
+        targets = std::move(table);
+        replicas.clear();
+
+        if (not options.numa_replicas or pool.nodes() < 2)
+            return;
+
+        //The first worker of every node makes that node's copy, so its memory is allocated on the node
+        replicas.resize(pool.nodes());
+        pool.start([this](std::size_t id)
+                   {
+                       for(std::size_t other=0; other < id; ++other)
+                           if (pool.node(other) == pool.node(id))
+                               return;
+
+                       replicas[pool.node(id)] = std::make_unique<TargetTable>(targets.replica());
+                   });
+        pool.wait();
+    }
+
+    //Return the targets a worker looks its candidates up in: the copy on its own node, if there are copies
+    [[nodiscard]] inline const TargetTable& Session::node_targets(std::size_t id) const
+    {
+        return (replicas.empty() ? targets : *replicas[pool.node(id)]);
+    }
+
+    //Run the job: the association pass first (every target it cracks drops out of the global attack), then the attack of the job
+    inline bool Session::execute()
+    {
+        if ((job->mode == Job::Mode::brute or job->mode == Job::Mode::hybrid) and not job->mask)
+            throw SessionError(std::string("the ") + mode_name(job->mode) + " attack needs a mask", 1);
+
+        if (job->mode == Job::Mode::pcfg and not job->grammar)
+            throw SessionError("the pcfg attack needs a trained grammar", 1);
+
+        if (job->mode == Job::Mode::rainbow and job->tables.empty())
+            throw SessionError("the rainbow attack needs at least one table", 1);
+
+        if (job->mode == Job::Mode::index and job->index.empty())
+            throw SessionError("the index attack needs an index file", 1);
+
+        if (job->restore and job->checkpoint_file.empty())
+            throw SessionError("there is no session file to restore", 1);
+
+        report = Report();
+        resume.reset();
+        checkpointer.reset();
+
+        if (not job->checkpoint_file.empty())
+        {
+            checkpointer = std::make_unique<checkpoint::Checkpointer>(job->checkpoint_file, job->options_hash, mode_name(job->mode));
+
+            if (job->restore)
+                restore();
+        }
+
+        //Explicit ranges go through the same path as a restored checkpoint
+        if (not job->ranges.empty())
+        {
+            resume.emplace();
+
+            for(const Range& range : job->ranges)
+                resume->workers.push_back({range.begin, range.end});
+        }
+
+        build_targets();
+        loopback = (job->loopback ? std::make_unique<Loopback>() : nullptr);
+
+        try
+        {
+            dedup = (job->dedup != 0 ? std::make_unique<Bloom>(job->dedup) : nullptr);
+        }
+        catch (const std::exception&)      //std::bad_alloc, std::length_error
+        {
+            throw SessionError("the duplicate filter of " + std::to_string(job->dedup) + " MiB could not be allocated", 2);
+        }
+
+        if (not options.stats_file.empty())
+            Stats::enable();
+
+        if (job->association)
+            crack_association();
+
+        bool finished = true;
+
+        //The global attack (unless the association pass left nothing for it)
+        if (not targets.all_cracked())
+        {
+            if (job->mode == Job::Mode::hybrid)
+                finished = crack_hybrid();
+            else if (job->mode == Job::Mode::brute)
+                finished = crack_brute();
+            else if (job->mode == Job::Mode::pcfg)
+                finished = crack_pcfg();
+            else if (job->mode == Job::Mode::rainbow)
+                finished = crack_rainbow();
+            else if (job->mode == Job::Mode::index)
+                finished = crack_index();
+            else if (job->mode == Job::Mode::combinator)
+                finished = crack_combinator();
+            else
+                finished = crack_dictionary();
+        }
+
+        report.finished = finished;
+
+        if (loopback != nullptr)
+            report.loopback = loopback->size();
+
+        if (dedup != nullptr)
+        {
+            report.candidates = dedup->candidates();
+            report.duplicates = dedup->duplicate_count();
+        }
+
+        if (not options.stats_file.empty())
+            Stats::global().write_json(options.stats_file);
+
+        if (finished and checkpointer != nullptr)
+            checkpointer->discard();                   //Nothing left to restore
+
+        return finished;
+    }
+
+    //Store a cracked password in the result table, append it to the potfile and report it (only the first time a target is found)
+    //Every spelling of the digest in the hash list gets the password and is reported, but the target is counted and saved only once.
+    inline void Session::record_crack(const std::string& hash, const digest& d, const std::string& password)
+    {
+        CRACKER_STAGE(write);
+        std::lock_guard<std::mutex> guard(crack_lock);
+
+        if (hashes[hash].has_value())
+            return;
+
+        targets.mark_cracked();
+
+        if (loopback != nullptr)
+            loopback->push(password);
+
+        if (pot != nullptr)
+        {
+            try
+            {
+                pot->append(d, password);
+            }
+            catch (const std::runtime_error& error)
+            {
+                std::clog << "***WARNING***: " << error.what() << '\n';   //The crack is still reported, just not remembered
+            }
+        }
+
+        auto fill = [&](const std::string& spelling)
+                    {
+                        std::optional<std::string>& entry = hashes[spelling];
+
+                        if (entry.has_value())
+                            return;
+
+                        entry = password;
+                        cracked.fetch_add(1, std::memory_order_relaxed);
+
+                        if (handler)
+                            handler(Crack{spelling, password});
+
+                        if (options.queue_cracks)
+                        {
+                            std::lock_guard<std::mutex> queue_guard(queue_lock);
+                            queue.push_back(Crack{spelling, password});
+                        }
+                    };
+
+        if (auto spellings = aliases.find(d); spellings != aliases.end())
+        {
+            for(const std::string& spelling : spellings->second)
+                fill(spelling);
+        }
+        else
+            fill(hash);
+    }
+
+    //Return whether the workers should stop: every target is cracked, stop() was called, or SIGINT/SIGTERM asked for a checkpoint
+    [[nodiscard]] inline bool Session::stopping() const
+    {
+        return targets.all_cracked() or stop_requested.load(std::memory_order_relaxed) or checkpoint::interrupted();
+    }
+
+    //List the hashes that have been cracked so far (hash, plaintext) -- stored in checkpoints so a restored run reports them too
+    [[nodiscard]] inline std::vector<std::pair<std::string, std::string>> Session::cracked_hashes() const
+    {
+        std::vector<std::pair<std::string, std::string>> list;
+
+        for(const auto& map_entry : hashes)
+        {
+            if (map_entry.second.has_value())
+                list.emplace_back(map_entry.first, map_entry.second.value());
+        }
+
+        return list;
+    }
+
+    //Run the job on every thread of the pool while this thread refreshes the progress and writes periodic checkpoints. 'work(id, tested)'
+    //takes work until there is none left or stopping() is true, adding every candidate it tests to 'tested'; 'remaining()' lists the
+    //ranges that are not finished yet (usually scheduler.remaining()).
+    //Returns false if the attack was stopped with work left (the unfinished ranges are then saved to the checkpoint)
+    template <typename Remaining, typename Work>
+    inline bool Session::run_workers(Remaining&& remaining, std::uint64_t attack_total, std::uint64_t already_done, Work&& work)
+    {
+        std::vector<std::atomic<std::uint64_t>> counters(pool.size());     //Candidates tested by each worker (summed for the progress)
+
+        auto done = [&]()
+                    {
+                        std::uint64_t sum = already_done;
+                        for(const auto& count : counters)
+                            sum += count.load(std::memory_order_relaxed);
+                        return sum;
+                    };
+
+        auto save = [&]()
+                    {
+                        if (checkpointer == nullptr)
+                            return;
+
+                        std::vector<checkpoint::Worker> unfinished;
+                        for(const Range& range : remaining())
+                            unfinished.push_back({range.begin, range.end});
+
+                        std::lock_guard<std::mutex> guard(crack_lock);
+                        checkpointer->save(done(), std::move(unfinished), cracked_hashes());
+                    };
+
+        constexpr std::chrono::seconds stats_every(5);     //Interval between two statistics exports
+
+        std::optional<Progress> progress;
+        auto next_stats = std::chrono::steady_clock::now() + stats_every;
+
+        if (options.progress_line)
+            progress.emplace(attack_total, already_done);
+
+        total = attack_total;
+        start_done = already_done;
+        tested = already_done;
+        started = std::chrono::steady_clock::now().time_since_epoch().count();
+        report.work = remaining();
+
+        pool.start([&](std::size_t id) { work(id, counters[id]); });
+
+        //Monitor (this thread): progress + periodic checkpoints while the workers run
+        while (pool.running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            tested = done();
+
+            if (progress)
+                progress->refresh(tested);
+
+            if (checkpointer != nullptr and checkpointer->due())
+                save();
+
+            if (not options.stats_file.empty() and std::chrono::steady_clock::now() >= next_stats)
+            {
+                Stats::global().write_json(options.stats_file);
+                next_stats += stats_every;
+            }
+        }
+
+        pool.wait();
+        tested = done();
+
+        if (progress)
+            progress->finish(tested);
+
+        //Stopped early: record every range that was not finished
+        report.left = remaining();
+        bool finished = (report.left.empty() or targets.all_cracked());
+        if (not finished)
+            save();
+
+        return finished;
+    }
+
+    //Return the mapped wordlist of a file, mapping it on first use (CAN THROW SessionError)
+    inline const Dictionary& Session::dictionary(const std::string& filename)
+    {
+        std::unique_ptr<Dictionary>& mapped = dictionaries[filename];
+
+        if (mapped == nullptr)
+        {
+            try
+            {
+                mapped = std::make_unique<Dictionary>(filename);
+            }
+            catch (const std::runtime_error& error)
+            {
+                dictionaries.erase(filename);
+                throw SessionError(error.what(), 2);
+            }
+        }
+
+        return *mapped;
+    }
+
+    //Return the mapped rainbow table of a file, mapping it on first use (CAN THROW SessionError)
+    inline const rainbow::Table& Session::table(const std::string& filename)
+    {
+        std::unique_ptr<rainbow::Table>& mapped = tables[filename];
+
+        if (mapped == nullptr)
+        {
+            try
+            {
+                mapped = std::make_unique<rainbow::Table>(filename);
+            }
+            catch (const std::runtime_error& error)
+            {
+                tables.erase(filename);
+                throw SessionError(error.what(), 2);
+            }
+        }
+
+        return *mapped;
+    }
+
+    //Return the mapped digest index of a file, mapping it on first use (CAN THROW SessionError)
+    inline const hashindex::Index& Session::digest_index(const std::string& filename)
+    {
+        std::unique_ptr<hashindex::Index>& mapped = indexes[filename];
+
+        if (mapped == nullptr)
+        {
+            try
+            {
+                mapped = std::make_unique<hashindex::Index>(filename);
+            }
+            catch (const std::runtime_error& error)
+            {
+                indexes.erase(filename);
+                throw SessionError(error.what(), 2);
+            }
+        }
+
+        return *mapped;
+    }
+
+    //Return the byte ranges of a wordlist this run has to go through: the ranges recorded in the checkpoint, or the slice (line numbers)
+    //translated into byte offsets. 'already_done' receives the number of candidates tested before this run.
+    inline std::vector<Range> Session::dictionary_work(const std::string& filename, const Dictionary& words, std::uint64_t& already_done)
+    {
+        std::vector<Range> work;
+
+        if (resume)
+        {
+            for(const checkpoint::Worker& worker : resume->workers)
+                work.push_back({worker.begin, std::min(worker.end, words.size())});
+
+            already_done = resume->progress;
+        }
+        else if (not job->slice.whole())
+        {
+            std::uint64_t lines = (job->slice.nodes > 1 ? count_lines(filename) : UINT64_MAX);
+            Range bytes = line_bytes(filename, job->slice.apply(lines));
+            work.push_back({bytes.begin, std::min(bytes.end, words.size())});
+        }
+        else
+            work.push_back({0, words.size()});
+
+        return work;
+    }
+
+    //Read a whole wordlist into memory, with every rule applied to every word (the words as written if there are no rules)
+    inline std::vector<std::string> Session::load_words(const std::string& filename, const rules::RuleSet& rules)
+    {
+        const Dictionary& list = dictionary(filename);
+        std::vector<std::string> words;
+        std::string candidate;
+
+        for(std::uint64_t line = 0; line < list.size();)
+        {
+            std::string_view word = list.line(line);
+            line += word.size() + 1;
+
+            if (rules.empty())
+                words.emplace_back(word);
+
+            for(const rules::Rule& rule : rules)
+                if (rule.apply(word, candidate))
+                    words.push_back(candidate);
+        }
+
+        return words;
+    }
+
+
+    // ***** ATTACKS ***** //
+
+    //Try the association candidates of every 'user:hash' line against that line's hash only (cheap enough to run before any global attack)
+    //Accounts are split between the workers; there is no checkpoint, an interrupted pass simply runs again on restore
+    inline void Session::crack_association()
+    {
+        //Variables
+        const Association association(job->rules);
+        std::vector<std::tuple<const std::string*, const std::string*, digest>> targeted;   //(user, hash, digest) of every uncracked account
+        std::atomic<std::size_t> next_account(0);
+        std::atomic<std::uint64_t> candidates(0);
+        std::atomic<std::size_t> hits(0);
+
+        for(const auto& [user, hash] : users)
+        {
+            auto itr = hashes.find(hash);
+
+            if (itr != hashes.end() and not itr->second)
+                targeted.emplace_back(&user, &itr->first, *parse_digest(hash));
+        }
+
+        //Worker: take the next account and test its candidates until one matches
+        pool.start([&](std::size_t)
+                   {
+                       for(std::size_t i; not stopping() and (i = next_account.fetch_add(1)) < targeted.size();)
+                       {
+                           const auto& [user, hash, target] = targeted[i];
+                           std::uint64_t count = 0;
+
+                           association.run(*user, [&, &hash = hash, &target = target](const std::string& candidate)
+                           {
+                               ++count;
+                               digest d = (candidate.size() <= max_block_message ? md5_short(candidate.data(), candidate.size()) : md5(candidate));
+
+                               if (d != target)
+                                   return false;
+
+                               record_crack(*hash, d, candidate);
+                               ++hits;
+                               return true;
+                           });
+
+                           candidates.fetch_add(count, std::memory_order_relaxed);
+                       }
+                   });
+
+        pool.wait();
+
+        report.association_accounts = targeted.size();
+        report.association_cracked = hits;
+        report.association_candidates = candidates;
+    }
+
+    //(Attempt to) crack all the passwords with a wordlist -- returns false if the attack was interrupted before the end of the dictionary
+    //The dictionary is mapped into memory and split into byte ranges that the workers take from a work-stealing scheduler; every word is
+    //expanded by the rules (if any) right inside the worker and hashed in SIMD batches. With loopback, new cracks go through the rules too,
+    //ahead of the next dictionary word.
+    inline bool Session::crack_dictionary()
+    {
+        //Number of candidates a worker tests between updates of its progress counter
+        constexpr std::uint64_t report_every = 4096;
+
+        //Variables
+        const std::string& filename = job->dictionary;
+        const rules::RuleSet& rules = job->rules;
+        const Dictionary& words = dictionary(filename);
+        std::uint64_t already_done = 0;                                               //Candidates tested before this run (restored sessions)
+        std::vector<Range> work = dictionary_work(filename, words, already_done);
+        std::uint64_t untested = 0;
+
+        for(const Range& range : work)
+            untested += range.size();
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size()));
+
+        //Worker: take byte ranges, apply every rule to every word that starts in them and hash the results in batches
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          const TargetTable& node_table = node_targets(id);
+                          Batch<simd_lanes> batch;
+                          std::string candidate, looped;
+                          Range chunk;
+                          std::uint64_t count = 0, checked = 0, duplicates = 0;
+
+                          auto match = [this](const std::string& hash, const digest& d, const std::string& password) { record_crack(hash, d, password); };
+
+                          //Hash a candidate unless the duplicate filter has seen it before
+                          auto test = [&](std::string_view word)
+                                      {
+                                          ++count;
+                                          ++checked;
+
+                                          if (dedup != nullptr and dedup->insert(word))
+                                              ++duplicates;
+                                          else
+                                              batch.add(word, node_table, match);
+                                      };
+
+                          //Test a word with every rule (or as written without rules)
+                          auto expand = [&](std::string_view word)
+                                        {
+                                            if (rules.empty())
+                                                test(word);
+
+                                            for(const rules::Rule& rule : rules)
+                                            {
+                                                bool applied;
+                                                { CRACKER_STAGE(generate); applied = rule.apply(word, candidate); }
+
+                                                if (applied)
+                                                    test(candidate);
+                                            }
+                                        };
+
+                          //Test the cracks waiting in the loopback queue first
+                          auto loop_back = [&]()
+                                           {
+                                               while (loopback != nullptr and loopback->pop(looped))
+                                                   expand(looped);
+                                           };
+
+                          while (not stopping() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t line = words.line_start(chunk.begin); line < chunk.end;)
+                              {
+                                  if (stopping())
+                                  {
+                                      batch.flush(node_table, match);
+                                      scheduler.release(id, line);   //The rest of this range stays in the checkpoint
+                                      break;
+                                  }
+
+                                  loop_back();
+
+                                  std::string_view word;
+                                  { CRACKER_STAGE(read); word = words.line(line); }
+                                  line += word.size() + 1;          //Offset of the next line
+                                  expand(word);
+
+                                  if (count >= report_every)
+                                  {
+                                      tested.fetch_add(count, std::memory_order_relaxed);
+                                      count = 0;
+                                  }
+                              }
+
+                              batch.flush(node_table, match);   //Before the range is reported as done by the next call to next()
+                          }
+
+                          //The last flushes may still crack something: keep looping back until nothing new comes out
+                          while (loopback != nullptr and not stopping() and not loopback->empty())
+                          {
+                              loop_back();
+                              batch.flush(node_table, match);
+                          }
+
+                          tested.fetch_add(count, std::memory_order_relaxed);
+
+                          if (dedup != nullptr)
+                              dedup->count(checked, duplicates);
+                      };
+
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, 0, already_done, worker);   //The number of passwords in the dictionary is not known up front
+    }
+
+    //(Attempt to) crack all the hashes with every left word followed by every right word -- returns false if interrupted
+    //The right list (after its rules) stays in memory; the left dictionary is split into byte ranges like in crack_dictionary(). Each left
+    //word is written into the message block of every lane once, and only the right word's bytes change from one candidate to the next.
+    inline bool Session::crack_combinator()
+    {
+        //Number of candidates a worker tests between updates of its progress counter
+        constexpr std::uint64_t report_every = 4096;
+
+        //Variables
+        const std::vector<std::string> right = load_words(job->right_dictionary, job->right_rules);   //Resident right list
+        const rules::RuleSet& left_rules = job->left_rules;
+        const Dictionary& left = dictionary(job->dictionary);                                        //Left words, split between the workers
+        std::uint64_t already_done = 0;                                                             //Candidates tested before this run (restored sessions)
+        std::vector<Range> work = dictionary_work(job->dictionary, left, already_done);
+        std::uint64_t untested = 0;
+
+        for(const Range& range : work)
+            untested += range.size();
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size()));
+
+        //Worker: take byte ranges of the left dictionary and combine every (rule-expanded) left word in them with the whole right list
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          const TargetTable& node_table = node_targets(id);
+                          Batch<simd_lanes> batch;
+                          std::string left_word;
+                          Range chunk;
+                          std::uint64_t count = 0, checked = 0, duplicates = 0;
+
+                          auto match = [this](const std::string& hash, const digest& d, const std::string& password) { record_crack(hash, d, password); };
+
+                          //Combine a left word with the whole right list (unless the duplicate filter has seen the left word before)
+                          auto combine = [&](std::string_view head)
+                                         {
+                                             count += right.size();
+                                             checked += right.size();
+
+                                             if (dedup != nullptr and dedup->insert(head))
+                                             {
+                                                 duplicates += right.size();
+                                                 return;
+                                             }
+
+                                             batch.fix(head, node_table, match);
+
+                                             for(const std::string& tail : right)
+                                                 batch.add_tail(tail, node_table, match);
+                                         };
+
+                          while (not stopping() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t line = left.line_start(chunk.begin); line < chunk.end;)
+                              {
+                                  if (stopping())
+                                  {
+                                      batch.flush(node_table, match);
+                                      scheduler.release(id, line);   //The rest of this range stays in the checkpoint
+                                      break;
+                                  }
+
+                                  std::string_view word;
+                                  { CRACKER_STAGE(read); word = left.line(line); }
+                                  line += word.size() + 1;          //Offset of the next line
+
+                                  if (left_rules.empty())
+                                      combine(word);
+
+                                  for(const rules::Rule& rule : left_rules)
+                                      if (rule.apply(word, left_word))
+                                          combine(left_word);
+
+                                  if (count >= report_every)
+                                  {
+                                      tested.fetch_add(count, std::memory_order_relaxed);
+                                      count = 0;
+                                  }
+                              }
+
+                              batch.flush(node_table, match);   //Before the range is reported as done by the next call to next()
+                          }
+
+                          tested.fetch_add(count, std::memory_order_relaxed);
+
+                          if (dedup != nullptr)
+                              dedup->count(checked, duplicates);
+                      };
+
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, 0, already_done, worker);
+    }
+
+    //(Attempt to) crack all the hashes with every dictionary word combined with every mask candidate -- returns false if interrupted
+    //The dictionary is split into byte ranges like in crack_dictionary(); the word is written into the message block of every lane once per
+    //word (per mask length for mask+word), and only the mask part is generated and written in the inner loop
+    inline bool Session::crack_hybrid()
+    {
+        //Number of candidates a worker tests between updates of its progress counter
+        constexpr std::uint64_t report_every = 4096;
+
+        //Variables
+        const std::string& filename = job->dictionary;
+        const Permute::Mask& mask = *job->mask;
+        const bool append = job->append;
+        const Dictionary& words = dictionary(filename);
+        std::uint64_t already_done = 0;                                               //Candidates tested before this run (restored sessions)
+        std::vector<Range> work = dictionary_work(filename, words, already_done);
+        std::uint64_t untested = 0;
+
+        for(const Range& range : work)
+            untested += range.size();
+
+        //Combined keyspace: words (of the slice) x mask candidates (unknown if that does not fit 64 bits)
+        std::uint64_t word_count = job->slice.apply(count_lines(filename)).size();
+        std::uint64_t candidates = (word_count == 0 or mask.size() <= UINT64_MAX / word_count ? word_count * mask.size() : 0);
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size()));
+
+        //Worker: take byte ranges of the dictionary and combine every word in them with the whole mask
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          const TargetTable& node_table = node_targets(id);
+                          Batch<simd_lanes> batch;
+                          std::vector<char> affix(mask.keyspace(mask.lengths() - 1).length());
+                          Range chunk;
+                          std::uint64_t count = 0, checked = 0, duplicates = 0;
+
+                          auto match = [this](const std::string& hash, const digest& d, const std::string& password) { record_crack(hash, d, password); };
+
+                          while (not stopping() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t line = words.line_start(chunk.begin); line < chunk.end;)
+                              {
+                                  if (stopping())
+                                  {
+                                      batch.flush(node_table, match);
+                                      scheduler.release(id, line);   //The rest of this range stays in the checkpoint
+                                      break;
+                                  }
+
+                                  std::string_view word;
+                                  { CRACKER_STAGE(read); word = words.line(line); }
+                                  line += word.size() + 1;          //Offset of the next line
+                                  count += mask.size();
+                                  checked += mask.size();
+
+                                  //A repeated word would repeat the whole mask: the duplicate filter skips it
+                                  if (dedup != nullptr and dedup->insert(word))
+                                  {
+                                      duplicates += mask.size();
+                                      continue;
+                                  }
+
+                                  if (append)
+                                      batch.fix(word, node_table, match);
+
+                                  for(std::size_t length=0; length < mask.lengths(); ++length)
+                                  {
+                                      const Permute::Keyspace& keyspace = mask.keyspace(length);
+                                      std::string_view candidate(affix.data(), keyspace.length());
+
+                                      if (not append)
+                                          batch.fix_tail(word, keyspace.length(), node_table, match);
+
+                                      keyspace.at(0, affix.data());
+                                      for(std::uint64_t i=0; i < keyspace.size(); ++i, keyspace.increment(affix.data()))
+                                      {
+                                          if (append)
+                                              batch.add_tail(candidate, node_table, match);
+                                          else
+                                              batch.add_head(candidate, node_table, match);
+                                      }
+                                  }
+
+                                  if (count >= report_every)
+                                  {
+                                      tested.fetch_add(count, std::memory_order_relaxed);
+                                      count = 0;
+                                  }
+                              }
+
+                              batch.flush(node_table, match);   //Before the range is reported as done by the next call to next()
+                          }
+
+                          tested.fetch_add(count, std::memory_order_relaxed);
+
+                          if (dedup != nullptr)
+                              dedup->count(checked, duplicates);
+                      };
+
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, candidates, already_done, worker);
+    }
+
+    //(Attempt to) crack all the passwords of a mask/brute force keyspace -- returns false if the attack was interrupted before its end
+    //Work is split into chunks of the global index space that the workers take from a work-stealing scheduler
+    inline bool Session::crack_brute()
+    {
+        //Number of candidates generated into a worker's batch buffer at a time
+        constexpr std::uint64_t batch_size = 64;
+
+        //Variables
+        const Permute::Mask& mask = *job->mask;
+        const Range slice = job->slice.apply(mask.size());   //Part of the keyspace this process covers
+        std::vector<Range> work{slice};                     //Unfinished part of it
+
+        //Continue with the ranges that were unfinished when the session was interrupted
+        if (resume)
+        {
+            work.clear();
+            for(const checkpoint::Worker& worker : resume->workers)
+                work.push_back({worker.begin, std::min(worker.end, slice.end)});
+        }
+
+        std::uint64_t untested = 0;
+        for(const Range& range : work)
+            untested += range.size();
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size()));
+        auto stop = [this]() { return stopping(); };
+
+        //Keyspaces whose candidates fit one MD5 block are hashed 'simd_lanes' at a time, straight from SoA message blocks
+        std::vector<std::optional<BruteLanes<simd_lanes>>> lanes(mask.lengths());
+        for(std::size_t length=0; length < mask.lengths(); ++length)
+            if (BruteLanes<simd_lanes>::suitable(mask.keyspace(length)))
+                lanes[length].emplace(mask.keyspace(length));
+
+        //Worker: take chunks, generate each batch in place (copy the previous candidate + increment it), hash and look up the batch
+        //(or hand the chunk to the SIMD generator)
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          const TargetTable& node_table = node_targets(id);
+                          std::vector<char> batch(batch_size * mask.keyspace(mask.lengths() - 1).length());
+                          Range chunk;
+
+                          auto match = [this](const std::string& hash, const digest& d, const std::string& password) { record_crack(hash, d, password); };
+
+                          while (not stop() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t position = chunk.begin; position < chunk.end;)
+                              {
+                                  if (stop())
+                                  {
+                                      scheduler.release(id, position);   //The rest of this chunk stays in the checkpoint
+                                      break;
+                                  }
+
+                                  auto [length, local] = mask.locate(position);
+                                  const Permute::Keyspace& keyspace = mask.keyspace(length);
+                                  const std::size_t width = keyspace.length();
+
+                                  //SIMD path: a whole run of this keyspace at once (it polls stop() itself, once per row)
+                                  if (lanes[length])
+                                  {
+                                      const std::uint64_t end = local + std::min(chunk.end - position, keyspace.size() - local);
+                                      const std::uint64_t reached = lanes[length]->run(local, end, node_table, match, stop);
+
+                                      position += reached - local;
+                                      tested.fetch_add(reached - local, std::memory_order_relaxed);
+                                      continue;
+                                  }
+
+                                  const std::uint64_t count = std::min({batch_size, chunk.end - position, keyspace.size() - local});
+
+                                  {
+                                      CRACKER_STAGE(generate);
+                                      keyspace.at(local, batch.data());
+                                      for(std::uint64_t i=1; i < count; ++i)
+                                      {
+                                          std::copy_n(&batch[(i-1) * width], width, &batch[i * width]);
+                                          keyspace.increment(&batch[i * width]);
+                                      }
+                                  }
+
+                                  for(std::uint64_t i=0; i < count; ++i)
+                                  {
+                                      std::string_view password(&batch[i * width], width);
+                                      digest password_hash;
+                                      const std::string* hash;
+
+                                      { CRACKER_STAGE(hash); password_hash = (width <= max_block_message ? md5_short(password.data(), width) : md5(password)); }
+                                      { CRACKER_STAGE(probe); hash = node_table.find(password_hash); }
+
+                                      if (hash != nullptr)
+                                          record_crack(*hash, password_hash, std::string(password));
+                                  }
+
+                                  position += count;
+                                  tested.fetch_add(count, std::memory_order_relaxed);
+                              }
+                          }
+                      };
+
+        //The keyspace size is known up front, so the ETA is exact (Job::ranges are a whole attack of their own)
+        if (not job->ranges.empty())
+            return run_workers([&scheduler]() { return scheduler.remaining(); }, untested, 0, worker);
+
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, slice.size(), slice.size() - untested, worker);
+    }
+
+    //(Attempt to) crack all the hashes with the guesses of a PCFG, most likely first -- returns false if interrupted
+    //A single generator produces the guesses in order; workers take blocks of them under a lock and hash them in SIMD batches. Guesses are
+    //numbered in generation order, so the checkpoint is the number of the oldest block still being hashed (a restored run regenerates the
+    //guesses before it without hashing them).
+    inline bool Session::crack_pcfg()
+    {
+        //Number of guesses a worker takes from the generator at a time
+        constexpr std::size_t block_size = 4096;
+
+        //Variables
+        Range slice = job->slice.apply(UINT64_MAX);              //The number of guesses is not known up front: only the limit bounds it
+        pcfg::Generator generator(*job->grammar);
+        std::mutex feed_lock;                                   //Guards the generator and the fields below
+        std::uint64_t next_guess = slice.begin;                //Number of the next guess the generator produces
+        std::vector<std::uint64_t> in_flight(pool.size(), UINT64_MAX);   //First guess of the block each worker is hashing
+        bool exhausted = false;                              //Every guess of the grammar was produced
+
+        if (resume)
+        {
+            next_guess = (resume->workers.empty() ? slice.end : std::max(resume->workers.front().begin, slice.begin));
+            slice.end = (resume->workers.empty() ? slice.end : std::min(resume->workers.front().end, slice.end));   //Job::ranges may end early
+        }
+
+        //Skip the guesses before the slice/checkpoint
+        for(std::uint64_t i=0; i < next_guess and not exhausted; ++i)
+            exhausted = not generator.next(nullptr);
+
+        const std::uint64_t already_done = (job->ranges.empty() ? next_guess - slice.begin : 0);   //Skipped ranges were not tested by this job
+
+        //Unfinished work: from the oldest block in flight to the end of the slice
+        auto remaining = [&]()
+                         {
+                             std::lock_guard<std::mutex> guard(feed_lock);
+                             std::uint64_t begin = *std::min_element(in_flight.begin(), in_flight.end());
+
+                             if (begin == UINT64_MAX and (exhausted or next_guess >= slice.end))
+                                 return std::vector<Range>();
+
+                             return std::vector<Range>{{std::min(begin, next_guess), slice.end}};
+                         };
+
+        //Worker: take the next block of guesses from the generator and hash it
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          const TargetTable& node_table = node_targets(id);
+                          Batch<simd_lanes> batch;
+                          std::vector<std::string> block(block_size);
+
+                          auto match = [this](const std::string& hash, const digest& d, const std::string& password) { record_crack(hash, d, password); };
+
+                          while (not stopping())
+                          {
+                              std::size_t count = 0;
+
+                              {
+                                  CRACKER_STAGE(generate);
+                                  std::lock_guard<std::mutex> guard(feed_lock);
+                                  const std::uint64_t wanted = std::min<std::uint64_t>(block_size, slice.end - next_guess);
+
+                                  while (count < wanted and not exhausted)
+                                  {
+                                      if (generator.next(&block[count]))
+                                          ++count;
+                                      else
+                                          exhausted = true;
+                                  }
+
+                                  in_flight[id] = (count != 0 ? next_guess : UINT64_MAX);
+                                  next_guess += count;
+                              }
+
+                              if (count == 0)
+                                  break;
+
+                              for(std::size_t i=0; i < count; ++i)
+                                  batch.add(block[i], node_table, match);
+
+                              batch.flush(node_table, match);   //Before the block is reported as done
+                              tested.fetch_add(count, std::memory_order_relaxed);
+
+                              std::lock_guard<std::mutex> guard(feed_lock);
+                              in_flight[id] = UINT64_MAX;
+                          }
+                      };
+
+        bool finished = run_workers(remaining, (slice.end != UINT64_MAX ? slice.size() : 0), already_done, worker);
+        report.pcfg_dropped = generator.dropped_guesses();
+
+        return finished;
+    }
+
+
+    //(Attempt to) crack all the hashes with precomputed rainbow tables -- returns false if interrupted
+    //A target whose password is in column k of a chain reaches that chain's end point after reducing it with the function of column k and
+    //following the chain from there. Every target is tried at every column of every table: the work units are (target, table, block of
+    //columns), numbered in a fixed order so they can be split, sliced and checkpointed like a keyspace. Each worker walks 'simd_lanes'
+    //columns of its unit side by side and refills a lane with the next column as soon as its walk reaches the end point. An end point found
+    //in the table is only a candidate chain: it is walked again from its start to column k and the candidate there is hashed to confirm.
+    inline bool Session::crack_rainbow()
+    {
+        //Columns of one work unit
+        constexpr std::uint32_t block_columns = 64;
+        constexpr std::size_t lanes = simd_lanes;
+
+        //Variables
+        std::vector<const rainbow::Table*> mapped;              //Tables of the job
+        std::vector<std::uint64_t> first_unit;                 //Per table: its first unit within a target's units
+        std::uint64_t units_per_target = 0;
+        std::vector<std::pair<const std::string*, digest>> goals;   //Every well-formed target (cracked ones are skipped), sorted by hash
+
+        for(const std::string& filename : job->tables)
+        {
+            mapped.push_back(&table(filename));
+            first_unit.push_back(units_per_target);
+            units_per_target += (mapped.back()->chains().chain_length() - 1 + block_columns - 1) / block_columns;
+        }
+
+        for(const auto& map_entry : hashes)
+            if (std::optional<digest> d = parse_digest(map_entry.first))
+                goals.emplace_back(&map_entry.first, *d);
+
+        std::sort(goals.begin(), goals.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+        const Range slice = job->slice.apply(goals.size() * units_per_target);
+        std::vector<Range> work{slice};
+
+        if (resume)
+        {
+            work.clear();
+            for(const checkpoint::Worker& worker : resume->workers)
+                work.push_back({worker.begin, std::min(worker.end, slice.end)});
+        }
+
+        std::uint64_t untested = 0;
+        for(const Range& range : work)
+            untested += range.size();
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size(), 1, 16));
+
+        //Whether a target was cracked (by this attack, or before it started)
+        auto cracked_goal = [this, &goals](std::size_t goal)
+                            {
+                                std::lock_guard<std::mutex> guard(crack_lock);
+                                return hashes[*goals[goal].first].has_value();
+                            };
+
+        //Worker: take units and walk their columns
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          std::uint64_t index[lanes], next[lanes];
+                          std::uint32_t columns[lanes], origins[lanes];
+                          Range chunk;
+
+                          while (not stopping() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t unit = chunk.begin; unit < chunk.end; ++unit)
+                              {
+                                  if (stopping())
+                                  {
+                                      scheduler.release(id, unit);   //The rest of this chunk stays in the checkpoint
+                                      break;
+                                  }
+
+                                  const std::size_t goal = unit / units_per_target;
+                                  const std::uint64_t part = unit % units_per_target;
+                                  const std::size_t t = static_cast<std::size_t>(std::upper_bound(first_unit.begin(), first_unit.end(), part) - first_unit.begin()) - 1;
+                                  const rainbow::Table& rainbow_table = *mapped[t];
+                                  const rainbow::Chains& chains = rainbow_table.chains();
+                                  const std::uint32_t last = chains.chain_length() - 1;                       //Column of the end points
+                                  const std::uint32_t low = static_cast<std::uint32_t>(part - first_unit[t]) * block_columns;
+                                  const digest& target = goals[goal].second;
+                                  const std::uint32_t target_a = target[0] | target[1] << 8 | target[2] << 16 | static_cast<std::uint32_t>(target[3]) << 24;
+                                  const std::uint32_t target_b = target[4] | target[5] << 8 | target[6] << 16 | static_cast<std::uint32_t>(target[7]) << 24;
+
+                                  if (cracked_goal(goal))
+                                      continue;
+
+                                  std::uint32_t pending = std::min(low + block_columns, last);   //Columns [low, pending) are still to start, highest first
+                                  std::size_t active = 0;
+                                  bool found = false;
+
+                                  std::fill_n(index, lanes, 0);   //Idle lanes hash a valid candidate
+
+                                  //Look an end point up and confirm the chain it belongs to
+                                  auto check = [&](std::uint64_t end, std::uint32_t origin)
+                                               {
+                                                   std::optional<std::uint64_t> start;
+
+                                                   { CRACKER_STAGE(probe); start = rainbow_table.find(end); }
+
+                                                   if (not start)
+                                                       return;
+
+                                                   const std::uint64_t index_at = chains.walk(*start, 0, origin);
+                                                   tested.fetch_add(origin + 1, std::memory_order_relaxed);
+
+                                                   if (chains.hash(index_at) != target)
+                                                       return;   //False alarm: another chain merged into this one after column 'origin'
+
+                                                   char password[max_block_message];
+                                                   record_crack(*goals[goal].first, target, std::string(password, chains.candidate(index_at, password)));
+                                                   found = true;
+                                               };
+
+                                  //Start the walk of the next column in a lane (its first link comes from the target itself); walks that
+                                  //start in the column before the end point are finished right away
+                                  auto refill = [&](std::size_t lane)
+                                                {
+                                                    while (pending > low and not found)
+                                                    {
+                                                        const std::uint32_t origin = --pending;
+                                                        const std::uint64_t reduced = chains.reduce(target_a, target_b, origin);
+
+                                                        if (origin + 1 == last)
+                                                        {
+                                                            check(reduced, origin);
+                                                            continue;
+                                                        }
+
+                                                        index[lane] = reduced;
+                                                        columns[lane] = origin + 1;
+                                                        origins[lane] = origin;
+                                                        return true;
+                                                    }
+
+                                                    return false;
+                                                };
+
+                                  for(std::size_t lane=0; lane < lanes; ++lane)
+                                  {
+                                      if (refill(lane))
+                                          active = lane + 1;
+                                      else
+                                          break;
+                                  }
+
+                                  //Lanes [0, active) are walking; a lane that runs out of columns is swapped with the last active one
+                                  while (active != 0 and not found)
+                                  {
+                                      { CRACKER_STAGE(hash); chains.step<lanes>(index, columns, next); }
+                                      tested.fetch_add(active, std::memory_order_relaxed);
+
+                                      for(std::size_t lane=0; lane < active;)
+                                      {
+                                          index[lane] = next[lane];
+
+                                          if (++columns[lane] < last)
+                                          {
+                                              ++lane;
+                                              continue;
+                                          }
+
+                                          check(index[lane], origins[lane]);
+
+                                          if (refill(lane))
+                                          {
+                                              ++lane;
+                                              continue;
+                                          }
+
+                                          --active;
+                                          index[lane] = index[active];
+                                          next[lane] = next[active];
+                                          columns[lane] = columns[active];
+                                          origins[lane] = origins[active];
+                                      }
+                                  }
+                              }
+                          }
+                      };
+
+        //The number of links walked per unit is not known up front (end points that turn out to be false alarms add to it)
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, 0, (resume ? resume->progress : 0), worker);
+    }
+
+    //(Attempt to) crack all the hashes by looking them up in a digest index -- returns false if interrupted
+    //The wordlist (and its rules) were hashed once when the index was built; a lookup reads one bucket of the index per target and hashes
+    //only the candidates whose stored digest bytes match, so the work units are the targets themselves.
+    inline bool Session::crack_index()
+    {
+        //Variables
+        const hashindex::Index& lookup = digest_index(job->index);
+        const Dictionary& words = dictionary(lookup.dictionary());
+        const rules::RuleSet& rule_set = lookup.rules();
+        std::vector<std::pair<const std::string*, digest>> goals;   //Every well-formed target (cracked ones are skipped), sorted by hash
+
+        //Offsets into any other version of the wordlist would silently miss cracks (every hit is confirmed by hashing)
+        hashindex::Fingerprint current;
+
+        try
+        {
+            current = hashindex::fingerprint(lookup.dictionary());
+        }
+        catch (const std::runtime_error& error)
+        {
+            throw SessionError(error.what(), 2);
+        }
+
+        if (current != lookup.dictionary_fingerprint() or words.size() != current.size)
+            throw SessionError("the wordlist \"" + lookup.dictionary() + "\" changed since the index \"" + job->index + "\" was built", 2);
+
+        for(const auto& map_entry : hashes)
+            if (std::optional<digest> d = parse_digest(map_entry.first))
+                goals.emplace_back(&map_entry.first, *d);
+
+        std::sort(goals.begin(), goals.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+        const Range slice = job->slice.apply(goals.size());
+        std::vector<Range> work{slice};
+
+        if (resume)
+        {
+            work.clear();
+            for(const checkpoint::Worker& worker : resume->workers)
+                work.push_back({worker.begin, std::min(worker.end, slice.end)});
+        }
+
+        std::uint64_t untested = 0;
+        for(const Range& range : work)
+            untested += range.size();
+
+        Scheduler scheduler(work, pool.size(), Scheduler::chunk_size(untested, pool.size(), 1, 1 << 10));
+
+        //Worker: look the targets of a chunk up and hash their candidates
+        auto worker = [&](std::size_t id, std::atomic<std::uint64_t>& tested)
+                      {
+                          std::string candidate;
+                          Range chunk;
+
+                          while (not stopping() and scheduler.next(id, chunk))
+                          {
+                              for(std::uint64_t goal = chunk.begin; goal < chunk.end; ++goal)
+                              {
+                                  if (stopping())
+                                  {
+                                      scheduler.release(id, goal);   //The rest of this chunk stays in the checkpoint
+                                      break;
+                                  }
+
+                                  {
+                                      std::lock_guard<std::mutex> guard(crack_lock);
+                                      if (hashes[*goals[goal].first].has_value())
+                                          continue;
+                                  }
+
+                                  const digest& target = goals[goal].second;
+                                  std::vector<std::pair<std::uint64_t, std::uint64_t>> sources;   //(line offset, rule number)
+
+                                  { CRACKER_STAGE(probe); lookup.candidates(target, [&sources](std::uint64_t line, std::uint64_t rule) { sources.emplace_back(line, rule); }); }
+
+                                  for(const auto& [line, rule] : sources)
+                                  {
+                                      if (line >= words.size() or (rule_set.empty() ? rule != 0 : rule >= rule_set.size()))
+                                          continue;   //Cannot come from a well-formed index of this wordlist
+
+                                      std::string_view word = words.line(line);
+
+                                      if (not rule_set.empty())
+                                      {
+                                          if (not rule_set[rule].apply(word, candidate))
+                                              continue;
+                                          word = candidate;
+                                      }
+
+                                      tested.fetch_add(1, std::memory_order_relaxed);
+
+                                      digest d;
+                                      { CRACKER_STAGE(hash); d = md5(word); }
+
+                                      if (d == target)
+                                      {
+                                          record_crack(*goals[goal].first, target, std::string(word));
+                                          break;
+                                      }
+                                  }
+                              }
+                          }
+                      };
+
+        //The counter holds the candidates hashed to confirm a lookup, which is not known up front
+        return run_workers([&scheduler]() { return scheduler.remaining(); }, 0, (resume ? resume->progress : 0), worker);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Load the hashes of a file (CAN THROW SessionError) -- see load(std::istream&)
+    inline void Session::load(const std::string& filename, std::vector<std::string>* keys)
+    {
+        std::ifstream hash_list(filename);
+
+        if (not hash_list.good())
+            throw SessionError("the file \"" + filename + "\" could not be found", 2);
+
+        load(hash_list, keys);
+    }
+
+    //Add the hashes of a list to the targets -- hashes already in the potfile are resolved immediately
+    //Lines are either a bare hash or 'user:hash' / 'email:hash' (the hash is what follows the last ':'); the usernames are kept for the
+    //association attack. If 'keys' is given, it receives the key of every hash of the list (to tell which results belong to it).
+    inline void Session::load(std::istream& hash_list, std::vector<std::string>* keys)
+    {
+        std::string line;
+
+        if (pot != nullptr)
+            pot->refresh();   //Pick up what other processes cracked since the last job
+
+        while (std::getline(hash_list, line))
+        {
+            //'user:hash': keep only the hash as the key, remember who it belongs to
+            std::size_t colon = line.rfind(':');
+
+            if (colon != std::string::npos and parse_digest(std::string_view(line).substr(colon + 1)))
+            {
+                if (colon != 0)
+                    users.emplace_back(line.substr(0, colon), line.substr(colon + 1));
+
+                line.erase(0, colon + 1);
+            }
+
+            //Look the hash up in the potfile first: a hit never has to be hashed again
+            std::optional<std::string> known;
+            std::optional<digest> d = parse_digest(line);
+
+            if (pot != nullptr and d)
+            {
+                if (auto plaintext = pot->find(*d))
+                    known = std::string(*plaintext);
+            }
+
+            if (keys != nullptr)
+                keys->push_back(line);
+
+            hashes.insert({std::move(line), std::move(known)});
+        }
+
+        count_cracked();
+    }
+
+    //Forget every target and result, and a pending stop() (the potfile, the threads and the mapped dictionaries stay)
+    inline void Session::clear()
+    {
+        stop_requested = false;
+        hashes.clear();
+        users.clear();
+        targets = TargetTable();
+        replicas.clear();
+        count_cracked();
+    }
+
+    //Return the result table (hash -> optional<cracked password>)
+    [[nodiscard]] inline const passwd_hashmap& Session::results() const noexcept
+    {
+        return hashes;
+    }
+
+    //Return the (username, hash) pairs of the 'user:hash' lines
+    [[nodiscard]] inline const user_list& Session::accounts() const noexcept
+    {
+        return users;
+    }
+
+    //Return the potfile (nullptr without one), e.g. to train a Markov order or a grammar from it
+    [[nodiscard]] inline const potfile::Potfile* Session::potfile() const noexcept
+    {
+        return pot.get();
+    }
+
+    //Set the function called for every crack (from the worker threads, one call at a time -- keep it short)
+    inline void Session::on_crack(std::function<void(const Crack&)> function)
+    {
+        std::lock_guard<std::mutex> guard(crack_lock);
+        handler = std::move(function);
+    }
+
+    //Take the oldest crack from the queue (SessionOptions::queue_cracks) -- returns false if it is empty
+    inline bool Session::next_crack(Crack& crack)
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+
+        if (queue.empty())
+            return false;
+
+        crack = std::move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    //Crack the current targets with a job (blocks until it is finished or stopped) -- returns false if it was stopped with work left,
+    //which is then in the checkpoint (CAN THROW SessionError)
+    inline bool Session::run(const Job& new_job)
+    {
+        if (busy.exchange(true))
+            throw SessionError("the session is already running a job", 1);
+
+        job = &new_job;
+
+        try
+        {
+            bool finished = execute();
+            job = nullptr;
+            stop_requested = false;
+            busy = false;
+            return finished;
+        }
+        catch (...)
+        {
+            job = nullptr;
+            stop_requested = false;
+            busy = false;
+            throw;
+        }
+    }
+
+    //Ask the running job to stop (from any thread): the workers stop at their next candidate and the rest goes into the checkpoint. A stop
+    //requested between two jobs applies to the next one (so a job that is about to start can be cancelled too).
+    inline void Session::stop() noexcept
+    {
+        stop_requested = true;
+    }
+
+    //Return a snapshot of the targets and of the progress of the current (or last) attack
+    [[nodiscard]] inline Status Session::status() const
+    {
+        Status now;
+        const std::int64_t since = started.load();
+
+        now.running = busy.load();
+        now.tested = tested.load();
+        now.total = total.load();
+        now.targets = loaded.load();
+        now.cracked = cracked.load();
+
+        if (since != 0)
+            now.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(since)).count();
+
+        if (now.seconds > 0)
+            now.hashes_per_second = (now.tested - std::min(now.tested, start_done.load())) / now.seconds;
+
+        return now;
+    }
+
+    //Return what the last job did besides cracking
+    [[nodiscard]] inline const Report& Session::last_report() const noexcept
+    {
+        return report;
+    }
+
+    //Unmap the dictionaries, rainbow tables and digest indexes kept from earlier jobs (e.g. after a wordlist was replaced on disk)
+    inline void Session::drop_dictionaries()
+    {
+        dictionaries.clear();
+        tables.clear();
+        indexes.clear();
+    }
+
+    //Return the name of an attack mode (as recorded in checkpoints)
+    [[nodiscard]] inline const char* Session::mode_name(Job::Mode mode) noexcept
+    {
+        switch (mode)
+        {
+            case Job::Mode::dict:        return "dict";
+            case Job::Mode::combinator:  return "combinator";
+            case Job::Mode::hybrid:      return "hybrid";
+            case Job::Mode::brute:       return "brute";
+            case Job::Mode::pcfg:        return "pcfg";
+            case Job::Mode::rainbow:     return "rainbow";
+            case Job::Mode::index:       return "index";
+        }
+
+        return "dict";
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Dictionary file names, "i/N" node specs
+#include <string_view>          //Parsing "i/N"
+#include <optional>            //'--limit' is optional
+#include <stdexcept>          //std::invalid_argument, std::runtime_error
+#include <vector>            //Read buffer
+#include <limits>           //UINT64_MAX
+#include <cstdio>          //std::fopen/std::fread (much faster than std::getline for counting lines)
+#include <cstring>        //std::memchr
+#include <cstdint>       //64-bit indices
+
+//Custom Libraries
+#include "scheduler.hpp"   //cracker::Range
+
+namespace cracker
+{
+    //Which part of a keyspace (candidate indices) or dictionary (line numbers) this process works on:
+    //'--skip'/'--limit' select a window, '--node i/N' then takes the i-th of N equal, contiguous parts of that window.
+    //Slices are exact and deterministic, so N processes with nodes 1/N ... N/N cover the window exactly once.
+    struct Slice
+    {
+        std::uint64_t skip = 0;                         //Candidates/lines skipped at the start
+        std::optional<std::uint64_t> limit;            //Maximum number of candidates/lines (all of them if unset)
+        std::uint64_t node = 1;                       //This process' part (1-based)
+        std::uint64_t nodes = 1;                     //Number of parts
+
+        [[nodiscard]] bool whole() const noexcept { return skip == 0 and not limit and nodes == 1; }
+        [[nodiscard]] Range apply(std::uint64_t) const noexcept;
+    };
+
+
+    // ***** FREE FUNCTIONS ***** //
+
+    //Parse "i/N" (1 <= i <= N) -- CAN THROW std::invalid_argument
+    inline void parse_node(std::string_view spec, Slice& slice)
+    {
+        std::size_t slash = spec.find('/');
+
+        if (slash == std::string_view::npos)
+            throw std::invalid_argument("node must be given as i/N");
+
+        slice.node = std::stoull(std::string(spec.substr(0, slash)));
+        slice.nodes = std::stoull(std::string(spec.substr(slash + 1)));
+
+        if (slice.nodes == 0 or slice.node == 0 or slice.node > slice.nodes)
+            throw std::invalid_argument("node must satisfy 1 <= i <= N");
+    }
+
+    //Return the range of [0, total) this slice covers
+    [[nodiscard]] inline Range Slice::apply(std::uint64_t total) const noexcept
+    {
+        std::uint64_t begin = std::min(skip, total);
+        std::uint64_t end = (limit and *limit < total - begin ? begin + *limit : total);
+
+        //Boundaries of part i are begin + floor(length * (i-1) / N) (128-bit so huge keyspaces cannot overflow)
+        unsigned __int128 length = end - begin;
+        return {begin + static_cast<std::uint64_t>(length * (node - 1) / nodes),
+                begin + static_cast<std::uint64_t>(length * node / nodes)};
+    }
+
+    //Count the lines of a file (a last line without a trailing newline counts too) -- CAN THROW std::runtime_error
+    inline std::uint64_t count_lines(const std::string& filename)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "rb");
+        std::vector<char> buffer(1 << 20);
+        std::uint64_t lines = 0;
+        char last = '\n';
+
+        if (file == nullptr)
+            throw std::runtime_error("the file \"" + filename + "\" could not be found");
+
+        while (std::size_t read = std::fread(buffer.data(), 1, buffer.size(), file))
+        {
+            for(const char* p = buffer.data(); (p = static_cast<const char*>(std::memchr(p, '\n', buffer.data() + read - p))); ++p)
+                ++lines;
+
+            last = buffer[read - 1];
+        }
+
+        std::fclose(file);
+        return lines + (last != '\n');
+    }
+
+    //Translate a range of line numbers into the byte range of those lines -- CAN THROW std::runtime_error
+    inline Range line_bytes(const std::string& filename, Range lines)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "rb");
+        std::vector<char> buffer(1 << 20);
+        std::uint64_t line = 0, offset = 0;
+        Range bytes{std::numeric_limits<std::uint64_t>::max(), std::numeric_limits<std::uint64_t>::max()};
+
+        if (file == nullptr)
+            throw std::runtime_error("the file \"" + filename + "\" could not be found");
+
+        if (lines.empty())
+        {
+            std::fclose(file);
+            return {0, 0};
+        }
+
+        if (lines.begin == 0)
+            bytes.begin = 0;
+
+        //Line n starts right after the n-th newline
+        while (line < lines.end)
+        {
+            std::size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+
+            if (read == 0)
+                break;
+
+            for(const char* p = buffer.data(); line < lines.end and (p = static_cast<const char*>(std::memchr(p, '\n', buffer.data() + read - p))); ++p)
+            {
+                ++line;
+                std::uint64_t start = offset + static_cast<std::uint64_t>(p - buffer.data()) + 1;
+
+                if (line == lines.begin)
+                    bytes.begin = start;
+                if (line == lines.end)
+                    bytes.end = start;
+            }
+
+            offset += read;
+        }
+
+        std::fclose(file);
+
+        //A range that starts past the last newline is empty (its end stays "until the end of the file")
+        if (bytes.begin == std::numeric_limits<std::uint64_t>::max())
+            bytes.begin = offset;
+
+        return bytes;
+    }
+}
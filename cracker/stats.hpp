@@ -0,0 +1,287 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //File names, JSON
+#include <vector>               //Per-thread counters
+#include <memory>              //Counters stay where they are when more threads register
+#include <mutex>              //Registration of new threads
+#include <atomic>            //Counters written by their thread, read by the exporter
+#include <chrono>           //Timers
+#include <fstream>         //JSON export
+#include <cstdio>         //std::rename
+#include <cstdint>       //Counters
+#include <algorithm>    //std::min
+
+//Define CRACKER_NO_STATS (g++ -DCRACKER_NO_STATS ...) to compile every CRACKER_STAGE() away
+#ifndef CRACKER_NO_STATS
+    #define CRACKER_STAGE_CONCAT(a, b) a##b
+    #define CRACKER_STAGE_NAME(line) CRACKER_STAGE_CONCAT(cracker_stage_timer_, line)
+    #define CRACKER_STAGE(stage) cracker::StageTimer CRACKER_STAGE_NAME(__LINE__)(cracker::Stage::stage)
+    #define CRACKER_BATCH_TIMER() cracker::BatchTimer CRACKER_STAGE_NAME(__LINE__)
+#else
+    #define CRACKER_STAGE(stage) ((void)0)
+    #define CRACKER_BATCH_TIMER() ((void)0)
+#endif
+
+namespace cracker
+{
+    //Stages of the hot path that '--stats-file' reports separately
+    enum class Stage : unsigned { read, generate, hash, prefilter, probe, write };
+    constexpr unsigned stage_count = 6;
+    constexpr const char* stage_names[stage_count] = {"read", "generate", "hash", "prefilter", "probe", "write"};
+
+    //Counters of one thread (one cache line apart from the other threads'). Only the owning thread writes them, with plain relaxed
+    //load + store pairs (no locked instructions); the exporter reads them at any time.
+    struct alignas(64) ThreadStats
+    {
+        static constexpr unsigned buckets = 32;        //Batch latency histogram: bucket i counts batches of [2^i, 2^(i+1)) ns
+
+        std::atomic<std::uint64_t> calls[stage_count] = {};          //Every entry into a stage
+        std::atomic<std::uint64_t> sampled[stage_count] = {};       //Entries that were timed
+        std::atomic<std::uint64_t> nanoseconds[stage_count] = {};  //Time of the timed entries
+        std::atomic<std::uint64_t> latency[buckets] = {};         //Timed batches by latency
+
+        static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+
+    //Class 'Stats' collects the per-thread counters of the stages and writes them as JSON ('--stats-file'). Timing every call would cost
+    //more than many of the stages themselves, so one call in 'sample_every' is timed and the total time is extrapolated from the call count.
+    //Nothing is counted until enable() is called, and every call starts the counts over (a session calls it for every job).
+    class Stats final
+    {
+        private:
+            std::mutex lock;                                       //Guards 'threads'
+            std::vector<std::unique_ptr<ThreadStats>> threads;    //Counters of every thread that ever entered a stage
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            Stats() = default;
+
+        public:
+            static constexpr std::uint64_t sample_every = 64;    //Power of two
+            static inline std::atomic<bool> enabled = false;
+            static inline std::uint64_t clock_cost = 0;           //Nanoseconds a timer measures around nothing (subtracted from samples)
+
+            //General methods
+            [[nodiscard]] static Stats& global();
+            [[nodiscard]] static ThreadStats& local();
+            static void enable();
+
+            void write_json(const std::string&);
+    };
+
+    //Scoped timer of one stage entry (see CRACKER_STAGE)
+    class StageTimer final
+    {
+        private:
+            ThreadStats* stats = nullptr;         //nullptr if not counted
+            unsigned stage;
+            bool timed = false;
+            std::chrono::steady_clock::time_point begin;
+
+        public:
+            //Special methods
+            explicit StageTimer(Stage) noexcept;
+            ~StageTimer();
+            StageTimer(const StageTimer&) = delete;
+            StageTimer& operator=(const StageTimer&) = delete;
+    };
+
+    //Scoped timer of a whole batch (hash + prefilter + probe) for the latency histogram (see CRACKER_BATCH_TIMER)
+    class BatchTimer final
+    {
+        private:
+            ThreadStats* stats = nullptr;         //nullptr if not timed
+            std::chrono::steady_clock::time_point begin;
+            inline static thread_local std::uint64_t batches = 0;
+
+        public:
+            //Special methods
+            BatchTimer() noexcept;
+            ~BatchTimer();
+            BatchTimer(const BatchTimer&) = delete;
+            BatchTimer& operator=(const BatchTimer&) = delete;
+    };
+
+
+    // ***** STATS ***** //
+
+    //Return the process-wide statistics
+    [[nodiscard]] inline Stats& Stats::global()
+    {
+        static Stats stats;
+        return stats;
+    }
+
+    //Return the counters of the calling thread (registered on first use)
+    [[nodiscard]] inline ThreadStats& Stats::local()
+    {
+        thread_local ThreadStats* mine = nullptr;
+
+        if (mine == nullptr)
+        {
+            Stats& stats = global();
+            std::lock_guard<std::mutex> guard(stats.lock);
+
+            stats.threads.push_back(std::make_unique<ThreadStats>());
+            mine = stats.threads.back().get();
+        }
+
+        return *mine;
+    }
+
+    //Start counting from zero: the counters of every thread are reset and the elapsed time in the export starts here, so an export covers
+    //the pass since the last call (call it while no stage is running -- the counters are only written by their own thread)
+    inline void Stats::enable()
+    {
+        std::uint64_t cheapest = UINT64_MAX;
+
+        for(int i=0; i < 1000; ++i)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+            cheapest = std::min(cheapest, elapsed);
+        }
+
+        clock_cost = cheapest;
+
+        Stats& stats = global();
+        std::lock_guard<std::mutex> guard(stats.lock);
+
+        for(const auto& thread : stats.threads)
+        {
+            for(unsigned s=0; s < stage_count; ++s)
+            {
+                thread->calls[s].store(0, std::memory_order_relaxed);
+                thread->sampled[s].store(0, std::memory_order_relaxed);
+                thread->nanoseconds[s].store(0, std::memory_order_relaxed);
+            }
+
+            for(unsigned b=0; b < ThreadStats::buckets; ++b)
+                thread->latency[b].store(0, std::memory_order_relaxed);
+        }
+
+        stats.start = std::chrono::steady_clock::now();
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    //Sum the counters of every thread and write them to 'filename' (through a temporary file, so readers never see half a document)
+    inline void Stats::write_json(const std::string& filename)
+    {
+        std::uint64_t calls[stage_count] = {}, sampled[stage_count] = {}, nanoseconds[stage_count] = {}, latency[ThreadStats::buckets] = {};
+        std::size_t thread_count;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            thread_count = threads.size();
+
+            for(const auto& thread : threads)
+            {
+                for(unsigned s=0; s < stage_count; ++s)
+                {
+                    calls[s] += thread->calls[s].load(std::memory_order_relaxed);
+                    sampled[s] += thread->sampled[s].load(std::memory_order_relaxed);
+                    nanoseconds[s] += thread->nanoseconds[s].load(std::memory_order_relaxed);
+                }
+
+                for(unsigned b=0; b < ThreadStats::buckets; ++b)
+                    latency[b] += thread->latency[b].load(std::memory_order_relaxed);
+            }
+        }
+
+        const std::string temporary = filename + ".tmp";
+        std::ofstream out(temporary, std::ios::trunc);
+
+        out << "{\n"
+            << "  \"elapsed_seconds\": " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << ",\n"
+            << "  \"threads\": " << thread_count << ",\n"
+            << "  \"sample_every\": " << sample_every << ",\n"
+            << "  \"stages\": {\n";
+
+        for(unsigned s=0; s < stage_count; ++s)
+        {
+            const double estimated = (sampled[s] != 0 ? 1e-9 * nanoseconds[s] * calls[s] / sampled[s] : 0.0);
+
+            out << "    \"" << stage_names[s] << "\": {\"calls\": " << calls[s] << ", \"timed_calls\": " << sampled[s]
+                << ", \"timed_ns\": " << nanoseconds[s] << ", \"estimated_seconds\": " << estimated << '}'
+                << (s + 1 < stage_count ? ",\n" : "\n");
+        }
+
+        out << "  },\n"
+            << "  \"batch_latency_ns\": [";
+
+        for(unsigned b=0, printed=0; b < ThreadStats::buckets; ++b)
+        {
+            if (latency[b] == 0)
+                continue;
+
+            out << (printed++ != 0 ? ", " : "") << "{\"from\": " << (std::uint64_t(1) << b) << ", \"to\": " << (std::uint64_t(1) << (b + 1))
+                << ", \"batches\": " << latency[b] << '}';
+        }
+
+        out << "]\n}\n";
+        out.close();
+
+        std::rename(temporary.c_str(), filename.c_str());
+    }
+
+
+    // ***** TIMERS ***** //
+
+    //Count the entry, and time it if it is one of the sampled ones
+    inline StageTimer::StageTimer(Stage in_stage) noexcept : stage(static_cast<unsigned>(in_stage))
+    {
+        if (not Stats::enabled.load(std::memory_order_relaxed))
+            return;
+
+        stats = &Stats::local();
+        std::uint64_t calls = stats->calls[stage].load(std::memory_order_relaxed);
+        stats->calls[stage].store(calls + 1, std::memory_order_relaxed);
+
+        if ((calls & (Stats::sample_every - 1)) == 0)
+        {
+            timed = true;
+            begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    //Record the time of a sampled entry
+    inline StageTimer::~StageTimer()
+    {
+        if (not timed)
+            return;
+
+        std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+        ThreadStats::add(stats->sampled[stage], 1);
+        elapsed -= std::min(elapsed, Stats::clock_cost);
+        ThreadStats::add(stats->nanoseconds[stage], elapsed);
+    }
+
+    //Time one batch in 'Stats::sample_every'
+    inline BatchTimer::BatchTimer() noexcept
+    {
+        if (Stats::enabled.load(std::memory_order_relaxed) and (batches++ & (Stats::sample_every - 1)) == 0)
+        {
+            stats = &Stats::local();
+            begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    //Add the batch to the latency histogram
+    inline BatchTimer::~BatchTimer()
+    {
+        if (stats == nullptr)
+            return;
+
+        std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        unsigned bucket = 0;
+
+        while (bucket + 1 < ThreadStats::buckets and (elapsed >> (bucket + 1)) != 0)
+            ++bucket;
+
+        ThreadStats::add(stats->latency[bucket], 1);
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //The hash exactly as it was written in the hashfile
+#include <unordered_map>        //Digest -> hash lookups
+#include <vector>              //Prefilter bitmap
+#include <cstddef>             //std::size_t
+#include <atomic>             //The remaining count is read by every worker thread
+
+//Custom Libraries
+#include "digest.hpp"
+
+namespace cracker
+{
+    //Class 'TargetTable' is the hot lookup structure of the cracking loops: binary digests of the targets that are still uncracked,
+    //mapped back to the hash as written in the hashfile (the key of the result table). Lookups are safe from any number of threads.
+    class TargetTable final
+    {
+        private:
+            std::unordered_map<digest, std::string, digest_hash> targets;    //Uncracked targets
+            std::atomic<std::size_t> remaining = 0;                         //Targets that have not been cracked during this run
+            std::vector<std::uint64_t> filter;                             //Prefilter: one bit per value of the low bits of the first digest word
+            std::uint32_t filter_mask = 0;                                //Number of bits in the prefilter - 1
+
+        public:
+            //Special methods
+            TargetTable() = default;
+            TargetTable(TargetTable&&) noexcept;
+            TargetTable& operator=(TargetTable&&) noexcept;
+
+            //General methods
+            void insert(const digest&, std::string);
+            [[nodiscard]] const std::string* find(const digest&) const noexcept;
+            [[nodiscard]] std::size_t size() const noexcept;
+            [[nodiscard]] bool empty() const noexcept;
+
+            //Copy of the lookup part, made by (and so allocated on the NUMA node of) the calling thread
+            [[nodiscard]] TargetTable replica() const;
+
+            //Prefilter on the first digest word, so SIMD kernels can reject almost every lane without a hash table probe
+            void build_filter();
+            [[nodiscard]] bool maybe(std::uint32_t) const noexcept;
+
+            //Bookkeeping for early termination
+            void mark_cracked() noexcept;
+            [[nodiscard]] bool all_cracked() const noexcept;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Move constructor (std::atomic is not movable itself)
+    inline TargetTable::TargetTable(TargetTable&& other) noexcept
+        : targets(std::move(other.targets)), remaining(other.remaining.load()), filter(std::move(other.filter)), filter_mask(other.filter_mask)
+    {
+    }
+
+    //Move assignment (a session replaces its table with the next job's)
+    inline TargetTable& TargetTable::operator=(TargetTable&& other) noexcept
+    {
+        targets = std::move(other.targets);
+        remaining = other.remaining.load();
+        filter = std::move(other.filter);
+        filter_mask = other.filter_mask;
+        return *this;
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Add a target (duplicates in the hashfile collapse into a single entry)
+    inline void TargetTable::insert(const digest& d, std::string hash)
+    {
+        if (targets.emplace(d, std::move(hash)).second)
+            ++remaining;
+    }
+
+    //Return the hash a digest belongs to, or nullptr if it is not a target
+    [[nodiscard]] inline const std::string* TargetTable::find(const digest& d) const noexcept
+    {
+        auto itr = targets.find(d);
+        return (itr != targets.end() ? &itr->second : nullptr);
+    }
+
+    //Return the number of targets in the table
+    [[nodiscard]] inline std::size_t TargetTable::size() const noexcept
+    {
+        return targets.size();
+    }
+
+    //Return whether there is nothing to crack
+    [[nodiscard]] inline bool TargetTable::empty() const noexcept
+    {
+        return targets.empty();
+    }
+
+    //Return a copy of the targets and the prefilter (the count of uncracked targets stays with this table, which decides when to stop)
+    [[nodiscard]] inline TargetTable TargetTable::replica() const
+    {
+        TargetTable copy;
+
+        copy.targets = targets;
+        copy.filter = filter;
+        copy.filter_mask = filter_mask;
+        return copy;
+    }
+
+    //(Re)build the prefilter after the last insert: ~32 bits per target (between 2^12 and 2^30 bits), so a random word passes with p < 1/32
+    inline void TargetTable::build_filter()
+    {
+        std::uint64_t bits = 1 << 12;
+        while (bits < targets.size() * 32 and bits < (std::uint64_t(1) << 30))
+            bits <<= 1;
+
+        filter.assign(bits / 64, 0);
+        filter_mask = static_cast<std::uint32_t>(bits - 1);
+
+        for(const auto& target : targets)
+        {
+            std::uint32_t a = target.first[0] | (target.first[1] << 8) | (target.first[2] << 16) | (static_cast<std::uint32_t>(target.first[3]) << 24);
+            filter[(a & filter_mask) >> 6] |= std::uint64_t(1) << (a & 63);
+        }
+    }
+
+    //Return whether a digest starting with the (little-endian) word 'a' may be a target (always true before build_filter())
+    [[nodiscard]] inline bool TargetTable::maybe(std::uint32_t a) const noexcept
+    {
+        return filter.empty() or (filter[(a & filter_mask) >> 6] >> (a & 63)) & 1;
+    }
+
+    //Record that one more target was cracked (call once per target, serialized by the caller)
+    inline void TargetTable::mark_cracked() noexcept
+    {
+        if (remaining.load(std::memory_order_relaxed) != 0)
+            remaining.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    //Return whether every target has been cracked, so the attack can stop early
+    [[nodiscard]] inline bool TargetTable::all_cracked() const noexcept
+    {
+        return remaining.load(std::memory_order_relaxed) == 0;
+    }
+}
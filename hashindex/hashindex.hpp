@@ -0,0 +1,600 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //File names, rule lines
+#include <string_view>          //Words of the mapped wordlist
+#include <vector>              //Records being sorted, the fanout table
+#include <atomic>             //Per-thread progress
+#include <mutex>             //Appends to the partition files
+#include <algorithm>        //std::min, std::lower_bound
+#include <fstream>         //Writing an index and its partition files
+#include <stdexcept>      //std::runtime_error, std::invalid_argument
+#include <chrono>        //Progress refresh interval
+#include <thread>       //std::this_thread::sleep_for
+#include <optional>    //The progress line is optional
+#include <cstdint>    //Fixed width record fields
+#include <cstdio>    //std::rename() for atomically replacing an index
+#include <cstring>  //std::memcmp, std::strerror
+#include <cerrno>  //errno
+
+//Native POSIX Libraries
+#include <fcntl.h>       //open()
+#include <unistd.h>     //close()
+#include <sys/mman.h>  //mmap(), munmap(), madvise()
+#include <sys/stat.h> //fstat()
+
+//Custom Libraries
+#include "../cracker/digest.hpp"
+#include "../cracker/md5_lanes.hpp"
+#include "../cracker/dictionary.hpp"
+#include "../cracker/pool.hpp"
+#include "../cracker/progress.hpp"
+#include "../rules/rules.hpp"
+
+namespace hashindex
+{
+    //File layout:  "MD5IDX2\n" header, the wordlist's fingerprint (uint64 size, uint64 modification time in nanoseconds, uint64 checksum
+    //of its first and last 64 KiB), uint64 record count, the wordlist's path as [uint32 length][bytes],
+    //uint32 rule count and every rule as [uint32 length][text], zero padding to a multiple of 8 bytes, the fanout table (uint64 index of
+    //the first record of each of the 65536 buckets, plus the record count), then the records. The first two bytes of a digest pick its
+    //bucket and are not stored: a record is [6 digest bytes][uint40 offset of the word's line][uint24 rule number], sorted by those digest
+    //bytes within its bucket. 48 bits of digest are enough to find the candidates of a target, and every candidate is confirmed by
+    //hashing it, so the rest of the digest is not stored either. Integers are little endian.
+    constexpr char magic[8] = {'M', 'D', '5', 'I', 'D', 'X', '2', '\n'};
+    constexpr std::size_t buckets = 1 << 16;
+    constexpr std::size_t key_bytes = 6;
+    constexpr std::size_t record_size = key_bytes + 5 + 3;
+    constexpr std::uint64_t max_offset = (1ull << 40) - 1;       //Wordlists up to 1 TiB
+    constexpr std::uint64_t max_rules = (1ull << 24) - 1;
+
+    //Identity of a wordlist when its index was built: record offsets are only valid for that exact file, and an edit that keeps the size
+    //still changes the modification time or the checksum of its ends
+    struct Fingerprint
+    {
+        std::uint64_t size = 0;
+        std::uint64_t mtime = 0;         //Nanoseconds since the epoch
+        std::uint64_t checksum = 0;     //FNV-1a of the first and last 64 KiB
+
+        [[nodiscard]] bool operator==(const Fingerprint& other) const noexcept
+        {
+            return size == other.size and mtime == other.mtime and checksum == other.checksum;
+        }
+
+        [[nodiscard]] bool operator!=(const Fingerprint& other) const noexcept
+        {
+            return not (*this == other);
+        }
+    };
+
+    //Class 'Index' maps an index file read-only and finds the (word, rule) pairs whose candidate may hash to a digest. Only the fanout
+    //table is read into memory; a lookup touches one bucket of the mapping, so its cost depends on the number of targets, not on the
+    //size of the wordlist.
+    class Index final
+    {
+        private:
+            const unsigned char* map = nullptr;       //The file
+            std::uint64_t bytes = 0;                 //Size of the file
+            int fd = -1;                            //Descriptor of the file
+            std::string wordlist;                  //Path of the wordlist
+            Fingerprint wordlist_print;          //The wordlist when the index was built
+            rules::RuleSet rule_set;             //Rules applied to every word (none: the words as written)
+            std::vector<std::uint64_t> fanout;  //First record of every bucket (+ the record count)
+            const unsigned char* records = nullptr;
+
+        public:
+            //Special methods
+            explicit Index(const std::string&);
+            ~Index();
+            Index(const Index&) = delete;
+            Index& operator=(const Index&) = delete;
+
+            //General methods
+            [[nodiscard]] const std::string& dictionary() const noexcept;
+            [[nodiscard]] const Fingerprint& dictionary_fingerprint() const noexcept;
+            [[nodiscard]] const rules::RuleSet& rules() const noexcept;
+            [[nodiscard]] std::uint64_t size() const noexcept;
+
+            template <typename Function>
+            void candidates(const cracker::digest&, Function&&) const;
+    };
+
+    Fingerprint fingerprint(const std::string&);
+    std::uint64_t build(const std::string&, const std::string&, const rules::RuleSet&, cracker::ThreadPool&, bool = false);
+
+
+    // ***** HELPERS ***** //
+
+    namespace detail
+    {
+        //Read a little-endian integer of 'width' bytes
+        inline std::uint64_t load(const unsigned char* bytes, unsigned width) noexcept
+        {
+            std::uint64_t value = 0;
+
+            for(unsigned i=0; i < width; ++i)
+                value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+
+            return value;
+        }
+
+        //Write a little-endian integer of 'width' bytes
+        inline void store(std::ostream& out, std::uint64_t value, unsigned width)
+        {
+            for(unsigned i=0; i < width; ++i)
+                out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+
+        //The first 8 bytes of a digest as a big-endian number: sorting by it sorts by bucket, then by the stored digest bytes
+        inline std::uint64_t sort_key(const cracker::digest& d) noexcept
+        {
+            std::uint64_t key = 0;
+
+            for(std::size_t i=0; i < 8; ++i)
+                key = (key << 8) | d[i];
+
+            return key;
+        }
+    }
+
+
+    // ***** INDEX ***** //
+
+    //Constructor: map an index file, read its header and its fanout table -- CAN THROW std::runtime_error
+    inline Index::Index(const std::string& filename)
+    {
+        struct stat info;
+
+        fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            throw std::runtime_error("the index \"" + filename + "\" could not be found");
+
+        if (::fstat(fd, &info) != 0 or info.st_size < static_cast<off_t>(sizeof(magic)))
+        {
+            ::close(fd);
+            throw std::runtime_error("\"" + filename + "\" is not an index");
+        }
+
+        bytes = static_cast<std::uint64_t>(info.st_size);
+        void* region = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (region == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot map \"" + filename + "\": " + std::strerror(errno));
+        }
+
+        ::madvise(region, bytes, MADV_RANDOM);
+        map = static_cast<const unsigned char*>(region);
+
+        //Header: every field is checked against the size of the file before it is read
+        std::uint64_t offset = sizeof(magic);
+        bool valid = (std::memcmp(map, magic, sizeof(magic)) == 0);
+
+        auto field = [&](unsigned width)
+                     {
+                         valid = valid and offset + width <= bytes;
+                         std::uint64_t value = (valid ? detail::load(map + offset, width) : 0);
+                         offset += width;
+                         return value;
+                     };
+
+        auto text = [&]()
+                    {
+                        std::uint64_t size = field(4);
+                        valid = valid and offset + size <= bytes;
+                        std::string value = (valid ? std::string(reinterpret_cast<const char*>(map + offset), size) : std::string());
+                        offset += size;
+                        return value;
+                    };
+
+        wordlist_print.size = field(8);
+        wordlist_print.mtime = field(8);
+        wordlist_print.checksum = field(8);
+        std::uint64_t count = field(8);
+        wordlist = text();
+
+        try
+        {
+            for(std::uint64_t rule_count = field(4); valid and rule_count != 0; --rule_count)
+                rule_set.add(text());
+        }
+        catch (const std::invalid_argument&)
+        {
+            valid = false;
+        }
+
+        offset = (offset + 7) / 8 * 8;
+        valid = valid and count <= bytes / record_size and offset + (buckets + 1) * 8 + count * record_size == bytes;
+
+        for(std::size_t bucket=0; valid and bucket <= buckets; ++bucket)
+        {
+            fanout.push_back(field(8));
+            valid = (fanout.back() <= count and (bucket == 0 or fanout[bucket - 1] <= fanout.back()));
+        }
+
+        if (not valid or fanout.back() != count)
+        {
+            ::munmap(const_cast<unsigned char*>(map), bytes);
+            ::close(fd);
+            throw std::runtime_error("\"" + filename + "\" is not an index (or it is truncated)");
+        }
+
+        records = map + offset;
+    }
+
+    //Destructor
+    inline Index::~Index()
+    {
+        ::munmap(const_cast<unsigned char*>(map), bytes);
+        ::close(fd);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the path of the wordlist the index was built from
+    [[nodiscard]] inline const std::string& Index::dictionary() const noexcept
+    {
+        return wordlist;
+    }
+
+    //Return the fingerprint the wordlist had when the index was built (a different one means the offsets may be stale)
+    [[nodiscard]] inline const Fingerprint& Index::dictionary_fingerprint() const noexcept
+    {
+        return wordlist_print;
+    }
+
+    //Return the rules the index was built with
+    [[nodiscard]] inline const rules::RuleSet& Index::rules() const noexcept
+    {
+        return rule_set;
+    }
+
+    //Return the number of records (candidates)
+    [[nodiscard]] inline std::uint64_t Index::size() const noexcept
+    {
+        return fanout.back();
+    }
+
+    //Call 'function(line offset, rule number)' for every record that may hash to 'd' (usually none or one; the caller confirms them)
+    template <typename Function>
+    inline void Index::candidates(const cracker::digest& d, Function&& function) const
+    {
+        const std::size_t bucket = (static_cast<std::size_t>(d[0]) << 8) | d[1];
+        const unsigned char* key = d.data() + 2;
+        std::uint64_t low = fanout[bucket], high = fanout[bucket + 1];
+
+        //Binary search for the first record of the bucket whose digest bytes are not below the target's
+        while (low < high)
+        {
+            std::uint64_t middle = low + (high - low) / 2;
+
+            if (std::memcmp(records + middle * record_size, key, key_bytes) < 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        for(; low < fanout[bucket + 1] and std::memcmp(records + low * record_size, key, key_bytes) == 0; ++low)
+        {
+            const unsigned char* record = records + low * record_size;
+            function(detail::load(record + key_bytes, 5), detail::load(record + key_bytes + 5, 3));
+        }
+    }
+
+
+    // ***** BUILDING ***** //
+
+    //Return the current fingerprint of a wordlist -- CAN THROW std::runtime_error (an unreadable file)
+    inline Fingerprint fingerprint(const std::string& filename)
+    {
+        constexpr std::uint64_t end_bytes = 64 << 10;
+
+        struct stat info;
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0 or ::fstat(fd, &info) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+
+            throw std::runtime_error("the file \"" + filename + "\" could not be found");
+        }
+
+        Fingerprint print;
+        print.size = static_cast<std::uint64_t>(info.st_size);
+        print.mtime = static_cast<std::uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(info.st_mtim.tv_nsec);
+        print.checksum = 14695981039346656037ull;
+
+        //The first 64 KiB, then the last 64 KiB (overlapping on small files)
+        std::vector<unsigned char> buffer(end_bytes);
+
+        for(std::uint64_t start : {std::uint64_t(0), print.size - std::min(print.size, end_bytes)})
+        {
+            ssize_t got = ::pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(start));
+
+            for(ssize_t i=0; i < got; ++i)
+                print.checksum = (print.checksum ^ buffer[i]) * 1099511628211ull;
+        }
+
+        ::close(fd);
+        return print;
+    }
+
+    //Hash every word of a wordlist with every rule (the words as written without rules) on every thread of 'pool', radix sort the digests
+    //and write the index to 'filename'. The records (16 bytes each) are spilled to 256 temporary files next to the index by the top 8 bits
+    //of their digest and sorted one file at a time, so the build needs as much free disk as the records and about 32 bytes of memory
+    //per record of the largest file (1/256 of the records) -- CAN THROW std::runtime_error (files) and std::invalid_argument (a wordlist or rule set too large
+    //for the record fields). The wordlist's path is recorded as given, so it should be absolute for indexes that are used from other
+    //directories. Returns the number of records written.
+    inline std::uint64_t build(const std::string& filename, const std::string& wordlist, const rules::RuleSet& rule_set, cracker::ThreadPool& pool,
+                               bool progress_line)
+    {
+        constexpr std::size_t lanes = cracker::simd_lanes;
+
+        //Record being sorted: the sort key (first 8 digest bytes) and where the candidate comes from (offset | rule << 40)
+        struct Record
+        {
+            std::uint64_t key;
+            std::uint64_t source;
+        };
+
+        //Temporary files of the partitions (the top 8 bits of the sort key), removed however the build ends
+        struct Spill
+        {
+            std::vector<std::string> names;
+            std::vector<std::ofstream> files;
+
+            ~Spill()
+            {
+                files.clear();
+
+                for(const std::string& name : names)
+                    std::remove(name.c_str());
+            }
+        };
+
+        constexpr std::size_t partitions = 256;
+        constexpr std::size_t spill_records = 4096;      //Per thread and partition, appended to the partition's file together
+
+        const Fingerprint wordlist_print = fingerprint(wordlist);
+        const cracker::Dictionary words(wordlist);
+
+        if (words.size() > max_offset or rule_set.size() > max_rules)
+            throw std::invalid_argument("an index holds wordlists of up to 1 TiB and up to " + std::to_string(max_rules) + " rules");
+
+        //Written next to the index and renamed over it, so an interrupted run never leaves a truncated index behind (opened first, so an
+        //unwritable path fails before the wordlist is hashed)
+        const std::string temporary = filename + ".tmp";
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+
+        if (not out.good())
+            throw std::runtime_error("cannot write \"" + temporary + "\": " + std::strerror(errno));
+
+        Spill spill;
+        std::vector<std::mutex> locks(partitions);                       //Guard the partition files
+        std::vector<std::vector<std::uint64_t>> counts(pool.size());      //Records of every bucket, per thread
+        std::vector<std::atomic<std::uint64_t>> hashed(pool.size());
+
+        for(std::size_t part=0; part < partitions; ++part)
+        {
+            spill.names.push_back(temporary + "." + std::to_string(part));
+            spill.files.emplace_back(spill.names.back(), std::ios::binary | std::ios::trunc);
+        }
+
+        //Worker: the lines that start in an equal share of the file; candidates that fit one block are hashed 'lanes' at a time
+        pool.start([&](std::size_t id)
+                   {
+                       const std::uint64_t end = words.size() / pool.size() * (id + 1) + (id + 1 == pool.size() ? words.size() % pool.size() : 0);
+                       std::vector<std::vector<Record>> pending(partitions);
+                       std::vector<std::uint64_t>& bucket_counts = counts[id];
+                       cracker::SoaBlock<lanes> block;
+                       cracker::vec<lanes> state[4];
+                       std::uint64_t sources[lanes];
+                       std::uint32_t w[16];
+                       std::size_t queued = 0;
+                       std::string candidate;
+
+                       bucket_counts.assign(buckets, 0);
+
+                       auto spill_part = [&](std::size_t part)
+                                         {
+                                             std::lock_guard<std::mutex> guard(locks[part]);
+
+                                             spill.files[part].write(reinterpret_cast<const char*>(pending[part].data()),
+                                                                     static_cast<std::streamsize>(pending[part].size() * sizeof(Record)));
+                                             pending[part].clear();
+                                         };
+
+                       auto keep = [&](std::uint64_t key, std::uint64_t source)
+                                   {
+                                       std::vector<Record>& part = pending[key >> 56];
+
+                                       ++bucket_counts[key >> 48];
+                                       part.push_back({key, source});
+
+                                       if (part.size() == spill_records)
+                                           spill_part(key >> 56);
+                                   };
+
+                       auto flush = [&]()
+                                    {
+                                        cracker::md5_compress(block.w, state);
+
+                                        for(std::size_t lane=0; lane < queued; ++lane)
+                                            keep(detail::sort_key(cracker::words_to_digest(state[0][lane], state[1][lane], state[2][lane], state[3][lane])),
+                                                 sources[lane]);
+
+                                        hashed[id].fetch_add(queued, std::memory_order_relaxed);
+                                        queued = 0;
+                                    };
+
+                       auto add = [&](std::string_view word, std::uint64_t source)
+                                  {
+                                      if (word.size() > cracker::max_block_message)
+                                      {
+                                          keep(detail::sort_key(cracker::md5(word)), source);
+                                          return;
+                                      }
+
+                                      cracker::pad_block(word.data(), word.size(), w);
+
+                                      for(std::size_t i=0; i < 16; ++i)
+                                          block.w[i][queued] = w[i];
+
+                                      sources[queued] = source;
+
+                                      if (++queued == lanes)
+                                          flush();
+                                  };
+
+                       for(std::uint64_t line = words.line_start(words.size() / pool.size() * id); line < end;)
+                       {
+                           std::string_view word = words.line(line);
+
+                           if (rule_set.empty())
+                               add(word, line);
+
+                           for(std::size_t rule=0; rule < rule_set.size(); ++rule)
+                               if (rule_set[rule].apply(word, candidate))
+                                   add(candidate, line | static_cast<std::uint64_t>(rule) << 40);
+
+                           line += word.size() + 1;
+                       }
+
+                       if (queued != 0)
+                           flush();
+
+                       for(std::size_t part=0; part < partitions; ++part)
+                           if (not pending[part].empty())
+                               spill_part(part);
+                   });
+
+        //Monitor (this thread): the progress line while the workers run
+        std::optional<cracker::Progress> progress;
+
+        auto done = [&]()
+                    {
+                        std::uint64_t sum = 0;
+                        for(const auto& count : hashed)
+                            sum += count.load(std::memory_order_relaxed);
+                        return sum;
+                    };
+
+        if (progress_line)
+            progress.emplace();
+
+        while (pool.running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            if (progress)
+                progress->refresh(done());
+        }
+
+        pool.wait();
+
+        if (progress)
+            progress->finish(done());
+
+        for(std::size_t part=0; part < partitions; ++part)
+        {
+            spill.files[part].close();
+
+            if (not spill.files[part])
+                throw std::runtime_error("cannot write \"" + spill.names[part] + "\": " + std::strerror(errno));
+        }
+
+        //The fanout table comes from the per-thread bucket counts, so it is known before any partition is sorted
+        std::vector<std::uint64_t> fanout(buckets + 1, 0);
+
+        for(const std::vector<std::uint64_t>& bucket_counts : counts)
+            for(std::size_t bucket=0; bucket < buckets; ++bucket)
+                fanout[bucket + 1] += bucket_counts[bucket];
+
+        for(std::size_t bucket=1; bucket <= buckets; ++bucket)
+            fanout[bucket] += fanout[bucket - 1];
+
+        const std::uint64_t count = fanout[buckets];
+
+        //Header, fanout table, records
+        out.write(magic, sizeof(magic));
+        detail::store(out, wordlist_print.size, 8);
+        detail::store(out, wordlist_print.mtime, 8);
+        detail::store(out, wordlist_print.checksum, 8);
+        detail::store(out, count, 8);
+        detail::store(out, wordlist.size(), 4);
+        out.write(wordlist.data(), static_cast<std::streamsize>(wordlist.size()));
+        detail::store(out, rule_set.size(), 4);
+
+        std::uint64_t header = sizeof(magic) + 3 * 8 + 8 + 4 + wordlist.size() + 4;
+
+        for(const rules::Rule& rule : rule_set)
+        {
+            detail::store(out, rule.str().size(), 4);
+            out.write(rule.str().data(), static_cast<std::streamsize>(rule.str().size()));
+            header += 4 + rule.str().size();
+        }
+
+        for(; header % 8 != 0; ++header)
+            out.put('\0');
+
+        for(std::uint64_t first : fanout)
+            detail::store(out, first, 8);
+
+        //One partition at a time: read it back, LSD radix sort it on the sort key, 16 bits per pass (its top 8 bits are all the same)
+        std::vector<Record> sorted, scratch;
+
+        for(std::size_t part=0; part < partitions; ++part)
+        {
+            const std::uint64_t size = fanout[(part + 1) << 8] - fanout[part << 8];
+            std::ifstream in(spill.names[part], std::ios::binary);
+
+            sorted.resize(size);
+            in.read(reinterpret_cast<char*>(sorted.data()), static_cast<std::streamsize>(size * sizeof(Record)));
+
+            if (static_cast<std::uint64_t>(in.gcount()) != size * sizeof(Record))
+                throw std::runtime_error("cannot read \"" + spill.names[part] + "\" back");
+
+            in.close();
+            std::remove(spill.names[part].c_str());
+            scratch.resize(size);
+
+            for(unsigned shift=0; shift < 64; shift += 16)
+            {
+                std::vector<std::uint64_t> starts(buckets + 1, 0);
+
+                for(const Record& record : sorted)
+                    ++starts[((record.key >> shift) & 0xffff) + 1];
+
+                for(std::size_t digit=1; digit <= buckets; ++digit)
+                    starts[digit] += starts[digit - 1];
+
+                for(const Record& record : sorted)
+                    scratch[starts[(record.key >> shift) & 0xffff]++] = record;
+
+                sorted.swap(scratch);
+            }
+
+            for(const Record& record : sorted)
+            {
+                for(int byte=5; byte >= 0; --byte)
+                    out.put(static_cast<char>((record.key >> (8 * byte)) & 0xff));
+
+                detail::store(out, record.source & max_offset, 5);
+                detail::store(out, record.source >> 40, 3);
+            }
+        }
+
+        out.close();
+
+        if (not out or std::rename(temporary.c_str(), filename.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("cannot write \"" + filename + "\": " + std::strerror(errno));
+        }
+
+        return count;
+    }
+}
@@ -6,14 +6,16 @@
     C++ Version: C++17
 
     Compilation Instructions: 
-        > Windows: g++ -std=c++17 *.cpp .\hashlib++_md5\*.cpp
-        > Linux:   g++ -std=c++17 *.cpp ./hashlib++_md5/*.cpp
+        > Linux:   g++ -std=c++17 -O2 -pthread *.cpp ./hashlib++_md5/*.cpp
+        (the potfile uses mmap/flock, so a POSIX system is required)
 
     Description: this program is a password cracker for md5 hashes. Is it realistic? No, but it's still a good exercise.
 */
  
 //Native C libraries
-#include <cstdlib>      //contains exit()
+#include <cstdlib>      //contains exit(), realpath()
+#include <cstdint>     //Fixed width dictionary offsets and keyspace indices
+#include <unistd.h>   //sysconf() (the memory a '--dedup' filter may take)
 
 //Native C++ Libraries
 #include <iostream>              //For input and output operations
@@ -24,6 +26,10 @@
 #include <memory>           //For smart pointers
 #include <algorithm>       //The cardinal sin in an algorithms class 
 #include <vector>         //I know this is slow but im only using it for writing hashes to a file
+#include <thread>        //std::thread::hardware_concurrency (for '--benchmark')
+#include <regex>        //Telling options from parameters in '--client'/'--daemon' jobs
+#include <iterator>    //Reading a whole hashfile for '--client'
+#include <limits>     //The largest '--threads'
 
 //External Libraries (dependencies)
 // #include "hashlib++/hashlibpp.h"  //Contains implmentations of MD5 and SHA-family hashing algorithms
@@ -32,50 +38,199 @@
 //Custom Libraries (by yours truly :D)
 #include "arg-parser/parser.hpp"          //By Ethan
 #include "permuter/permute.hpp"          //By Michael
+#include "permuter/mask.hpp"            //Mask attacks (per-position charsets, length ranges)
+#include "checkpoint/checkpoint.hpp"    //Session files for '--restore'
+#include "cracker/digest.hpp"          //Binary MD5 digests
+#include "potfile/potfile.hpp"        //Every password ever cracked on this host
+#include "cracker/slice.hpp"         //'--skip'/'--limit'/'--node' slices
+#include "rules/rules.hpp"          //Word-mangling rules ('--rules')
+#include "pcfg/pcfg.hpp"           //Probabilistic grammar guesses ('--pcfg')
+#include "rainbow/rainbow.hpp"    //Precomputed chains ('--rainbow-build', '--rainbow')
+#include "hashindex/hashindex.hpp" //Sorted digests of a wordlist ('--build-index', '--index')
+#include "cracker/session.hpp"       //The cracker itself (targets, attacks, worker threads) as a library
+#include "remote/server.hpp"        //'--daemon'
+#include "remote/client.hpp"       //'--client'
+#include "cracker/benchmark.hpp"     //Synthetic speed measurements ('--benchmark')
+#include "cracker/selftest.hpp"    //Kernel conformance checks ('--selftest')
 
 //Typedefs
-typedef std::unordered_map<std::string, std::optional<std::string>> passwd_hashmap; 
+using cracker::passwd_hashmap;   //Hash -> optional<cracked password> (the session's result table)
 
 
 //Function prototypes
+arg_parser::Parser make_parser();                                     //The parser with every commandline argument
 void process_args(int argc, arg_parser::Parser&);                     //Ensure that there was a file to read from
-void load_hashes(passwd_hashmap& hashes, std::string filename);      //Load the hashes from the file
-void crack_hashes(passwd_hashmap& hashes, std::string filename);    //(Attempt to) crack all the hashes
+cracker::Job build_job(const arg_parser::Parser& parser, const potfile::Potfile* pot);                //The attack described by the commandline options
+cracker::Job remote_job(const std::vector<std::string>& args, const potfile::Potfile* pot);          //The attack of a '--client' request
+void run_daemon(const arg_parser::Parser& parser);                  //Serve the jobs of '--client' processes until shut down
+void run_client(const arg_parser::Parser& parser, int argc, char* argv[]);   //Send a job/request to the daemon and print the replies
+void fatal(const cracker::SessionError& error);                        //Print a session error and exit with its status code
 void print_hashes(const passwd_hashmap& hashes);                   //Print all the hashes + cracked passwords as a table
-void crack_brute_hash(passwd_hashmap& hashes, const size_t& size = 5);   //(Attempt to) crack all the hashes with passwords of a given size 
-                                                                 //(probably dont want to run larger than 5 or youll have time to discover the cure to cancer)                                     
+void run_benchmark(const arg_parser::Parser& parser);               //Measure every kernel/length/target count/thread count and print JSON
+void run_selftest();                                                //Check every kernel against RFC 1321 and hl_md5.cpp (exits on a mismatch)
+void run_rainbow_build(const arg_parser::Parser& parser);           //Generate a rainbow table of the mask keyspace on every core
+void run_build_index(const arg_parser::Parser& parser);             //Hash a wordlist (+ rules) once into a sorted digest index
 void gen_hash_to_file(std::string& file_name, std::initializer_list<std::string> plaintext);         //Hashes plaintext and puts in a file
+Permute::Mask build_mask(const arg_parser::Parser& parser, const potfile::Potfile* pot);              //Keyspace of '--brute'/'--mask' (+ lengths + custom charsets + Markov order)
+cracker::Slice build_slice(const arg_parser::Parser& parser);                                        //'--skip'/'--limit'/'--node'
+std::size_t build_dedup(const arg_parser::Parser& parser);                                           //'--dedup' (MiB, at most the physical memory)
+unsigned build_threads(const arg_parser::Parser& parser, unsigned fallback);                         //'--threads' (or 'fallback' without it)
+void set_numa(const arg_parser::Parser& parser, cracker::SessionOptions& options);                   //'--numa', '--numa replicate'
+rules::RuleSet build_rules(const arg_parser::Parser& parser, const std::string& option);             //'--rules', '--rules-left', '--rules-right'
+pcfg::Grammar build_grammar(const arg_parser::Parser& parser, const potfile::Potfile* pot);         //'--pcfg', '--pcfg-pot'
+bool hybrid_append(const arg_parser::Parser& parser);                                                //'--hybrid': word+mask (true) or mask+word (false)
+void merge_results(passwd_hashmap& hashes, const arg_parser::Argument& files);                      //Combine the outputs/potfiles of several slices
 
 // DRIVER CODE //
 int main(int argc, char* argv[])
 {
     //Commandline argument parser + argument list
-    arg_parser::Parser parser(
-                                //Format:  cmd arg=string, # of parameters=uint, is_required=bool, description=string
-                                arg_parser::Argument("--help", 0, false, "displays the help screen"),            
-                                arg_parser::Argument("-h", 0, false, "displays the help screen"),                 
-                                arg_parser::Argument("--hashfile", 1, true, "takes the list of hashed passwords"),   
-                                arg_parser::Argument("--dict", 1, false, "source dictionary of passwords"),
-				arg_parser::Argument("--brute", 1, false, "runs the brute force algorithm which does not require a dictionary. 1 arg: size of password")
-                             );
+    arg_parser::Parser parser = make_parser();
 
     //Parse the commandline arguments
     parser.parse(argc, argv);
+
+    //Benchmark mode: synthetic candidates and targets, so it runs before the hashfile is required
+    if (parser["--benchmark"].is_set())
+    {
+        run_benchmark(parser);
+        return 0;
+    }
+
+    //Self-test mode: no hashfile either
+    if (parser["--selftest"].is_set())
+    {
+        run_selftest();
+        return 0;
+    }
+
+    //Rainbow table generation: the keyspace comes from the mask options, so no hashfile either
+    if (parser["--rainbow-build"].is_set())
+    {
+        run_rainbow_build(parser);
+        return 0;
+    }
+
+    //Digest index generation: only the wordlist and its rules, so no hashfile either
+    if (parser["--build-index"].is_set())
+    {
+        run_build_index(parser);
+        return 0;
+    }
+
+    //Daemon mode: the hashfiles come from the clients
+    if (parser["--daemon"].is_set())
+    {
+        run_daemon(parser);
+        return 0;
+    }
+
+    //Client mode: the job (or a status/shutdown request) goes to a running daemon
+    if (parser["--client"].is_set())
+    {
+        run_client(parser, argc, argv);
+        return 0;
+    }
+
     process_args(argc, parser);                                    //Validate the commandline arguments (check that a file WAS provided)
 
     //Variables
-    passwd_hashmap hashes;  //map of all the hashes to crack (password hash -> optional<cracked password value>)
-    std::string dictionary = (parser["--dict"].is_set() ? parser["--dict"][0].data() : "top-10-million-passwords.txt");
-    size_t size = (parser["--brute"].is_set() ? std::stoi(parser["--brute"][0].data()) : (size_t)5);
+    std::string session_file = (parser["--session"].is_set() ? parser["--session"][0].data() : "cracker.session");
+    std::string hashfile = parser["--hashfile"][0].data();
+    std::string potfile_name = (parser["--potfile"].is_set() ? parser["--potfile"][0].data() : "cracker.pot");
 
-    load_hashes(hashes, parser["--hashfile"][0].data());          //Load in all the hashes from the file
+    //Checkpoints are only valid for the exact same job, so the session records a hash of the options
+    std::string attack_options;
 
-	if(parser["--brute"].is_set())
-		crack_brute_hash(hashes, size);
-	else
-    	crack_hashes(hashes, dictionary);                       //Attempt to crack all the hashes
+    for(const char* option : {"--dict", "--rules", "--loopback", "--hybrid", "--combinator", "--rules-left", "--rules-right", "--brute", "--mask", "--custom-charset", "--min-len", "--max-len", "--markov", "--markov-pot", "--pcfg", "--pcfg-pot", "--rainbow", "--index", "--skip", "--limit", "--node"})
+    {
+        for(std::size_t i=0; parser[option].is_set() and i < parser[option].param_count(); ++i)
+            attack_options += std::string(option) + '=' + std::string(parser[option][i]) + ' ';
+    }
 
-    print_hashes(hashes);                                       //Print all the hashes and their cracked equivalents as a table
+    //Merge mode: no cracking, just combine the results of the slices
+    if (parser["--merge"].is_set())
+    {
+        cracker::Session reader;   //No potfile: only the slices' results count
+        passwd_hashmap hashes;
+
+        try { reader.load(hashfile); } catch (const cracker::SessionError& error) { fatal(error); }
+
+        hashes = reader.results();
+        merge_results(hashes, parser["--merge"]);
+        print_hashes(hashes);
+        return 0;
+    }
+
+    //The session opens the potfile before loading the hashes, so already-known targets never reach the cracking loops
+    cracker::SessionOptions options;
+    set_numa(parser, options);
+    options.potfile = (parser["--no-potfile"].is_set() ? "" : potfile_name);
+    options.stats_file = (parser["--stats-file"].is_set() ? parser["--stats-file"][0].data() : "");
+    options.progress_line = true;
+
+    std::unique_ptr<cracker::Session> session;
+
+    try
+    {
+        options.threads = build_threads(parser, 0);
+        session = std::make_unique<cracker::Session>(options);
+        session->load(hashfile);                                //Load in all the hashes from the file
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+
+    //The job (the mask/grammar may be trained from the potfile, so it comes after the potfile was opened)
+    cracker::Job job;
+
+    try
+    {
+        job = build_job(parser, session->potfile());
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+
+    job.checkpoint_file = session_file;
+    job.options_hash = checkpoint::hash_options({cracker::Session::mode_name(job.mode), hashfile, attack_options});
+    job.restore = parser["--restore"].is_set();
+
+    checkpoint::install_signal_handlers();                   //SIGINT/SIGTERM flush a final checkpoint instead of losing the run
+
+    bool finished = true;
+
+    try
+    {
+        finished = session->run(job);                        //Attempt to crack all the hashes
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+
+    const cracker::Report& report = session->last_report();
+
+    if (job.association)
+        std::clog << "Association: cracked " << report.association_cracked << " of " << report.association_accounts << " accounts with "
+                  << report.association_candidates << " username-based candidates\n";
+
+    if (report.pcfg_dropped != 0)
+        std::clog << "PCFG: " << report.pcfg_dropped << " unlikely guesses were dropped to keep the priority queue bounded\n";
+
+    print_hashes(session->results());                           //Print all the hashes and their cracked equivalents as a table
+
+    if (job.loopback)
+        std::clog << "Loopback: " << report.loopback << " cracked passwords were fed back through the rules\n";
+
+    if (job.dedup != 0)
+        std::clog << "Dedup: " << report.duplicates << " of " << report.candidates << " candidates (" << std::fixed << std::setprecision(2)
+                  << (report.candidates != 0 ? 100.0 * report.duplicates / report.candidates : 0.0) << "%) were duplicates and not hashed\n";
+
+    if (not finished)
+        std::clog << "Interrupted: progress saved to " << std::quoted(session_file) << ", rerun with --restore to continue\n";
 
     return 0;
 }
@@ -87,7 +242,61 @@ int main(int argc, char* argv[])
  // *********** FUNTION IMPLEMENTATIONS **********  //
 // =============================================== //
 
-//Validates the commandline arguments (so 'load_hashes' doesn't have it)
+//Build the parser with every commandline argument (the daemon also parses the options of its clients' jobs with it)
+arg_parser::Parser make_parser()
+{
+    return arg_parser::Parser(
+                                //Format:  cmd arg=string, # of parameters=uint, is_required=bool, description=string
+                                arg_parser::Argument("--help", 0, false, "displays the help screen"),            
+                                arg_parser::Argument("-h", 0, false, "displays the help screen"),                 
+                                arg_parser::Argument("--hashfile", 1, true, "takes the list of hashed passwords (one hash, user:hash or email:hash per line)"),   
+                                arg_parser::Argument("--association", 0, false, "first tries passwords derived from the username of each user:hash line (variants, years, '--rules') against that hash only"),
+                                arg_parser::Argument("--dict", 1, false, "source dictionary of passwords"),
+                                arg_parser::Argument("--rules", 1, false, "applies every rule of a rule file (hashcat syntax, e.g. c, $1, sa@, T0) to every dictionary word"),
+                                arg_parser::Argument("--loopback", 0, false, "feeds every password cracked by a dictionary attack back through '--rules' right away"),
+                                arg_parser::Argument("--dedup", 1, false, "skips candidates generated before (rules, loopback, hybrid/combinator words) with a Bloom filter of the given size in MiB"),
+                                arg_parser::Argument("--hybrid", 1, false, "word+mask or mask+word: every '--dict' word with every '--mask' candidate appended or prepended"),
+                                arg_parser::Argument("--combinator", 2, false, "tries every left word followed by every right word. args: left dictionary, right dictionary"),
+                                arg_parser::Argument("--rules-left", 1, false, "rule file applied to the left words of '--combinator'"),
+                                arg_parser::Argument("--rules-right", 1, false, "rule file applied to the right words of '--combinator'"),
+				arg_parser::Argument("--brute", 1, false, "runs the brute force algorithm which does not require a dictionary. 1 arg: size of password"),
+                                arg_parser::Argument("--mask", 1, false, "runs a mask attack, e.g. ?u?l?l?l?d?d (?l ?u ?d ?s ?a built-in, ?1-?4 custom, ?? is '?')"),
+                                arg_parser::Argument("--custom-charset", 1, false, "defines the custom charsets ?1 ?2 ?3 ?4 of a mask (e.g. ?l?d _-)"),
+                                arg_parser::Argument("--min-len", 1, false, "shortest candidate of a mask/brute force attack: every prefix length from min-len to max-len is tried"),
+                                arg_parser::Argument("--max-len", 1, false, "longest candidate of a mask/brute force attack (default: the full mask)"),
+                                arg_parser::Argument("--markov", 1, false, "tries brute force/mask candidates in order of likelihood, trained from the given wordlist"),
+                                arg_parser::Argument("--markov-pot", 0, false, "also trains the '--markov' order from the passwords in the potfile (can be used on its own)"),
+                                arg_parser::Argument("--pcfg", 1, false, "tries the guesses of a probabilistic grammar (structures like L6D2, words, digits, capitalization) trained from the given wordlist, most likely first"),
+                                arg_parser::Argument("--pcfg-pot", 0, false, "also trains the '--pcfg' grammar from the passwords in the potfile (can be used on its own)"),
+                                arg_parser::Argument("--rainbow", 1, false, "cracks the hashes by walking the chains of precomputed rainbow tables (see '--rainbow-build'). args: table files"),
+                                arg_parser::Argument("--rainbow-build", 1, false, "builds a rainbow table of the '--brute'/'--mask' keyspace (and '--min-len'/'--max-len') into the given file on every core; no hashfile needed"),
+                                arg_parser::Argument("--chain-length", 1, false, "links per chain of '--rainbow-build' (default: 1000): longer chains make smaller tables and slower lookups"),
+                                arg_parser::Argument("--chains", 1, false, "number of chains of '--rainbow-build' (default: enough to cover the keyspace twice, before merges)"),
+                                arg_parser::Argument("--table-number", 1, false, "selects the reduction functions of '--rainbow-build' (default: 0); tables with different numbers complement each other"),
+                                arg_parser::Argument("--index", 1, false, "cracks the hashes by looking them up in a digest index (see '--build-index'); its wordlist must not have changed since"),
+                                arg_parser::Argument("--build-index", 1, false, "hashes the '--dict' wordlist (with '--rules') once into a sorted digest index in the given file; no hashfile needed"),
+                                arg_parser::Argument("--session", 1, false, "name of the session file that checkpoints are written to (default: cracker.session)"),
+                                arg_parser::Argument("--restore", 0, false, "continue the attack recorded in the session file instead of starting over"),
+                                arg_parser::Argument("--potfile", 1, false, "file of previously cracked passwords, consulted before hashing (default: cracker.pot)"),
+                                arg_parser::Argument("--no-potfile", 0, false, "neither read nor write the potfile"),
+                                arg_parser::Argument("--threads", 1, false, "number of worker threads (default: one per core)"),
+                                arg_parser::Argument("--numa", 0, false, "pins the worker threads to CPUs spread over the NUMA nodes; '--numa replicate' also gives every node its own copy of the targets"),
+                                arg_parser::Argument("--skip", 1, false, "skip the first N candidates (brute force/mask) or lines (dictionary)"),
+                                arg_parser::Argument("--limit", 1, false, "test at most N candidates/lines (after '--skip')"),
+                                arg_parser::Argument("--node", 1, false, "i/N: only test the i-th of N equal parts of the (skipped/limited) keyspace or dictionary"),
+                                arg_parser::Argument("--stats-file", 1, false, "writes per-stage counters and timings (read, generate, hash, prefilter, probe, write) and batch latencies as JSON, every few seconds and at exit"),
+                                arg_parser::Argument("--benchmark", 0, false, "measures the hashes/s of every kernel, candidate length, target count and thread count (up to '--threads') on synthetic data and prints JSON; no hashfile needed"),
+                                arg_parser::Argument("--selftest", 0, false, "checks every MD5 kernel against the RFC 1321 vectors and differentially against hashlib++ on random candidates; exits with status code 1 on any mismatch"),
+                                arg_parser::Argument("--merge", 1, false, "combine the outputs and potfiles of several slices into one report for the hashfile. args: files"),
+                                arg_parser::Argument("--daemon", 0, false, "serves jobs from '--client' processes on '--socket', keeping the potfile, the worker threads and the dictionaries warm between jobs; no hashfile needed"),
+                                arg_parser::Argument("--client", 0, false, "sends the job on the commandline (hashfile + attack options) to the daemon on '--socket' and prints every crack as it arrives"),
+                                arg_parser::Argument("--socket", 1, false, "Unix domain socket of '--daemon' and '--client' (default: cracker.sock)"),
+                                arg_parser::Argument("--status", 0, false, "with '--client': prints the queue and the progress of the daemon instead of submitting a job"),
+                                arg_parser::Argument("--shutdown", 0, false, "with '--client': stops the daemon (a running job is stopped, queued jobs are dropped)")
+                             );
+}
+
+//Validates the commandline arguments (so the session doesn't have to)
 inline void process_args(int argc, arg_parser::Parser& parser)
 {
     //If no commandline arguments were provided OR the user asked for help
@@ -129,106 +338,641 @@ inline void process_args(int argc, arg_parser::Parser& parser)
     }
 }
 
+//Print a session error (unreadable file, bad session file, missing mask...) and exit with the status code it carries
+void fatal(const cracker::SessionError& error)
+{
+    std::clog << "***FATAL ERROR***: " << error.what() << ". Exiting with status code " << error.status() << "...\n";
+    exit(error.status());
+}
+
+                                      
+void gen_hash_to_file(std::string& file_name, std::initializer_list<std::string> plaintext) { //Hashes plaintext and outputs to file
+
+	auto md5hasher = std::make_unique<md5wrapper>();
+	std::ofstream out_file(file_name);
+
+	if(out_file.good()) {
+		for(auto i : plaintext) {
+			out_file << md5hasher->getHashFromString(i) << "\n";
+		}
+	}
+	else
+		std::cout << "hashes not written. file is not good" << std::endl;
+	
+	out_file.close();
+}
+
+
+//Build the attack described by the commandline options: mode, wordlists, rules, mask or grammar, slice and filters
+//(CAN THROW cracker::SessionError; the session file options are left to the caller)
+cracker::Job build_job(const arg_parser::Parser& parser, const potfile::Potfile* pot)
+{
+    bool rainbow_tables = parser["--rainbow"].is_set();
+    bool indexed = (not rainbow_tables and parser["--index"].is_set());
+    bool precomputed = (rainbow_tables or indexed);
+    bool hybrid = (not precomputed and parser["--hybrid"].is_set());
+    bool brute_force = (not precomputed and not hybrid and (parser["--brute"].is_set() or parser["--mask"].is_set()));
+    bool pcfg_guesses = (not precomputed and not hybrid and not brute_force and (parser["--pcfg"].is_set() or parser["--pcfg-pot"].is_set()));
+    bool combinator = (not precomputed and parser["--combinator"].is_set());
+    cracker::Job job;
+
+    job.mode = (rainbow_tables ? cracker::Job::Mode::rainbow : (indexed ? cracker::Job::Mode::index : (hybrid ? cracker::Job::Mode::hybrid
+                       : (brute_force ? cracker::Job::Mode::brute : (pcfg_guesses ? cracker::Job::Mode::pcfg
+                       : (combinator ? cracker::Job::Mode::combinator : cracker::Job::Mode::dict))))));
+
+    job.dictionary = (parser["--dict"].is_set() ? parser["--dict"][0].data() : "top-10-million-passwords.txt");
+    job.rules = build_rules(parser, "--rules");
+    job.slice = build_slice(parser);
+    job.association = parser["--association"].is_set();
+    job.loopback = parser["--loopback"].is_set();
+    job.dedup = build_dedup(parser);
+
+    if (hybrid and not parser["--mask"].is_set())
+        throw cracker::SessionError("'--hybrid' needs '--mask'", 1);
+
+    if (hybrid or brute_force)
+        job.mask.emplace(build_mask(parser, pot));
+
+    for(std::size_t i=0; rainbow_tables and i < parser["--rainbow"].param_count(); ++i)
+        job.tables.push_back(parser["--rainbow"][i].data());
+
+    if (indexed)
+        job.index = parser["--index"][0].data();
+
+    if (hybrid)
+        job.append = hybrid_append(parser);
+    else if (pcfg_guesses)
+        job.grammar.emplace(build_grammar(parser, pot));
+    else if (combinator)
+    {
+        job.dictionary = parser["--combinator"][0].data();
+        job.right_dictionary = parser["--combinator"][1].data();
+        job.left_rules = build_rules(parser, "--rules-left");
+        job.right_rules = build_rules(parser, "--rules-right");
+    }
+
+    return job;
+}
+
 
-//Load the hashes from the given file
-void load_hashes(passwd_hashmap& hashes, std::string filename)
+//Build the keyspace of a brute force ('--brute N': N alphanumeric positions) or mask ('--mask') attack (CAN THROW cracker::SessionError)
+Permute::Mask build_mask(const arg_parser::Parser& parser, const potfile::Potfile* pot)
 {
-    //Infile to read in hashed passwords from + temp str to store individual passwords
-    std::ifstream password_hashlist(filename);
-    std::string password;
+    try
+    {
+        std::vector<std::string> custom;
+        std::vector<std::string> positions;
+
+        for(std::size_t i=0; parser["--custom-charset"].is_set() and i < parser["--custom-charset"].param_count(); ++i)
+            custom.push_back(Permute::expand_charset(parser["--custom-charset"][i]));
+
+        if (parser["--mask"].is_set())
+            positions = Permute::parse_mask(parser["--mask"][0], custom);
+        else
+            positions.assign(std::stoul(parser["--brute"][0].data()), Permute::alphanum);
+
+        std::size_t max_len = (parser["--max-len"].is_set() ? std::stoul(parser["--max-len"][0].data()) : positions.size());
+        std::size_t min_len = (parser["--min-len"].is_set() ? std::stoul(parser["--min-len"][0].data()) : max_len);
+
+        //Markov order: the same candidates, most likely first
+        std::unique_ptr<Permute::Markov> markov;
+
+        if (parser["--markov"].is_set() or parser["--markov-pot"].is_set())
+        {
+            markov = std::make_unique<Permute::Markov>();
 
-    //Error-handling
-    if (not password_hashlist.good())
+            if (parser["--markov"].is_set())
+                markov->train_file(parser["--markov"][0].data());
+
+            if (parser["--markov-pot"].is_set() and pot != nullptr)
+                pot->for_each([&markov](const cracker::digest&, std::string_view plaintext) { markov->train(plaintext); });
+
+            std::clog << "Markov order trained on " << markov->size() << " passwords\n";
+        }
+
+        return Permute::Mask(positions, min_len, max_len, markov.get());
+    }
+    catch (const std::exception& error)    //std::invalid_argument, std::out_of_range (std::stoul), std::overflow_error and std::runtime_error (training file)
     {
-        std::clog << "***FATAL ERROR***: the file " << std::quoted(filename) << " could not be found. Exiting with status code 2...\n";
-        exit(2);
+        throw cracker::SessionError(std::string("invalid mask: ") + error.what(), 1);
     }
-    
-    //Until you reach the end of the file
-    while (std::getline(password_hashlist, password))   //implicit std::noskipws
+}
+
+//Build the slice of the keyspace/dictionary from '--skip', '--limit' and '--node' (CAN THROW cracker::SessionError)
+cracker::Slice build_slice(const arg_parser::Parser& parser)
+{
+    cracker::Slice slice;
+
+    try
     {
-        //Move the hashed password into the map, along with an empty std::optional<> object
-        hashes.insert({std::move(password), std::nullopt});
+        if (parser["--skip"].is_set())
+            slice.skip = std::stoull(parser["--skip"][0].data());
+
+        if (parser["--limit"].is_set())
+            slice.limit = std::stoull(parser["--limit"][0].data());
+
+        if (parser["--node"].is_set())
+            cracker::parse_node(parser["--node"][0], slice);
     }
-	
-    password_hashlist.close();
+    catch (const std::exception& error)    //std::invalid_argument, std::out_of_range (std::stoull)
+    {
+        throw cracker::SessionError(std::string("invalid slice: ") + error.what(), 1);
+    }
+
+    return slice;
 }
 
+//Return the size of the '--dedup' filter in MiB (0: no filter), refusing more than the physical memory (CAN THROW cracker::SessionError)
+std::size_t build_dedup(const arg_parser::Parser& parser)
+{
+    if (not parser["--dedup"].is_set())
+        return 0;
 
-//(Attemp to) crack all the passwords
-void crack_hashes(passwd_hashmap& hashes, std::string filename)
-{   
-    //Variables
-    auto md5hasher = std::make_unique<md5wrapper>();       //MD5 Hash Generator
-    std::ifstream dictionary(filename);                   //File containing the password for the dictionary attack
-    std::string password;                                //Temp string to store a given password from the dictionary
-    unsigned long long counter = 0;                     //Counter -- how many passwords it's gone through
+    std::size_t megabytes = 0;
 
-    //Validate dictionary file
-    if (not dictionary.good())
+    try
     {
-        std::clog << "***FATAL ERROR***: the file " << std::quoted(filename) << " could not be found. Exiting with status code 2...\n";
-        exit(2);
+        megabytes = std::stoull(parser["--dedup"][0].data());
+    }
+    catch (const std::exception& error)    //std::invalid_argument, std::out_of_range (std::stoull)
+    {
+        throw cracker::SessionError(std::string("invalid duplicate filter: ") + error.what(), 1);
     }
 
-    //Try every password in the password list
-    while (std::getline(dictionary, password))
+    long pages = ::sysconf(_SC_PHYS_PAGES), page_size = ::sysconf(_SC_PAGESIZE);
+    std::size_t physical = (pages > 0 and page_size > 0 ? static_cast<std::size_t>(pages) / ((1 << 20) / static_cast<std::size_t>(page_size)) : 0);
+
+    if (physical != 0 and megabytes > physical)
+        throw cracker::SessionError("the duplicate filter of " + std::to_string(megabytes) + " MiB is larger than the " + std::to_string(physical)
+                                    + " MiB of memory", 1);
+
+    return megabytes;
+}
+
+//Return the number of worker threads of '--threads', or 'fallback' without it (CAN THROW cracker::SessionError)
+unsigned build_threads(const arg_parser::Parser& parser, unsigned fallback)
+{
+    if (not parser["--threads"].is_set())
+        return fallback;
+
+    unsigned long threads = 0;
+
+    try
+    {
+        threads = std::stoul(parser["--threads"][0].data());
+    }
+    catch (const std::exception& error)    //std::invalid_argument, std::out_of_range (std::stoul)
     {
-        std::cout << "Progress: " << ++counter << '\r';  // '\r' overwrites the current line, acting as a progress bar
+        throw cracker::SessionError(std::string("invalid thread count: ") + error.what(), 1);
+    }
+
+    if (threads > std::numeric_limits<unsigned>::max())
+        throw cracker::SessionError("invalid thread count: " + std::to_string(threads), 1);
+
+    return static_cast<unsigned>(threads);
+}
+
+//Set the thread placement of '--numa' (and the per-node targets of '--numa replicate') -- exits on any other parameter
+void set_numa(const arg_parser::Parser& parser, cracker::SessionOptions& options)
+{
+    options.numa = parser["--numa"].is_set();
 
-        std::string password_hash = std::move(md5hasher->getHashFromString(password));
+    if (not options.numa or parser["--numa"].param_count() == 0)
+        return;
 
-        if (hashes.find(password_hash) != hashes.end())
-            hashes[password_hash] = password;
+    if (parser["--numa"][0] != "replicate")
+        fatal(cracker::SessionError("'--numa' takes no parameter or 'replicate'", 1));
+
+    options.numa_replicas = true;
+}
+
+//Load the rule file of '--rules', '--rules-left' or '--rules-right' (no rules: every word is used as written) (CAN THROW cracker::SessionError)
+rules::RuleSet build_rules(const arg_parser::Parser& parser, const std::string& option)
+{
+    rules::RuleSet rule_set;
+
+    try
+    {
+        if (parser[option].is_set())
+            rule_set.load(parser[option][0].data());
+    }
+    catch (const std::runtime_error& error)
+    {
+        throw cracker::SessionError(std::string("invalid rules: ") + error.what(), 1);
     }
-    std::cout << '\n';
 
-   dictionary.close();
+    return rule_set;
 }
 
-void crack_brute_hash(passwd_hashmap& hashes, const size_t& size )
-{   
-    //Variables
-    auto md5hasher = std::make_unique<md5wrapper>();       //MD5 Hash Generator
-    std::string password;                                 //Temp string to store a given password from the dictionary
-    unsigned long long counter = 0;                      //Counter -- how many passwords it's gone through
-	const std::string endOfPermuter(size, '0');         //Stores the string that corresponds to the end of the permuter. this feels hacky but it works for now
+//Train the grammar of '--pcfg' from a wordlist and/or ('--pcfg-pot') the potfile (CAN THROW cracker::SessionError, e.g. with nothing to learn from)
+pcfg::Grammar build_grammar(const arg_parser::Parser& parser, const potfile::Potfile* pot)
+{
+    pcfg::Grammar grammar;
 
-    //Run through all combinations of N size strings and checking if they match the hash in hashes hashmap
-    for(password = Permute::gen_brute_str(size); password != endOfPermuter; password = Permute::gen_brute_str(size))
+    try
+    {
+        if (parser["--pcfg"].is_set())
+            grammar.train_file(parser["--pcfg"][0].data());
+    }
+    catch (const std::runtime_error& error)
     {
-        std::cout << "Progress: " << ++counter << '\r';  // '\r' overwrites the current line, acting as a progress bar
+        throw cracker::SessionError(error.what(), 2);
+    }
+
+    if (parser["--pcfg-pot"].is_set() and pot != nullptr)
+        pot->for_each([&grammar](const cracker::digest&, std::string_view plaintext) { grammar.train(plaintext); });
 
-        std::string password_hash = std::move(md5hasher->getHashFromString(password));
+    if (grammar.size() == 0)
+        throw cracker::SessionError("the PCFG has no training passwords", 1);
+
+    grammar.finish();
+    std::clog << "PCFG trained on " << grammar.size() << " passwords (" << grammar.base_structures().size() << " base structures)\n";
+
+    return grammar;
+}
+
+//Return whether '--hybrid' appends the mask to the words (word+mask) or prepends it (mask+word) (CAN THROW cracker::SessionError)
+bool hybrid_append(const arg_parser::Parser& parser)
+{
+    if (parser["--hybrid"][0] == "word+mask")
+        return true;
+    if (parser["--hybrid"][0] == "mask+word")
+        return false;
 
-        if (hashes.find(password_hash) != hashes.end())
-            hashes[password_hash] = password;
+    throw cracker::SessionError("'--hybrid' must be word+mask or mask+word", 1);
+}
+
+//Combine the results of several slices: every file is either a potfile or the saved output of a run (the print_hashes table)
+void merge_results(passwd_hashmap& hashes, const arg_parser::Argument& files)
+{
+    for(std::size_t i=0; i < files.param_count(); ++i)
+    {
+        std::string filename(files[i]);
+        std::ifstream in(filename, std::ios::binary);
+        char header[sizeof(potfile::magic)] = {};
+
+        if (not in.good())
+        {
+            std::clog << "***FATAL ERROR***: the file " << std::quoted(filename) << " could not be found. Exiting with status code 2...\n";
+            exit(2);
+        }
+
+        //Potfile: resolve every hash it knows
+        if (in.read(header, sizeof(header)) and std::equal(header, header + sizeof(header), potfile::magic))
+        {
+            in.close();
+            potfile::Potfile pot(filename);
+
+            for(auto& map_entry : hashes)
+            {
+                std::optional<cracker::digest> digest = cracker::parse_digest(map_entry.first);
+
+                if (not map_entry.second and digest)
+                {
+                    if (auto plaintext = pot.find(*digest))
+                        map_entry.second = std::string(*plaintext);
+                }
+            }
+
+            continue;
+        }
+
+        //Output table: "<hash> <password>" rows (the progress line, header and uncracked rows are skipped)
+        in.clear();
+        in.seekg(0);
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::size_t space = line.find(' ');
+
+            if (space == std::string::npos or space + 1 == line.size())
+                continue;
+
+            auto itr = hashes.find(line.substr(0, space));
+            if (itr != hashes.end() and not itr->second)
+                itr->second = line.substr(space + 1);
+        }
     }
-	// this code is duplicated because once the permuter reaches the end it loops back to "0"*size so this duplicate is needed to check if that is the password
-	std::cout << "Progress: " << ++counter << '\r';  // '\r' overwrites the current line, acting as a progress bar
+}
 
-	std::string password_hash = std::move(md5hasher->getHashFromString(password));
 
-	if (hashes.find(password_hash) != hashes.end())
-		hashes[password_hash] = password;
+//Run the '--benchmark' measurements and print them as JSON on stdout (so the results of several hosts/builds can be compared)
+void run_benchmark(const arg_parser::Parser& parser)
+{
+    constexpr double seconds_per_test = 0.25;
+
+    unsigned threads = 0;
 
-    std::cout << '\n';
+    try
+    {
+        threads = build_threads(parser, std::thread::hardware_concurrency());
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+
+    cracker::Benchmark benchmark(seconds_per_test);
+
+    std::clog << "Benchmarking (about " << static_cast<int>(seconds_per_test * 40) << " seconds)...\n";
+    cracker::Benchmark::write_json(std::cout, benchmark.run(std::max(threads, 1u)), seconds_per_test);
 }
-                                      
-void gen_hash_to_file(std::string& file_name, std::initializer_list<std::string> plaintext) { //Hashes plaintext and outputs to file
 
-	auto md5hasher = std::make_unique<md5wrapper>();
-	std::ofstream out_file(file_name);
+//Run '--selftest' (the same checks as tests/selftest.cpp): print one line per kernel, and exit with status code 1 if any kernel differed
+//from the reference in any case
+void run_selftest()
+{
+    cracker::SelfTest selftest(std::clog);
+    bool passed = selftest.run();
 
-	if(out_file.good()) {
-		for(auto i : plaintext) {
-			out_file << md5hasher->getHashFromString(i) << "\n";
-		}
-	}
-	else
-		std::cout << "hashes not written. file is not good" << std::endl;
-	
-	out_file.close();
+    selftest.print(std::cout);
+
+    if (not passed)
+    {
+        std::clog << "***FATAL ERROR***: the self-test found kernels that disagree with the reference MD5. Exiting with status code 1...\n";
+        exit(1);
+    }
+
+    std::cout << "All kernels match the reference\n";
+}
+
+//Run '--rainbow-build': generate the chains of the '--brute'/'--mask' keyspace on every core ('--threads') and write the table
+void run_rainbow_build(const arg_parser::Parser& parser)
+{
+    constexpr std::uint32_t default_chain_length = 1000;
+
+    std::string filename = parser["--rainbow-build"][0].data();
+
+    try
+    {
+        unsigned threads = build_threads(parser, std::thread::hardware_concurrency());
+
+        if (not parser["--brute"].is_set() and not parser["--mask"].is_set())
+            throw cracker::SessionError("'--rainbow-build' needs the keyspace of a '--brute' or '--mask' attack", 1);
+
+        if (parser["--markov"].is_set() or parser["--markov-pot"].is_set())
+            throw cracker::SessionError("rainbow tables are always built in index order, '--markov' does not apply", 1);
+
+        Permute::Mask mask = build_mask(parser, nullptr);
+        std::uint32_t length = (parser["--chain-length"].is_set() ? std::stoul(parser["--chain-length"][0].data()) : default_chain_length);
+        std::uint32_t table_number = (parser["--table-number"].is_set() ? std::stoul(parser["--table-number"][0].data()) : 0);
+        std::uint64_t count = std::min({rainbow::max_chains, mask.size(), std::max<std::uint64_t>(mask.size() / std::max(length, 1u) * 2, 1)});
+
+        if (parser["--chains"].is_set())
+            count = std::stoull(parser["--chains"][0].data());
+
+        rainbow::Chains chains(mask, length, table_number, mask.size() / std::max<std::uint64_t>(count, 1));
+        cracker::ThreadPool pool(std::max(threads, 1u));
+
+        std::clog << "Building " << count << " chains of " << length << " links over " << mask.size() << " candidates\n";
+        std::uint64_t kept = rainbow::generate(filename, chains, count, pool, true);
+        std::clog << "Rainbow table " << std::quoted(filename) << ": " << kept << " chains (" << count - kept << " merged chains dropped)\n";
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+    catch (const std::logic_error& error)      //std::invalid_argument (bad lengths or counts), std::out_of_range (std::stoul)
+    {
+        fatal(cracker::SessionError(std::string("invalid rainbow table: ") + error.what(), 1));
+    }
+    catch (const std::runtime_error& error)    //The table file
+    {
+        fatal(cracker::SessionError(error.what(), 2));
+    }
+}
+
+//Run '--build-index': hash every word of '--dict' with every rule of '--rules' on every core ('--threads') and write the sorted digests.
+//The index records the wordlist by its absolute path, so '--index' finds it from any directory (and from the daemon).
+void run_build_index(const arg_parser::Parser& parser)
+{
+    std::string filename = parser["--build-index"][0].data();
+    std::string dictionary = (parser["--dict"].is_set() ? parser["--dict"][0].data() : "top-10-million-passwords.txt");
+
+    try
+    {
+        unsigned threads = build_threads(parser, std::thread::hardware_concurrency());
+        rules::RuleSet rule_set = build_rules(parser, "--rules");
+        char* resolved = ::realpath(dictionary.c_str(), nullptr);
+
+        if (resolved == nullptr)
+            throw cracker::SessionError("the file \"" + dictionary + "\" could not be found", 2);
+
+        dictionary = resolved;
+        free(resolved);
+
+        cracker::ThreadPool pool(std::max(threads, 1u));
+
+        std::clog << "Indexing " << std::quoted(dictionary) << " with " << std::max<std::size_t>(rule_set.size(), 1) << " rule(s)\n";
+        std::uint64_t count = hashindex::build(filename, dictionary, rule_set, pool, true);
+        std::clog << "Index " << std::quoted(filename) << ": " << count << " digests\n";
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+    catch (const std::logic_error& error)      //std::invalid_argument (wordlist or rules too large), std::out_of_range (std::stoul)
+    {
+        fatal(cracker::SessionError(std::string("invalid index: ") + error.what(), 1));
+    }
+    catch (const std::runtime_error& error)    //The wordlist or the index file
+    {
+        fatal(cracker::SessionError(error.what(), 2));
+    }
+}
+
+//Build the job of a '--client' request from its options, exactly like the commandline would (CAN THROW cracker::SessionError)
+cracker::Job remote_job(const std::vector<std::string>& args, const potfile::Potfile* pot)
+{
+    const std::regex option_pattern(R"((-|--)[a-zA-Z-]+)");     //What the parser takes for an option
+    arg_parser::Parser parser = make_parser();
+    std::vector<char*> argv{const_cast<char*>("daemon")};        //The parser only reads the arguments
+
+    for(const std::string& arg : args)
+    {
+        //The parser exits on unknown options, which must not take the daemon down
+        if (std::regex_match(arg, option_pattern))
+        {
+            try
+            {
+                (void) parser[arg];
+            }
+            catch (const std::out_of_range&)
+            {
+                throw cracker::SessionError("unrecognized argument: " + arg, 1);
+            }
+        }
+
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+
+    parser.parse(static_cast<int>(argv.size()), argv.data());
+
+    try
+    {
+        return build_job(parser, pot);
+    }
+    catch (const cracker::SessionError&)
+    {
+        throw;
+    }
+    catch (const std::out_of_range&)     //Argument::operator[]
+    {
+        throw cracker::SessionError("an option of the job is missing its parameters", 1);
+    }
+    catch (const std::exception& error)  //std::invalid_argument (std::stoul)
+    {
+        throw cracker::SessionError(std::string("invalid job options: ") + error.what(), 1);
+    }
+}
+
+//Run '--daemon': serve the jobs of '--client' processes on '--socket' until a client asks for a shutdown or SIGINT/SIGTERM arrives
+void run_daemon(const arg_parser::Parser& parser)
+{
+    std::string socket_name = (parser["--socket"].is_set() ? parser["--socket"][0].data() : "cracker.sock");
+    cracker::SessionOptions options;
+
+    set_numa(parser, options);
+    options.potfile = (parser["--no-potfile"].is_set() ? "" : (parser["--potfile"].is_set() ? parser["--potfile"][0].data() : "cracker.pot"));
+    options.stats_file = (parser["--stats-file"].is_set() ? parser["--stats-file"][0].data() : "");
+
+    checkpoint::install_signal_handlers();                   //SIGINT/SIGTERM stop the running job and the daemon
+
+    try
+    {
+        options.threads = build_threads(parser, 0);
+        remote::Server server(socket_name, options, remote_job);
+        server.serve();
+    }
+    catch (const cracker::SessionError& error)
+    {
+        fatal(error);
+    }
+}
+
+//Run '--client': submit the hashfile and the attack options on the commandline to the daemon on '--socket' and print every crack
+//('<hash> <password>', like the rows of the table) as soon as it arrives -- or, with '--status'/'--shutdown', just send that request
+void run_client(const arg_parser::Parser& parser, int argc, char* argv[])
+{
+    const std::regex option_pattern(R"((-|--)[a-zA-Z-]+)");
+    const std::vector<std::string> local = {"--client", "--socket", "--hashfile", "--status", "--shutdown"};        //Not part of the job
+    const std::vector<std::string> paths = {"--dict", "--rules", "--rules-left", "--rules-right", "--combinator", "--markov", "--pcfg", "--rainbow", "--index"};
+    std::string socket_name = (parser["--socket"].is_set() ? parser["--socket"][0].data() : "cracker.sock");
+    std::unique_ptr<remote::Client> client;
+
+    try
+    {
+        client = std::make_unique<remote::Client>(socket_name);
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::clog << "***FATAL ERROR***: " << error.what() << ". Exiting with status code 2...\n";
+        exit(2);
+    }
+
+    remote::Frame type;
+    std::string payload;
+
+    if (parser["--status"].is_set())
+    {
+        if (client->request(remote::Frame::status) and client->next(type, payload) and type == remote::Frame::report)
+            std::cout << payload;
+
+        return;
+    }
+
+    if (parser["--shutdown"].is_set())
+    {
+        client->request(remote::Frame::shutdown);
+        std::clog << "Asked the daemon on " << std::quoted(socket_name) << " to shut down\n";
+        return;
+    }
+
+    if (not parser["--hashfile"].is_set())
+    {
+        std::clog << "usage: ./a.out --client --hashfile <password_hashlist> [attack options]\n";
+        exit(1);
+    }
+
+    //The hash list travels with the job; the wordlists and rule files are read by the daemon, so their paths are made absolute
+    std::string hashfile = parser["--hashfile"][0].data();
+    std::ifstream hash_list(hashfile, std::ios::binary);
+    std::vector<std::string> args;
+    std::string current;
+
+    if (not hash_list.good())
+    {
+        std::clog << "***FATAL ERROR***: the file " << std::quoted(hashfile) << " could not be found. Exiting with status code 2...\n";
+        exit(2);
+    }
+
+    for(int i=1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (std::regex_match(arg, option_pattern))
+            current = arg;
+
+        if (std::find(local.begin(), local.end(), current) != local.end())
+            continue;
+
+        if (current != arg and std::find(paths.begin(), paths.end(), current) != paths.end())
+        {
+            if (char* resolved = ::realpath(arg.c_str(), nullptr))
+            {
+                arg = resolved;
+                std::free(resolved);
+            }
+        }
+
+        args.push_back(std::move(arg));
+    }
+
+    if (not client->submit(args, std::string(std::istreambuf_iterator<char>(hash_list), std::istreambuf_iterator<char>())))
+    {
+        std::clog << "***FATAL ERROR***: the daemon on " << std::quoted(socket_name) << " hung up. Exiting with status code 2...\n";
+        exit(2);
+    }
+
+    //Replies: accepted, the cracks as they happen, then done (or an error)
+    while (client->next(type, payload))
+    {
+        remote::Reader fields(payload);
+
+        if (type == remote::Frame::accepted)
+        {
+            std::uint64_t id = fields.number();
+            std::clog << "Job " << id << " accepted (" << fields.number() << " jobs ahead of it)\n";
+        }
+        else if (type == remote::Frame::crack)
+        {
+            std::string hash = fields.text();
+            std::cout << hash << ' ' << fields.text() << std::endl;
+        }
+        else if (type == remote::Frame::done)
+        {
+            bool finished = fields.number(1);
+            std::uint64_t cracked = fields.number(), targets = fields.number(), tested = fields.number();
+
+            std::clog << "Done: cracked " << cracked << " of " << targets << " targets with " << tested << " candidates"
+                      << (finished ? "" : " (stopped by the daemon)") << '\n';
+            return;
+        }
+        else if (type == remote::Frame::error)
+        {
+            int status = static_cast<int>(fields.number(4));      //[u32 status][message], read in that order
+            std::string message = fields.text();
+
+            if (not fields.ok())
+                fatal(cracker::SessionError("the daemon on \"" + socket_name + "\" sent a malformed error", 2));
+
+            fatal(cracker::SessionError(message, status));
+        }
+    }
+
+    std::clog << "***FATAL ERROR***: the daemon on " << std::quoted(socket_name) << " hung up before the job finished. Exiting with status code 2...\n";
+    exit(2);
 }
 
 //Print a the map of the hashed passwords and the cracked passwords as a table
@@ -0,0 +1,372 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Passwords, terminals, structures
+#include <string_view>          //Training words without copies
+#include <vector>              //Structures, terminal lists, queue storage
+#include <unordered_map>      //Counting while training
+#include <map>               //Terminal lists per (class, length), ordered for determinism
+#include <algorithm>        //std::sort, std::push_heap, std::pop_heap, std::nth_element
+#include <fstream>         //Training from a wordlist
+#include <stdexcept>      //std::runtime_error
+#include <cctype>        //std::isalpha, std::isdigit, std::isupper, std::tolower
+#include <cstdint>      //Counters
+
+namespace pcfg
+{
+    //One run of characters of the same class: 'L' (letters), 'D' (digits) or 'S' (everything else)
+    struct Segment
+    {
+        char type;
+        std::size_t length;
+    };
+
+    //A terminal (or capitalization pattern) with its probability within its list
+    struct Terminal
+    {
+        std::string value;
+        double probability;
+    };
+
+    //A base structure such as L6D2S1 with its probability
+    struct Structure
+    {
+        std::vector<Segment> segments;
+        double probability;
+    };
+
+    //Class 'Grammar' is a probabilistic context-free grammar learnt from known passwords (Weir et al.): the probabilities of the base
+    //structures, of the terminals of each segment type and length (letters in lowercase), and of the capitalization patterns of
+    //letter segments. A guess is a structure plus one terminal per segment (and one capitalization pattern per letter segment); its
+    //probability is the product of theirs.
+    class Grammar final
+    {
+        private:
+            std::unordered_map<std::string, std::uint64_t> structure_counts;                    //"L6D2S1" -> count
+            std::map<std::string, std::unordered_map<std::string, std::uint64_t>> terminal_counts;  //"L6" -> terminal -> count
+            std::map<std::size_t, std::unordered_map<std::string, std::uint64_t>> case_counts;   //Letter run length -> "ULLLLL" -> count
+            std::uint64_t words = 0;                                                            //Number of training words
+
+            std::vector<Structure> structures;                    //Sorted by decreasing probability
+            std::map<std::string, std::vector<Terminal>> terminals;   //"D2" -> terminals, most likely first
+            std::map<std::size_t, std::vector<Terminal>> cases;      //Letter run length -> capitalization patterns, most likely first
+
+            static std::vector<Terminal> sorted(const std::unordered_map<std::string, std::uint64_t>&);
+
+        public:
+            //General methods
+            void train(std::string_view);
+            void train_file(const std::string&);
+            void finish();
+
+            [[nodiscard]] std::uint64_t size() const noexcept;
+            [[nodiscard]] const std::vector<Structure>& base_structures() const noexcept;
+            [[nodiscard]] const std::vector<Terminal>& terminal_list(const Segment&) const;
+            [[nodiscard]] const std::vector<Terminal>& case_list(std::size_t) const;
+
+            [[nodiscard]] static std::vector<Segment> parse(std::string_view);
+            [[nodiscard]] static std::string key(const Segment&);
+    };
+
+    //Class 'Generator' enumerates the guesses of a grammar in roughly decreasing probability with a priority queue (the pivot-based next
+    //function of Weir et al.: a guess only spawns the guesses that replace its pivot choice or a later one with the next less likely
+    //option, and each child's pivot is the slot that changed, so every guess is produced exactly once). The queue is bounded: when it
+    //outgrows the limit, its least likely half is dropped.
+    class Generator final
+    {
+        private:
+            //A choice list of a structure: the terminals of a segment, or the capitalization patterns of a letter segment
+            struct Slot
+            {
+                const std::vector<Terminal>* options;
+                std::size_t segment;
+                bool capitalization;
+            };
+
+            //A guess waiting in the queue
+            struct Node
+            {
+                double probability;
+                std::uint32_t structure;
+                std::uint32_t pivot;
+                std::vector<std::uint32_t> choices;    //Index into every slot's options
+
+                bool operator<(const Node& other) const noexcept { return probability < other.probability; }
+            };
+
+            const Grammar& grammar;
+            std::vector<std::vector<Slot>> slots;      //Per structure
+            std::vector<Node> queue;                  //Max-heap on the probability
+            std::size_t max_queue;                   //Bound on the queue size
+            std::uint64_t dropped = 0;              //Guesses dropped to keep the queue bounded
+
+            void push(Node&&);
+
+        public:
+            //Special methods
+            Generator(const Grammar&, std::size_t = 1 << 20);
+
+            //General methods
+            bool next(std::string*);
+            [[nodiscard]] std::uint64_t dropped_guesses() const noexcept;
+    };
+
+
+    // ***** GRAMMAR ***** //
+
+    //Split a password into runs of letters, digits and other characters
+    [[nodiscard]] inline std::vector<Segment> Grammar::parse(std::string_view word)
+    {
+        std::vector<Segment> segments;
+
+        for(unsigned char c : word)
+        {
+            char type = (std::isalpha(c) ? 'L' : (std::isdigit(c) ? 'D' : 'S'));
+
+            if (not segments.empty() and segments.back().type == type)
+                ++segments.back().length;
+            else
+                segments.push_back({type, 1});
+        }
+
+        return segments;
+    }
+
+    //Return the name of a segment, e.g. "L6"
+    [[nodiscard]] inline std::string Grammar::key(const Segment& segment)
+    {
+        return segment.type + std::to_string(segment.length);
+    }
+
+    //Count the structure, terminals and capitalization patterns of one known password
+    inline void Grammar::train(std::string_view word)
+    {
+        if (word.empty())
+            return;
+
+        std::string structure;
+        std::size_t offset = 0;
+
+        for(const Segment& segment : parse(word))
+        {
+            std::string_view text = word.substr(offset, segment.length);
+            structure += key(segment);
+
+            if (segment.type == 'L')
+            {
+                std::string lower, pattern;
+
+                for(unsigned char c : text)
+                {
+                    lower += static_cast<char>(std::tolower(c));
+                    pattern += (std::isupper(c) ? 'U' : 'L');
+                }
+
+                ++terminal_counts[key(segment)][lower];
+                ++case_counts[segment.length][pattern];
+            }
+            else
+                ++terminal_counts[key(segment)][std::string(text)];
+
+            offset += segment.length;
+        }
+
+        ++structure_counts[structure];
+        ++words;
+    }
+
+    //Train from a wordlist (one password per line) -- CAN THROW std::runtime_error
+    inline void Grammar::train_file(const std::string& filename)
+    {
+        std::ifstream wordlist(filename);
+        std::string word;
+
+        if (not wordlist.good())
+            throw std::runtime_error("the file \"" + filename + "\" could not be found");
+
+        while (std::getline(wordlist, word))
+        {
+            if (not word.empty() and word.back() == '\r')
+                word.pop_back();
+
+            train(word);
+        }
+    }
+
+    //Turn counts into a list sorted by decreasing probability (ties in byte order, so the order is deterministic)
+    inline std::vector<Terminal> Grammar::sorted(const std::unordered_map<std::string, std::uint64_t>& counts)
+    {
+        std::vector<Terminal> list;
+        std::uint64_t total = 0;
+
+        for(const auto& [value, count] : counts)
+            total += count;
+
+        for(const auto& [value, count] : counts)
+            list.push_back({value, static_cast<double>(count) / total});
+
+        std::sort(list.begin(), list.end(), [](const Terminal& a, const Terminal& b)
+        {
+            return (a.probability != b.probability ? a.probability > b.probability : a.value < b.value);
+        });
+
+        return list;
+    }
+
+    //Compute the probabilities (call once after the last train())
+    inline void Grammar::finish()
+    {
+        structures.clear();
+
+        for(const Terminal& structure : sorted(structure_counts))
+        {
+            Structure parsed{{}, structure.probability};
+
+            //"L6D2S1" -> {L,6} {D,2} {S,1}
+            for(std::size_t i=0; i < structure.value.size();)
+            {
+                std::size_t digits = structure.value.find_first_not_of("0123456789", i + 1);
+                digits = (digits == std::string::npos ? structure.value.size() : digits);
+
+                parsed.segments.push_back({structure.value[i], std::stoul(structure.value.substr(i + 1, digits - i - 1))});
+                i = digits;
+            }
+
+            structures.push_back(std::move(parsed));
+        }
+
+        for(const auto& [name, counts] : terminal_counts)
+            terminals[name] = sorted(counts);
+
+        for(const auto& [length, counts] : case_counts)
+            cases[length] = sorted(counts);
+    }
+
+    //Return the number of training words
+    [[nodiscard]] inline std::uint64_t Grammar::size() const noexcept
+    {
+        return words;
+    }
+
+    //Return the base structures, most likely first
+    [[nodiscard]] inline const std::vector<Structure>& Grammar::base_structures() const noexcept
+    {
+        return structures;
+    }
+
+    //Return the terminals of a segment, most likely first -- CAN THROW std::out_of_range
+    [[nodiscard]] inline const std::vector<Terminal>& Grammar::terminal_list(const Segment& segment) const
+    {
+        return terminals.at(key(segment));
+    }
+
+    //Return the capitalization patterns of a letter run, most likely first -- CAN THROW std::out_of_range
+    [[nodiscard]] inline const std::vector<Terminal>& Grammar::case_list(std::size_t length) const
+    {
+        return cases.at(length);
+    }
+
+
+    // ***** GENERATOR ***** //
+
+    //Constructor: one slot per segment (two for letter segments) and the most likely guess of every structure in the queue
+    inline Generator::Generator(const Grammar& in_grammar, std::size_t in_max_queue) : grammar(in_grammar), max_queue(std::max<std::size_t>(in_max_queue, 2))
+    {
+        const std::vector<Structure>& structures = grammar.base_structures();
+
+        for(std::uint32_t s=0; s < structures.size(); ++s)
+        {
+            std::vector<Slot> structure_slots;
+            Node first{structures[s].probability, s, 0, {}};
+
+            for(std::size_t i=0; i < structures[s].segments.size(); ++i)
+            {
+                const Segment& segment = structures[s].segments[i];
+                structure_slots.push_back({&grammar.terminal_list(segment), i, false});
+
+                if (segment.type == 'L')
+                    structure_slots.push_back({&grammar.case_list(segment.length), i, true});
+            }
+
+            for(const Slot& slot : structure_slots)
+                first.probability *= slot.options->front().probability;
+
+            first.choices.assign(structure_slots.size(), 0);
+            slots.push_back(std::move(structure_slots));
+            push(std::move(first));
+        }
+    }
+
+    //Add a guess to the queue, dropping the least likely half of the queue if it is full
+    inline void Generator::push(Node&& node)
+    {
+        queue.push_back(std::move(node));
+        std::push_heap(queue.begin(), queue.end());
+
+        if (queue.size() > max_queue)
+        {
+            std::size_t keep = max_queue / 2;
+
+            std::nth_element(queue.begin(), queue.begin() + keep, queue.end(), [](const Node& a, const Node& b) { return b < a; });
+            dropped += queue.size() - keep;
+            queue.resize(keep);
+            std::make_heap(queue.begin(), queue.end());
+        }
+    }
+
+    //Produce the next most likely guess into 'out' (nullptr: only advance) -- returns false once the grammar is exhausted
+    inline bool Generator::next(std::string* out)
+    {
+        if (queue.empty())
+            return false;
+
+        std::pop_heap(queue.begin(), queue.end());
+        Node node = std::move(queue.back());
+        queue.pop_back();
+
+        const std::vector<Slot>& structure_slots = slots[node.structure];
+
+        //Build the guess: terminals in order, capitalization applied to letter segments
+        if (out != nullptr)
+        {
+            out->clear();
+
+            for(std::size_t i=0; i < structure_slots.size(); ++i)
+            {
+                const std::string& value = (*structure_slots[i].options)[node.choices[i]].value;
+
+                if (not structure_slots[i].capitalization)
+                    out->append(value);
+                else
+                {
+                    std::size_t start = out->size() - value.size();
+
+                    for(std::size_t c=0; c < value.size(); ++c)
+                        if (value[c] == 'U')
+                            (*out)[start + c] = static_cast<char>(std::toupper(static_cast<unsigned char>((*out)[start + c])));
+                }
+            }
+        }
+
+        //Children: the next option of the pivot slot or of any later slot
+        for(std::uint32_t i=node.pivot; i < structure_slots.size(); ++i)
+        {
+            const std::vector<Terminal>& options = *structure_slots[i].options;
+
+            if (node.choices[i] + 1 >= options.size())
+                continue;
+
+            Node child{node.probability / options[node.choices[i]].probability * options[node.choices[i] + 1].probability, node.structure, i, node.choices};
+            ++child.choices[i];
+            push(std::move(child));
+        }
+
+        return true;
+    }
+
+    //Return the number of guesses that were dropped to keep the queue bounded
+    [[nodiscard]] inline std::uint64_t Generator::dropped_guesses() const noexcept
+    {
+        return dropped;
+    }
+}
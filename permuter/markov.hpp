@@ -0,0 +1,112 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Charsets and training words
+#include <string_view>          //Training words without copies
+#include <vector>              //Per-position count tables
+#include <array>              //256 x 256 counts per position
+#include <algorithm>         //std::stable_sort
+#include <fstream>          //Training from a wordlist
+#include <stdexcept>       //std::runtime_error
+#include <cstdint>        //Counts
+
+namespace Permute {
+
+//Class 'Markov' holds per-position, per-previous-character frequency counts trained from known passwords, and uses them to
+//order a charset from most to least likely. The order is only a permutation of the charset, so a keyspace built with it
+//still contains exactly the same candidates -- the likely ones just get the low indices.
+class Markov final
+{
+	public:
+		//Positions from here on share the statistics of the last one (long passwords are rare in training data anyway)
+		static constexpr std::size_t max_positions = 16;
+
+	private:
+		using table = std::array<std::array<std::uint32_t, 256>, 256>;   //[previous character][character] -> count
+
+		std::vector<table> counts;      //One table per position; the first position uses previous character '\0'
+		std::uint64_t words = 0;       //Number of training words
+
+	public:
+		//Special methods
+		Markov();
+
+		//General methods
+		void train(std::string_view);
+		void train_file(const std::string&);
+		[[nodiscard]] std::uint64_t size() const noexcept;
+		[[nodiscard]] std::string order(std::size_t, char, const std::string&) const;
+};
+
+
+// ***** SPECIAL METHODS ***** //
+
+//Constructor (no statistics: every order is the plain charset order)
+inline Markov::Markov() : counts(max_positions)
+{
+	for(table& position : counts)
+		for(auto& row : position)
+			row.fill(0);
+}
+
+
+// ***** GENERAL METHODS ***** //
+
+//Count the characters of one known password
+inline void Markov::train(std::string_view word)
+{
+	unsigned char prev = '\0';
+
+	for(std::size_t pos=0; pos < word.size(); ++pos)
+	{
+		unsigned char c = static_cast<unsigned char>(word[pos]);
+		std::uint32_t& count = counts[std::min(pos, max_positions - 1)][prev][c];
+
+		if (count != UINT32_MAX)
+			++count;
+
+		prev = c;
+	}
+
+	++words;
+}
+
+//Train from a wordlist (one password per line) -- CAN THROW std::runtime_error
+inline void Markov::train_file(const std::string& filename)
+{
+	std::ifstream wordlist(filename);
+	std::string word;
+
+	if (not wordlist.good())
+		throw std::runtime_error("the file \"" + filename + "\" could not be found");
+
+	while (std::getline(wordlist, word))
+	{
+		if (not word.empty() and word.back() == '\r')
+			word.pop_back();
+
+		train(word);
+	}
+}
+
+//Return the number of training words
+[[nodiscard]] inline std::uint64_t Markov::size() const noexcept
+{
+	return words;
+}
+
+//Return 'charset' ordered by how often each character followed 'prev' at position 'pos' (ties keep the charset order)
+[[nodiscard]] inline std::string Markov::order(std::size_t pos, char prev, const std::string& charset) const
+{
+	const auto& row = counts[std::min(pos, max_positions - 1)][static_cast<unsigned char>(pos == 0 ? '\0' : prev)];
+	std::string ordered = charset;
+
+	std::stable_sort(ordered.begin(), ordered.end(), [&row](char a, char b)
+	{
+		return row[static_cast<unsigned char>(a)] > row[static_cast<unsigned char>(b)];
+	});
+
+	return ordered;
+}
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Charsets
+#include <string_view>          //Parsing masks without copying them
+#include <vector>              //Per-position charsets, one keyspace per length
+#include <utility>            //std::pair
+#include <algorithm>         //std::upper_bound
+#include <limits>           //Overflow check on the combined keyspace size
+#include <stdexcept>       //std::invalid_argument, std::overflow_error
+#include <cstdint>        //64-bit keyspace indices
+
+//Custom Libraries
+#include "permute.hpp"
+
+namespace Permute {
+
+//Built-in charsets (?l ?u ?d ?s ?a)
+const std::string lower{"abcdefghijklmnopqrstuvwxyz"};
+const std::string upper{"ABCDEFGHIJKLMNOPQRSTUVWXYZ"};
+const std::string digits{"0123456789"};
+const std::string special{" !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"};
+const std::string all{lower + upper + digits + special};
+
+//Expand one '?x' placeholder into its charset -- CAN THROW std::invalid_argument
+inline const std::string& placeholder_charset(char c, const std::vector<std::string>& custom)
+{
+	static const std::string question_mark{"?"};
+
+	switch (c)
+	{
+		case 'l': return lower;
+		case 'u': return upper;
+		case 'd': return digits;
+		case 's': return special;
+		case 'a': return all;
+		case '?': return question_mark;
+		case '1': case '2': case '3': case '4':
+			if (static_cast<std::size_t>(c - '1') < custom.size())
+				return custom[c - '1'];
+			throw std::invalid_argument(std::string("custom charset ?") + c + " is used but was not defined");
+		default:
+			throw std::invalid_argument(std::string("unknown charset ?") + c);
+	}
+}
+
+//Expand a user-defined charset such as "?l?d_" into the characters it stands for (built-in placeholders only)
+inline std::string expand_charset(std::string_view definition)
+{
+	std::string charset;
+
+	for(std::size_t i=0; i < definition.size(); ++i)
+	{
+		if (definition[i] == '?' and i + 1 < definition.size())
+		{
+			if (definition[i+1] >= '1' and definition[i+1] <= '4')
+				throw std::invalid_argument("custom charsets cannot refer to other custom charsets");
+
+			charset += placeholder_charset(definition[++i], {});
+		}
+		else
+			charset += definition[i];
+	}
+
+	return charset;
+}
+
+//Parse a mask such as "?u?l?l?l?d?d!" into one charset per position (literal characters become single-character charsets)
+inline std::vector<std::string> parse_mask(std::string_view mask, const std::vector<std::string>& custom = {})
+{
+	std::vector<std::string> positions;
+
+	for(std::size_t i=0; i < mask.size(); ++i)
+	{
+		if (mask[i] != '?')
+			positions.emplace_back(1, mask[i]);
+		else if (i + 1 < mask.size())
+			positions.push_back(placeholder_charset(mask[++i], custom));
+		else
+			throw std::invalid_argument("mask ends with a lone '?'");
+	}
+
+	return positions;
+}
+
+//Class 'Mask' is the keyspace of a mask attack over a range of lengths: the first L positions of the mask for every L in
+//[min_len, max_len], shortest first. Indices are global over all lengths, so the whole attack is one index-addressable keyspace.
+class Mask final
+{
+	private:
+		std::vector<Keyspace> keyspaces;        //One keyspace per length (shortest first)
+		std::vector<std::uint64_t> offsets;    //Global index of the first candidate of each length
+		std::uint64_t total = 0;              //Number of candidates over all lengths
+
+	public:
+		//Special methods
+		Mask(const std::vector<std::string>&, std::size_t, std::size_t, const Markov* = nullptr);
+
+		//General methods
+		[[nodiscard]] std::uint64_t size() const noexcept;
+		[[nodiscard]] std::size_t lengths() const noexcept;
+		[[nodiscard]] const Keyspace& keyspace(std::size_t) const;
+		[[nodiscard]] std::uint64_t offset(std::size_t) const;
+		[[nodiscard]] std::pair<std::size_t, std::uint64_t> locate(std::uint64_t) const;
+		[[nodiscard]] std::string at(std::uint64_t) const;
+};
+
+
+// ***** SPECIAL METHODS ***** //
+
+//Constructor (optionally in Markov order) -- CAN THROW std::invalid_argument (bad length range) and std::overflow_error (more than 2^64 candidates)
+inline Mask::Mask(const std::vector<std::string>& positions, std::size_t min_len, std::size_t max_len, const Markov* markov)
+{
+	if (min_len == 0 or min_len > max_len or max_len > positions.size())
+		throw std::invalid_argument("the length range must satisfy 1 <= min-len <= max-len <= " + std::to_string(positions.size()));
+
+	for(std::size_t len=min_len; len <= max_len; ++len)
+	{
+		keyspaces.emplace_back(std::vector<std::string>(positions.begin(), positions.begin() + len), markov);
+
+		if (total > std::numeric_limits<std::uint64_t>::max() - keyspaces.back().size())
+			throw std::overflow_error("mask has more than 2^64 candidates");
+
+		offsets.push_back(total);
+		total += keyspaces.back().size();
+	}
+}
+
+
+// ***** GENERAL METHODS ***** //
+
+//Return the number of candidates over all lengths (known before the attack starts, so progress and ETA are exact)
+[[nodiscard]] inline std::uint64_t Mask::size() const noexcept
+{
+	return total;
+}
+
+//Return the number of lengths
+[[nodiscard]] inline std::size_t Mask::lengths() const noexcept
+{
+	return keyspaces.size();
+}
+
+//Return the keyspace of the i-th length
+[[nodiscard]] inline const Keyspace& Mask::keyspace(std::size_t i) const
+{
+	return keyspaces.at(i);   //CAN THROW std::out_of_range
+}
+
+//Return the global index of the first candidate of the i-th length
+[[nodiscard]] inline std::uint64_t Mask::offset(std::size_t i) const
+{
+	return offsets.at(i);   //CAN THROW std::out_of_range
+}
+
+//Split a global index into (length number, index within that length's keyspace)
+[[nodiscard]] inline std::pair<std::size_t, std::uint64_t> Mask::locate(std::uint64_t index) const
+{
+	std::size_t i = static_cast<std::size_t>(std::upper_bound(offsets.begin(), offsets.end(), index) - offsets.begin()) - 1;
+	return {i, index - offsets[i]};
+}
+
+//Return the candidate with the given global index
+[[nodiscard]] inline std::string Mask::at(std::uint64_t index) const
+{
+	auto [i, local] = locate(index);
+	return keyspaces[i].at(local);
+}
+
+}
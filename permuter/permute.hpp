@@ -1,28 +1,281 @@
-#include <string>
-#include <iostream>
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Charsets and candidates
+#include <string_view>          //Viewing the current candidate without copying it
+#include <vector>              //Per-position charsets and tables
+#include <array>              //Per-position 256 entry lookup tables
+#include <limits>            //Overflow check on the keyspace size
+#include <stdexcept>        //std::invalid_argument, std::overflow_error
+#include <cstdint>         //64-bit keyspace indices
+
+//Custom Libraries
+#include "markov.hpp"     //Likelihood order of each position
 
 namespace Permute {
 
-std::string gen_brute_str(const size_t length, size_t i = 0);
+//Charset of the original brute-force generator
+const std::string alphanum{"0123456789abcdefghijklmnopqrstuvwxyz"};
+
+//Class 'Keyspace' maps every 64-bit index in [0, size()) to exactly one candidate and back. Each position has its own charset;
+//the last position changes fastest, so index order is lexicographic in charset order (for one charset: "000", "001", ... "zzz").
+//Because any index can be turned into a candidate directly, a keyspace can be split into ranges, restarted and run on many threads.
+//With a Markov model, the order of each position's charset depends on the character before it (digit d of a position is the
+//d-th most likely character after the previous one); the set of candidates and the index addressing stay exactly the same.
+class Keyspace final
+{
+	private:
+		//The charset of a position in the order used after one particular previous character
+		struct Order
+		{
+			std::string chars;                            //Charset in index order
+			std::array<char, 256> next;                  //Character -> the character after it
+			std::array<std::uint8_t, 256> digit;        //Character -> its index in 'chars'
+		};
+
+		std::vector<std::string> charsets;                      //Charset of every position (duplicates removed, original order)
+		std::vector<std::vector<Order>> orders;                //Per position: one order per distinct previous character
+		std::vector<std::array<std::uint8_t, 256>> order_of;  //Per position: previous character -> its order
+		bool conditioned = false;                            //Whether any order depends on the previous character
+		std::uint64_t total = 1;                            //Number of candidates
+
+		[[nodiscard]] const Order& order(std::size_t, const char*) const noexcept;
+
+	public:
+		//Special methods
+		Keyspace(const std::string&, std::size_t);                                 //The same charset at every position
+		explicit Keyspace(std::vector<std::string>, const Markov* = nullptr);     //One charset per position (+ likelihood order)
+
+		//General methods
+		[[nodiscard]] std::size_t length() const noexcept;
+		[[nodiscard]] std::uint64_t size() const noexcept;
+		[[nodiscard]] const std::string& charset(std::size_t) const;
+		[[nodiscard]] const std::string& charset(std::size_t, char) const;
+		void at(std::uint64_t, char*) const noexcept;
+		[[nodiscard]] std::string at(std::uint64_t) const;
+		[[nodiscard]] std::uint64_t index_of(std::string_view) const;
+		bool increment(char*) const noexcept;
+};
+
+//Class 'Cursor' walks the candidates of a keyspace in [begin, end), incrementing one candidate in place
+class Cursor final
+{
+	private:
+		const Keyspace& keyspace;      //Keyspace being enumerated
+		std::uint64_t current;        //Index of the current candidate
+		std::uint64_t end;           //One past the last index
+		std::string candidate;      //The current candidate
+
+	public:
+		//Special methods
+		Cursor(const Keyspace&, std::uint64_t, std::uint64_t);
+
+		//General methods
+		[[nodiscard]] bool valid() const noexcept;
+		void advance() noexcept;
+		[[nodiscard]] std::uint64_t index() const noexcept;
+		[[nodiscard]] std::string_view value() const noexcept;
+};
+
+
+// ***** SPECIAL METHODS ***** //
+
+//Constructor (the same charset at every position)
+inline Keyspace::Keyspace(const std::string& charset, std::size_t length) : Keyspace(std::vector<std::string>(length, charset))
+{
+}
+
+//Constructor (one charset per position, ordered by a Markov model if one is given) -- CAN THROW std::invalid_argument (empty charset)
+//and std::overflow_error (more than 2^64 candidates)
+inline Keyspace::Keyspace(std::vector<std::string> in_charsets, const Markov* markov)
+{
+	charsets.reserve(in_charsets.size());
+	orders.resize(in_charsets.size());
+	order_of.resize(in_charsets.size());
+
+	for(std::size_t pos=0; pos < in_charsets.size(); ++pos)
+	{
+		//Remove duplicate characters (keeping the first occurrence) so every candidate appears exactly once
+		std::string unique;
+		std::array<bool, 256> seen{};
+
+		for(unsigned char c : in_charsets[pos])
+		{
+			if (not seen[c])
+			{
+				seen[c] = true;
+				unique += static_cast<char>(c);
+			}
+		}
+
+		if (unique.empty())
+			throw std::invalid_argument("keyspace position " + std::to_string(pos) + " has an empty charset");
+
+		//One order per character of the previous position (a single one for the first position or without a model)
+		const std::string previous = (markov != nullptr and pos > 0 ? charsets[pos - 1] : std::string(1, '\0'));
+		order_of[pos].fill(0);
+
+		for(char prev : previous)
+		{
+			Order order;
+			order.chars = (markov != nullptr ? markov->order(pos, prev, unique) : unique);
+
+			//Precompute the successor and digit of every character (the last character wraps around to the first)
+			order.next.fill(order.chars[0]);
+			order.digit.fill(0);
+
+			for(std::size_t i=0; i < order.chars.size(); ++i)
+			{
+				order.next[static_cast<unsigned char>(order.chars[i])] = order.chars[(i + 1) % order.chars.size()];
+				order.digit[static_cast<unsigned char>(order.chars[i])] = static_cast<std::uint8_t>(i);
+			}
+
+			conditioned = conditioned or (not orders[pos].empty() and order.chars != orders[pos].front().chars);
+			order_of[pos][static_cast<unsigned char>(prev)] = static_cast<std::uint8_t>(orders[pos].size());
+			orders[pos].push_back(std::move(order));
+		}
+
+		if (total > std::numeric_limits<std::uint64_t>::max() / unique.size())
+			throw std::overflow_error("keyspace has more than 2^64 candidates");
+
+		total *= unique.size();
+		charsets.push_back(std::move(unique));
+	}
+}
+
+//Constructor (enumerate [begin, end) of a keyspace)
+inline Cursor::Cursor(const Keyspace& in_keyspace, std::uint64_t begin, std::uint64_t in_end)
+	: keyspace(in_keyspace), current(begin), end(std::min(in_end, in_keyspace.size())), candidate(in_keyspace.length(), '\0')
+{
+	if (current < end)
+		keyspace.at(current, candidate.data());
+}
+
+
+// ***** PRIVATE METHODS ***** //
+
+//Return the order of a position, given the candidate it belongs to (only the previous character is read)
+[[nodiscard]] inline const Keyspace::Order& Keyspace::order(std::size_t pos, const char* candidate) const noexcept
+{
+	return orders[pos][pos == 0 ? 0 : order_of[pos][static_cast<unsigned char>(candidate[pos - 1])]];
+}
+
+
+// ***** GENERAL METHODS ***** //
+
+//Return the length of the candidates
+[[nodiscard]] inline std::size_t Keyspace::length() const noexcept
+{
+	return charsets.size();
+}
+
+//Return the number of candidates
+[[nodiscard]] inline std::uint64_t Keyspace::size() const noexcept
+{
+	return total;
+}
+
+//Return the charset of a position
+[[nodiscard]] inline const std::string& Keyspace::charset(std::size_t pos) const
+{
+	return charsets.at(pos);   //CAN THROW std::out_of_range
+}
 
-std::string gen_brute_str(const size_t length, size_t i) {
-	const static std::string alphanum{"0123456789abcdefghijklmnopqrstuvwxyz"};
-	static std::string genString(length, alphanum[0]);
-	const static size_t alphanumLength = alphanum.length();
+//Return the charset of a position in the order used after the character 'prev' (index order of that position)
+[[nodiscard]] inline const std::string& Keyspace::charset(std::size_t pos, char prev) const
+{
+	return orders.at(pos)[pos == 0 ? 0 : order_of[pos][static_cast<unsigned char>(prev)]].chars;   //CAN THROW std::out_of_range
+}
 
-	if(i > length) {
-		return genString;
+//Write the candidate with the given index into 'out' (length() bytes, not null-terminated)
+inline void Keyspace::at(std::uint64_t index, char* out) const noexcept
+{
+	//Split the index into one digit per position, then turn the digits into characters from the first position on
+	for(std::size_t pos=charsets.size(); pos-- > 0;)
+	{
+		out[pos] = static_cast<char>(index % charsets[pos].size());
+		index /= charsets[pos].size();
 	}
 
-	if(genString[i] != alphanum[alphanumLength-1]) {
-		genString[i] = alphanum[alphanum.find(genString[i])+1];
+	for(std::size_t pos=0; pos < charsets.size(); ++pos)
+		out[pos] = order(pos, out).chars[static_cast<unsigned char>(out[pos])];
+}
+
+//Return the candidate with the given index
+[[nodiscard]] inline std::string Keyspace::at(std::uint64_t index) const
+{
+	std::string candidate(charsets.size(), '\0');
+	at(index, candidate.data());
+	return candidate;
+}
+
+//Return the index of a candidate -- CAN THROW std::invalid_argument if it is not part of the keyspace
+[[nodiscard]] inline std::uint64_t Keyspace::index_of(std::string_view candidate) const
+{
+	if (candidate.size() != charsets.size())
+		throw std::invalid_argument("candidate has the wrong length for this keyspace");
+
+	std::uint64_t index = 0;
+	for(std::size_t pos=0; pos < charsets.size(); ++pos)
+	{
+		unsigned char c = static_cast<unsigned char>(candidate[pos]);
+		const Order& current = order(pos, candidate.data());
+
+		if (current.chars[current.digit[c]] != static_cast<char>(c))
+			throw std::invalid_argument("candidate is not part of this keyspace");
+
+		index = index * charsets[pos].size() + current.digit[c];
 	}
-	else {
-		gen_brute_str(length, i+1);
-		genString[i] = alphanum[(alphanum.find(genString[i])+1) % alphanumLength];
+
+	return index;
+}
+
+//Advance a candidate to the next one in place (odometer carries from the last position); returns false when it wraps around to index 0
+inline bool Keyspace::increment(char* candidate) const noexcept
+{
+	std::size_t pos = charsets.size();
+
+	while (pos-- > 0)
+	{
+		const Order& current = order(pos, candidate);
+		char next = current.next[static_cast<unsigned char>(candidate[pos])];
+		candidate[pos] = next;
+
+		if (next != current.chars[0])   //No carry
+			break;
 	}
 
-	return genString;
-}	
+	//The positions that carried restart at digit 0 -- of the order that follows their new previous character
+	if (conditioned)
+		for(std::size_t after = (pos < charsets.size() ? pos + 1 : 1); after < charsets.size(); ++after)
+			candidate[after] = order(after, candidate).chars[0];
+
+	return pos < charsets.size();
+}
+
+//Return whether the cursor still points at a candidate
+[[nodiscard]] inline bool Cursor::valid() const noexcept
+{
+	return current < end;
+}
+
+//Move to the next candidate
+inline void Cursor::advance() noexcept
+{
+	++current;
+	keyspace.increment(candidate.data());
+}
+
+//Return the index of the current candidate
+[[nodiscard]] inline std::uint64_t Cursor::index() const noexcept
+{
+	return current;
+}
+
+//Return the current candidate
+[[nodiscard]] inline std::string_view Cursor::value() const noexcept
+{
+	return candidate;
+}
 
 }
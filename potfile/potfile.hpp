@@ -0,0 +1,254 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Potfile name
+#include <string_view>          //Plaintexts are returned as views into the mapping
+#include <optional>            //A lookup may miss
+#include <unordered_map>      //Digest -> record offset index
+#include <vector>            //Building a record before writing it
+#include <stdexcept>        //std::runtime_error
+#include <cstdint>         //Fixed width record fields
+#include <cstring>        //std::memcpy, std::strerror
+#include <cerrno>        //errno
+
+//Native POSIX Libraries
+#include <fcntl.h>       //open()
+#include <unistd.h>     //write(), ftruncate(), fdatasync(), close()
+#include <sys/mman.h>  //mmap(), munmap()
+#include <sys/stat.h> //fstat()
+#include <sys/file.h>//flock()
+
+//Custom Libraries
+#include "../cracker/digest.hpp"
+
+namespace potfile
+{
+    //File layout:  "MD5POT1\n" header, followed by records of  [16 byte digest][uint16 length (little endian)][plaintext]
+    constexpr char magic[8] = {'M', 'D', '5', 'P', 'O', 'T', '1', '\n'};
+    constexpr std::size_t record_header = 16 + 2;
+    constexpr std::size_t max_plaintext = 0xffff;
+
+    //Class 'Potfile' is an append-only store of every password ever cracked, shared by all cracker processes on the host.
+    //The file is memory-mapped and indexed by digest; appends take an exclusive flock() so several processes can write at once.
+    class Potfile final
+    {
+        private:
+            std::string filename;                                                          //Name of the potfile
+            int fd = -1;                                                                  //Descriptor (opened O_APPEND)
+            const char* map = nullptr;                                                   //Read-only mapping of the file
+            std::size_t mapped = 0;                                                     //Size of the mapping
+            std::size_t valid_end = 0;                                                 //End of the last complete record
+            std::unordered_map<cracker::digest, std::size_t, cracker::digest_hash> index;  //Digest -> offset of its record
+
+            void remap(std::size_t);
+            void scan();
+
+        public:
+            //Special methods
+            explicit Potfile(std::string);
+            ~Potfile();
+            Potfile(const Potfile&) = delete;
+            Potfile& operator=(const Potfile&) = delete;
+
+            //General methods
+            [[nodiscard]] std::optional<std::string_view> find(const cracker::digest&) const noexcept;
+            [[nodiscard]] std::size_t size() const noexcept;
+            [[nodiscard]] const std::string& file() const noexcept;
+            void refresh();
+            void append(const cracker::digest&, std::string_view);
+
+            //Iterate over every (digest, plaintext) pair in the potfile
+            template <typename Function>
+            void for_each(Function&&) const;
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: open (or create) the potfile and index everything already in it -- CAN THROW std::runtime_error
+    inline Potfile::Potfile(std::string in_filename) : filename(std::move(in_filename))
+    {
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+        if (fd < 0)
+            throw std::runtime_error("cannot open potfile \"" + filename + "\": " + std::strerror(errno));
+
+        refresh();
+    }
+
+    //Destructor
+    inline Potfile::~Potfile()
+    {
+        if (map != nullptr)
+            ::munmap(const_cast<char*>(map), mapped);
+
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Map the first 'size' bytes of the file (views returned by find() are invalidated)
+    inline void Potfile::remap(std::size_t size)
+    {
+        if (map != nullptr)
+            ::munmap(const_cast<char*>(map), mapped);
+
+        map = nullptr;
+        mapped = 0;
+
+        if (size == 0)
+            return;
+
+        void* region = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (region == MAP_FAILED)
+            throw std::runtime_error("cannot map potfile \"" + filename + "\": " + std::strerror(errno));
+
+        map = static_cast<const char*>(region);
+        mapped = size;
+    }
+
+    //Index the complete records between 'valid_end' and the end of the mapping. A torn record at the end (another process is
+    //still writing it, or a writer crashed) is left for the next refresh()/append() to deal with.
+    inline void Potfile::scan()
+    {
+        if (valid_end == 0)
+        {
+            if (mapped < sizeof(magic))
+                return;
+
+            if (std::memcmp(map, magic, sizeof(magic)) != 0)
+                throw std::runtime_error("\"" + filename + "\" is not a potfile");
+
+            valid_end = sizeof(magic);
+        }
+
+        while (valid_end + record_header <= mapped)
+        {
+            const auto* record = reinterpret_cast<const unsigned char*>(map + valid_end);
+            std::size_t length = record[16] | (static_cast<std::size_t>(record[17]) << 8);
+
+            if (valid_end + record_header + length > mapped)
+                break;
+
+            cracker::digest d;
+            std::memcpy(d.data(), record, d.size());
+            index[d] = valid_end;
+
+            valid_end += record_header + length;
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Return the plaintext of a digest if it has been cracked before (view into the mapping: valid until the next refresh/append)
+    [[nodiscard]] inline std::optional<std::string_view> Potfile::find(const cracker::digest& d) const noexcept
+    {
+        auto itr = index.find(d);
+
+        if (itr == index.end())
+            return std::nullopt;
+
+        const char* record = map + itr->second;
+        std::size_t length = static_cast<unsigned char>(record[16]) | (static_cast<std::size_t>(static_cast<unsigned char>(record[17])) << 8);
+
+        return std::string_view(record + record_header, length);
+    }
+
+    //Return the number of distinct digests in the potfile
+    [[nodiscard]] inline std::size_t Potfile::size() const noexcept
+    {
+        return index.size();
+    }
+
+    //Return the name of the potfile
+    [[nodiscard]] inline const std::string& Potfile::file() const noexcept
+    {
+        return filename;
+    }
+
+    //Pick up records appended by other processes since the last refresh
+    inline void Potfile::refresh()
+    {
+        struct stat info;
+
+        if (::fstat(fd, &info) != 0)
+            throw std::runtime_error("cannot stat potfile \"" + filename + "\": " + std::strerror(errno));
+
+        if (static_cast<std::size_t>(info.st_size) != mapped)
+        {
+            remap(static_cast<std::size_t>(info.st_size));
+            scan();
+        }
+    }
+
+    //Durably append a cracked password. The record goes out in a single write() under an exclusive lock, and is flushed with
+    //fdatasync() before returning, so a crash or a concurrent writer can never interleave with it.
+    inline void Potfile::append(const cracker::digest& d, std::string_view plaintext)
+    {
+        if (plaintext.size() > max_plaintext)
+            plaintext = plaintext.substr(0, max_plaintext);
+
+        //Build the whole record first (header for a brand new file included)
+        std::vector<char> record;
+        record.reserve(sizeof(magic) + record_header + plaintext.size());
+
+        //Held until the function returns or throws (refresh() and remap() can throw while it is held); a wait interrupted by a signal
+        //(SIGINT/SIGTERM only ask for a checkpoint) is resumed, any other failure means the file cannot be locked
+        struct Lock
+        {
+            int fd;
+
+            Lock(int in_fd, const std::string& filename) : fd(in_fd)
+            {
+                while (::flock(fd, LOCK_EX) != 0)
+                    if (errno != EINTR)
+                        throw std::runtime_error("cannot lock potfile \"" + filename + "\": " + std::strerror(errno));
+            }
+
+            ~Lock() { ::flock(fd, LOCK_UN); }
+        } lock(fd, filename);
+
+        refresh();
+
+        //Drop a torn record left by a writer that crashed (nobody else can be writing: we hold the lock)
+        if (valid_end != mapped and mapped >= sizeof(magic))
+        {
+            if (::ftruncate(fd, static_cast<off_t>(valid_end)) == 0)
+                remap(valid_end);
+        }
+
+        if (mapped < sizeof(magic))
+        {
+            if (mapped != 0 and ::ftruncate(fd, 0) != 0)
+                throw std::runtime_error("cannot repair potfile \"" + filename + "\": " + std::strerror(errno));
+
+            record.insert(record.end(), magic, magic + sizeof(magic));
+        }
+
+        record.insert(record.end(), d.begin(), d.end());
+        record.push_back(static_cast<char>(plaintext.size() & 0xff));
+        record.push_back(static_cast<char>(plaintext.size() >> 8));
+        record.insert(record.end(), plaintext.begin(), plaintext.end());
+
+        ssize_t written = ::write(fd, record.data(), record.size());
+        ::fdatasync(fd);
+
+        if (written != static_cast<ssize_t>(record.size()))
+            throw std::runtime_error("cannot write to potfile \"" + filename + "\": " + std::strerror(errno));
+    }
+
+    //Iterate over every (digest, plaintext) pair in the potfile
+    template <typename Function>
+    void Potfile::for_each(Function&& function) const
+    {
+        for(const auto& [d, offset] : index)
+        {
+            if (auto plaintext = find(d))
+                function(d, *plaintext);
+        }
+    }
+}
@@ -0,0 +1,522 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Table file name, charsets
+#include <vector>               //Charsets of the positions, chains being generated
+#include <optional>            //A lookup may miss
+#include <atomic>             //Next block of chains, per-thread progress
+#include <algorithm>         //std::sort, std::unique, std::lower_bound
+#include <fstream>          //Writing a table
+#include <stdexcept>       //std::runtime_error
+#include <chrono>         //Progress refresh interval
+#include <thread>        //std::this_thread::sleep_for
+#include <cstdint>      //Keyspace indices, chain numbers
+#include <cstdio>      //std::rename() for atomically replacing a table
+#include <cstring>    //std::memcmp, std::strerror
+#include <cerrno>    //errno
+
+//Native POSIX Libraries
+#include <fcntl.h>       //open()
+#include <unistd.h>     //close()
+#include <sys/mman.h>  //mmap(), munmap(), madvise()
+#include <sys/stat.h> //fstat()
+
+//Custom Libraries
+#include "../cracker/md5_lanes.hpp"
+#include "../cracker/pool.hpp"
+#include "../cracker/progress.hpp"
+#include "../permuter/mask.hpp"
+
+namespace rainbow
+{
+    //File layout:  "MD5RBOW1" header, uint32 chain length, uint32 table number, uint64 stride, uint64 chain count, uint32 shortest
+    //candidate, uint32 position count, the charset of every position as [uint32 length][bytes], zero padding to a multiple of 8 bytes,
+    //then the end point of every chain (uint64, ascending) and the number of every chain (uint32, same order). Integers are little
+    //endian. Start points are not stored: chain c starts at keyspace index c * stride.
+    constexpr char magic[8] = {'M', 'D', '5', 'R', 'B', 'O', 'W', '1'};
+    constexpr std::uint64_t max_chains = UINT32_MAX;
+
+    //Class 'Chains' is the arithmetic of one rainbow table: a keyspace (a mask over a range of lengths, in plain index order), the start
+    //point of every chain and the reduction function of every column. A chain is a sequence of 'length' keyspace indices; the index in
+    //column c + 1 is the MD5 of the candidate in column c, reduced with the function of column c. The reduction functions depend on the
+    //table number, so tables with different numbers cover different parts of the keyspace.
+    class Chains final
+    {
+        private:
+            std::vector<std::string> positions;      //Charset of every position (longest candidate)
+            std::size_t min_len;                    //Shortest candidate
+            Permute::Mask mask;                    //The keyspace
+            std::uint32_t length;                 //Indices per chain (the last one is the end point)
+            std::uint32_t table;                 //Table number
+            std::uint64_t salt;                 //Derived from the table number
+            std::uint64_t stride;              //Distance between the start points of consecutive chains
+
+        public:
+            //Special methods
+            Chains(std::vector<std::string>, std::size_t, std::uint32_t, std::uint32_t, std::uint64_t);
+            Chains(const Permute::Mask&, std::uint32_t, std::uint32_t, std::uint64_t);
+
+            //General methods
+            [[nodiscard]] std::uint64_t size() const noexcept;
+            [[nodiscard]] std::uint32_t chain_length() const noexcept;
+            [[nodiscard]] std::uint32_t table_number() const noexcept;
+            [[nodiscard]] std::uint64_t start_stride() const noexcept;
+            [[nodiscard]] const std::vector<std::string>& charsets() const noexcept;
+            [[nodiscard]] std::size_t shortest() const noexcept;
+
+            [[nodiscard]] std::uint64_t start(std::uint64_t) const noexcept;
+            [[nodiscard]] std::uint64_t reduce(std::uint32_t, std::uint32_t, std::uint32_t) const noexcept;
+            std::size_t candidate(std::uint64_t, char*) const;
+            [[nodiscard]] cracker::digest hash(std::uint64_t) const;
+            [[nodiscard]] std::uint64_t walk(std::uint64_t, std::uint32_t, std::uint32_t) const;
+
+            template <std::size_t Lanes>
+            void step(const std::uint64_t*, const std::uint32_t*, std::uint64_t*) const;
+    };
+
+    //Class 'Table' maps a rainbow table file read-only, so any number of threads can search its end points without I/O calls
+    class Table final
+    {
+        private:
+            const unsigned char* map = nullptr;       //The file
+            std::uint64_t bytes = 0;                 //Size of the file
+            int fd = -1;                            //Descriptor of the file
+            std::optional<Chains> arithmetic;      //Keyspace and reductions from the header
+            std::uint64_t count = 0;              //Number of chains
+            const unsigned char* ends = nullptr; //End points (ascending)
+            const unsigned char* numbers = nullptr;  //Chain numbers
+
+        public:
+            //Special methods
+            explicit Table(const std::string&);
+            ~Table();
+            Table(const Table&) = delete;
+            Table& operator=(const Table&) = delete;
+
+            //General methods
+            [[nodiscard]] const Chains& chains() const noexcept;
+            [[nodiscard]] std::uint64_t size() const noexcept;
+            [[nodiscard]] std::optional<std::uint64_t> find(std::uint64_t) const noexcept;
+    };
+
+    std::uint64_t generate(const std::string&, const Chains&, std::uint64_t, cracker::ThreadPool&, bool = false);
+
+
+    // ***** HELPERS ***** //
+
+    namespace detail
+    {
+        //Read a little-endian integer of 'width' bytes
+        inline std::uint64_t load(const unsigned char* bytes, unsigned width) noexcept
+        {
+            std::uint64_t value = 0;
+
+            for(unsigned i=0; i < width; ++i)
+                value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+
+            return value;
+        }
+
+        //Write a little-endian integer of 'width' bytes
+        inline void store(std::ostream& out, std::uint64_t value, unsigned width)
+        {
+            for(unsigned i=0; i < width; ++i)
+                out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+
+        //SplitMix64 finalizer: spreads the table number over all 64 bits
+        inline std::uint64_t mix(std::uint64_t x) noexcept
+        {
+            x += 0x9e3779b97f4a7c15ull;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+    }
+
+
+    // ***** CHAINS ***** //
+
+    //Constructor: the positions of the longest candidate, the shortest length, the chain length, the table number and the distance between
+    //two start points -- CAN THROW std::invalid_argument (bad lengths, candidates longer than one MD5 block) and std::overflow_error
+    inline Chains::Chains(std::vector<std::string> in_positions, std::size_t in_min_len, std::uint32_t in_length, std::uint32_t in_table,
+                          std::uint64_t in_stride)
+        : positions(std::move(in_positions)), min_len(in_min_len), mask(positions, min_len, positions.size()), length(in_length),
+          table(in_table), salt(detail::mix(in_table)), stride(std::max<std::uint64_t>(in_stride, 1))
+    {
+        if (positions.size() > cracker::max_block_message)
+            throw std::invalid_argument("rainbow table candidates are limited to " + std::to_string(cracker::max_block_message) + " characters");
+
+        if (length < 2)
+            throw std::invalid_argument("a chain needs at least 2 links");
+    }
+
+    //Constructor: the keyspace of a mask (its Markov order, if any, is not kept: tables always use plain index order)
+    inline Chains::Chains(const Permute::Mask& keyspace, std::uint32_t in_length, std::uint32_t in_table, std::uint64_t in_stride)
+        : Chains([&keyspace]()
+                 {
+                     const Permute::Keyspace& longest = keyspace.keyspace(keyspace.lengths() - 1);
+                     std::vector<std::string> charsets;
+
+                     for(std::size_t i=0; i < longest.length(); ++i)
+                         charsets.push_back(longest.charset(i));
+
+                     return charsets;
+                 }(), keyspace.keyspace(0).length(), in_length, in_table, in_stride)
+    {
+    }
+
+    //Return the number of candidates of the keyspace
+    [[nodiscard]] inline std::uint64_t Chains::size() const noexcept
+    {
+        return mask.size();
+    }
+
+    //Return the number of indices per chain
+    [[nodiscard]] inline std::uint32_t Chains::chain_length() const noexcept
+    {
+        return length;
+    }
+
+    //Return the table number
+    [[nodiscard]] inline std::uint32_t Chains::table_number() const noexcept
+    {
+        return table;
+    }
+
+    //Return the distance between the start points of consecutive chains
+    [[nodiscard]] inline std::uint64_t Chains::start_stride() const noexcept
+    {
+        return stride;
+    }
+
+    //Return the charset of every position of the longest candidate
+    [[nodiscard]] inline const std::vector<std::string>& Chains::charsets() const noexcept
+    {
+        return positions;
+    }
+
+    //Return the length of the shortest candidate
+    [[nodiscard]] inline std::size_t Chains::shortest() const noexcept
+    {
+        return min_len;
+    }
+
+    //Return the start point of a chain
+    [[nodiscard]] inline std::uint64_t Chains::start(std::uint64_t chain) const noexcept
+    {
+        return (chain * stride) % mask.size();
+    }
+
+    //Reduce a digest (its first two state words) to a keyspace index with the function of a column
+    [[nodiscard]] inline std::uint64_t Chains::reduce(std::uint32_t a, std::uint32_t b, std::uint32_t column) const noexcept
+    {
+        return (((static_cast<std::uint64_t>(b) << 32 | a) ^ salt) + column) % mask.size();
+    }
+
+    //Write the candidate with the given index into 'out' (at least charsets().size() bytes) and return its length
+    inline std::size_t Chains::candidate(std::uint64_t index, char* out) const
+    {
+        auto [i, local] = mask.locate(index);
+        const Permute::Keyspace& keyspace = mask.keyspace(i);
+
+        keyspace.at(local, out);
+        return keyspace.length();
+    }
+
+    //Return the MD5 of the candidate with the given index
+    [[nodiscard]] inline cracker::digest Chains::hash(std::uint64_t index) const
+    {
+        char buffer[cracker::max_block_message];
+        return cracker::md5_short(buffer, candidate(index, buffer));
+    }
+
+    //Follow a chain from the index in column 'from' to the index in column 'to' (one candidate at a time)
+    [[nodiscard]] inline std::uint64_t Chains::walk(std::uint64_t index, std::uint32_t from, std::uint32_t to) const
+    {
+        char buffer[cracker::max_block_message];
+        std::uint32_t w[16], out[4];
+
+        for(std::uint32_t column = from; column < to; ++column)
+        {
+            cracker::pad_block(buffer, candidate(index, buffer), w);
+            cracker::md5_compress(w, out);
+            index = reduce(out[0], out[1], column);
+        }
+
+        return index;
+    }
+
+    //Advance 'Lanes' chains by one link at once: out[i] is the index after in[i], which is in column columns[i]
+    template <std::size_t Lanes>
+    inline void Chains::step(const std::uint64_t* in, const std::uint32_t* columns, std::uint64_t* out) const
+    {
+        cracker::SoaBlock<Lanes> block;
+        cracker::vec<Lanes> state[4];
+        char buffer[cracker::max_block_message];
+        std::uint32_t w[16];
+
+        for(std::size_t lane=0; lane < Lanes; ++lane)
+        {
+            cracker::pad_block(buffer, candidate(in[lane], buffer), w);
+
+            for(std::size_t i=0; i < 16; ++i)
+                block.w[i][lane] = w[i];
+        }
+
+        cracker::md5_compress(block.w, state);
+
+        for(std::size_t lane=0; lane < Lanes; ++lane)
+            out[lane] = reduce(state[0][lane], state[1][lane], columns[lane]);
+    }
+
+
+    // ***** TABLE ***** //
+
+    //Constructor: map a table file and read its header -- CAN THROW std::runtime_error
+    inline Table::Table(const std::string& filename)
+    {
+        struct stat info;
+
+        fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            throw std::runtime_error("the rainbow table \"" + filename + "\" could not be found");
+
+        if (::fstat(fd, &info) != 0 or info.st_size < static_cast<off_t>(sizeof(magic)))
+        {
+            ::close(fd);
+            throw std::runtime_error("\"" + filename + "\" is not a rainbow table");
+        }
+
+        bytes = static_cast<std::uint64_t>(info.st_size);
+        void* region = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (region == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot map \"" + filename + "\": " + std::strerror(errno));
+        }
+
+        ::madvise(region, bytes, MADV_RANDOM);
+        map = static_cast<const unsigned char*>(region);
+
+        //Header: every field is checked against the size of the file before it is read
+        std::uint64_t offset = sizeof(magic);
+        bool valid = (std::memcmp(map, magic, sizeof(magic)) == 0);
+
+        auto field = [&](unsigned width)
+                     {
+                         valid = valid and offset + width <= bytes;
+                         std::uint64_t value = (valid ? detail::load(map + offset, width) : 0);
+                         offset += width;
+                         return value;
+                     };
+
+        std::uint32_t chain_length = static_cast<std::uint32_t>(field(4));
+        std::uint32_t table_number = static_cast<std::uint32_t>(field(4));
+        std::uint64_t stride = field(8);
+        count = field(8);
+        std::size_t min_len = field(4);
+        std::vector<std::string> positions(valid ? std::min<std::uint64_t>(field(4), cracker::max_block_message + 1) : 0);
+
+        for(std::string& charset : positions)
+        {
+            std::uint64_t size = field(4);
+            valid = valid and offset + size <= bytes;
+
+            if (valid)
+                charset.assign(reinterpret_cast<const char*>(map + offset), size);
+
+            offset += size;
+        }
+
+        offset = (offset + 7) / 8 * 8;
+        valid = valid and count <= max_chains and offset + count * 12 == bytes;
+
+        try
+        {
+            if (valid)
+                arithmetic.emplace(std::move(positions), min_len, chain_length, table_number, stride);
+        }
+        catch (const std::exception&)   //std::invalid_argument, std::overflow_error
+        {
+            valid = false;
+        }
+
+        if (not valid)
+        {
+            ::munmap(const_cast<unsigned char*>(map), bytes);
+            ::close(fd);
+            throw std::runtime_error("\"" + filename + "\" is not a rainbow table (or it is truncated)");
+        }
+
+        ends = map + offset;
+        numbers = ends + count * 8;
+    }
+
+    //Destructor
+    inline Table::~Table()
+    {
+        ::munmap(const_cast<unsigned char*>(map), bytes);
+        ::close(fd);
+    }
+
+    //Return the keyspace and reductions of the table
+    [[nodiscard]] inline const Chains& Table::chains() const noexcept
+    {
+        return *arithmetic;
+    }
+
+    //Return the number of chains
+    [[nodiscard]] inline std::uint64_t Table::size() const noexcept
+    {
+        return count;
+    }
+
+    //Return the start point of the chain that ends at 'end' (end points are unique within a table), binary searching the mapping
+    [[nodiscard]] inline std::optional<std::uint64_t> Table::find(std::uint64_t end) const noexcept
+    {
+        std::uint64_t low = 0, high = count;
+
+        while (low < high)
+        {
+            std::uint64_t middle = low + (high - low) / 2;
+
+            if (detail::load(ends + middle * 8, 8) < end)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        if (low == count or detail::load(ends + low * 8, 8) != end)
+            return std::nullopt;
+
+        return arithmetic->start(detail::load(numbers + low * 4, 4));
+    }
+
+
+    // ***** GENERATION ***** //
+
+    //Generate 'count' chains on every thread of 'pool' (hashing 'simd_lanes' chains in lockstep), sort them by end point, drop the chains
+    //that merged into another one (same end point) and write the table to 'filename' -- CAN THROW std::runtime_error (file) and
+    //std::invalid_argument (more chains than the format or the keyspace allows). Returns the number of chains written.
+    inline std::uint64_t generate(const std::string& filename, const Chains& chains, std::uint64_t count, cracker::ThreadPool& pool, bool progress_line)
+    {
+        constexpr std::size_t lanes = cracker::simd_lanes;
+
+        struct Entry
+        {
+            std::uint64_t end;
+            std::uint32_t chain;
+        };
+
+        if (count == 0 or count > max_chains or count > chains.size())
+            throw std::invalid_argument("a table holds 1 to " + std::to_string(std::min(max_chains, chains.size())) + " chains");
+
+        //Written next to the table and renamed over it, so an interrupted run never leaves a truncated table behind (opened first, so an
+        //unwritable path fails before the chains are generated)
+        const std::string temporary = filename + ".tmp";
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+
+        if (not out.good())
+            throw std::runtime_error("cannot write \"" + temporary + "\": " + std::strerror(errno));
+
+        std::vector<Entry> entries(count);
+        std::atomic<std::uint64_t> next_block(0);
+        std::vector<std::atomic<std::uint64_t>> links(pool.size());         //Links hashed by each thread (for the progress line)
+        const std::uint32_t last = chains.chain_length() - 1;              //Column of the end point
+
+        //Worker: take 'lanes' chains at a time and walk them side by side to their end points
+        pool.start([&](std::size_t id)
+                   {
+                       std::uint64_t index[lanes], next[lanes];
+                       std::uint32_t columns[lanes];
+
+                       for(std::uint64_t first; (first = next_block.fetch_add(lanes)) < count;)
+                       {
+                           for(std::size_t lane=0; lane < lanes; ++lane)
+                               index[lane] = chains.start(std::min(first + lane, count - 1));   //Lanes past the end repeat the last chain
+
+                           for(std::uint32_t column=0; column < last; ++column)
+                           {
+                               std::fill_n(columns, lanes, column);
+                               chains.step<lanes>(index, columns, next);
+                               std::copy_n(next, lanes, index);
+                           }
+
+                           for(std::size_t lane=0; lane < lanes and first + lane < count; ++lane)
+                               entries[first + lane] = {index[lane], static_cast<std::uint32_t>(first + lane)};
+
+                           links[id].fetch_add(std::min<std::uint64_t>(lanes, count - first) * last, std::memory_order_relaxed);
+                       }
+                   });
+
+        //Monitor (this thread): the progress line while the workers run
+        std::optional<cracker::Progress> progress;
+
+        auto done = [&]()
+                    {
+                        std::uint64_t sum = 0;
+                        for(const auto& hashed : links)
+                            sum += hashed.load(std::memory_order_relaxed);
+                        return sum;
+                    };
+
+        if (progress_line)
+            progress.emplace(count * last);
+
+        while (pool.running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            if (progress)
+                progress->refresh(done());
+        }
+
+        pool.wait();
+
+        if (progress)
+            progress->finish(done());
+
+        //Sort by end point; of the chains that merged, the one with the lowest number is kept
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.end < b.end or (a.end == b.end and a.chain < b.chain); });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.end == b.end; }), entries.end());
+
+        out.write(magic, sizeof(magic));
+        detail::store(out, chains.chain_length(), 4);
+        detail::store(out, chains.table_number(), 4);
+        detail::store(out, chains.start_stride(), 8);
+        detail::store(out, entries.size(), 8);
+        detail::store(out, chains.shortest(), 4);
+        detail::store(out, chains.charsets().size(), 4);
+
+        std::uint64_t header = sizeof(magic) + 4 + 4 + 8 + 8 + 4 + 4;
+
+        for(const std::string& charset : chains.charsets())
+        {
+            detail::store(out, charset.size(), 4);
+            out.write(charset.data(), static_cast<std::streamsize>(charset.size()));
+            header += 4 + charset.size();
+        }
+
+        for(; header % 8 != 0; ++header)
+            out.put('\0');
+
+        for(const Entry& entry : entries)
+            detail::store(out, entry.end, 8);
+
+        for(const Entry& entry : entries)
+            detail::store(out, entry.chain, 4);
+
+        out.close();
+
+        if (not out or std::rename(temporary.c_str(), filename.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("cannot write \"" + filename + "\": " + std::strerror(errno));
+        }
+
+        return entries.size();
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Socket path, arguments
+#include <string_view>          //Hash lists
+#include <vector>              //Arguments of a job
+#include <stdexcept>          //std::runtime_error
+#include <cstring>           //std::strerror
+#include <cerrno>           //errno
+
+//Native POSIX Libraries
+#include <unistd.h>       //close()
+#include <sys/socket.h>  //socket(), connect()
+#include <sys/un.h>     //sockaddr_un
+
+//Custom Libraries
+#include "protocol.hpp"
+
+namespace remote
+{
+    //Class 'Client' is a connection to a '--daemon': it submits jobs (or status/shutdown requests) and reads the replies as they come
+    class Client final
+    {
+        private:
+            int fd = -1;
+
+        public:
+            //Special methods
+            explicit Client(const std::string&);
+            ~Client();
+            Client(const Client&) = delete;
+            Client& operator=(const Client&) = delete;
+
+            //General methods
+            bool submit(const std::vector<std::string>&, std::string_view);
+            bool request(Frame);
+            bool next(Frame&, std::string&);
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: connect to the daemon listening on 'socket_path' (CAN THROW std::runtime_error)
+    inline Client::Client(const std::string& socket_path)
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+
+        if (socket_path.empty() or socket_path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("the socket path \"" + socket_path + "\" is empty or too long");
+
+        socket_path.copy(address.sun_path, socket_path.size());
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (fd < 0 or ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::string reason = std::strerror(errno);
+
+            if (fd >= 0)
+                ::close(fd);
+
+            throw std::runtime_error("cannot connect to the daemon at \"" + socket_path + "\": " + reason);
+        }
+    }
+
+    //Destructor: hang up (a job that is still running is stopped by the daemon)
+    inline Client::~Client()
+    {
+        ::close(fd);
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Submit a job: its command line options (e.g. {"--mask", "?l?l?l?l"}) and the hash list -- returns false if the daemon is gone
+    inline bool Client::submit(const std::vector<std::string>& args, std::string_view hashes)
+    {
+        Payload payload;
+        payload.put(args.size(), 4);
+
+        for(const std::string& arg : args)
+            payload.put(arg);
+
+        return send_frame(fd, Frame::submit, payload.put(hashes).data());
+    }
+
+    //Send a request without a payload (Frame::status, Frame::shutdown)
+    inline bool Client::request(Frame type)
+    {
+        return send_frame(fd, type, {});
+    }
+
+    //Read the next reply (blocks) -- returns false once the daemon hung up
+    inline bool Client::next(Frame& type, std::string& payload)
+    {
+        return read_frame(fd, type, payload);
+    }
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Frame payloads
+#include <string_view>          //Decoding payloads in place
+#include <cstdint>             //Fixed width frame fields
+#include <cerrno>             //errno (EINTR)
+
+//Native POSIX Libraries
+#include <sys/socket.h>    //send(), recv()
+
+namespace remote
+{
+    //Frame layout:  [uint8 type][uint32 payload length (little endian)][payload]. Payload fields are fixed width little endian integers
+    //and strings written as [uint32 length][bytes], so passwords may contain any byte.
+    constexpr std::size_t frame_header = 1 + 4;
+    constexpr std::uint32_t max_payload = 1u << 30;     //Hash lists of a single job stay below 1 GiB
+
+    //Frame types: requests (client -> daemon) and replies (daemon -> client)
+    enum class Frame : std::uint8_t
+    {
+        submit = 1,          //u32 argument count, arguments, hash list
+        status = 2,         //(empty)
+        shutdown = 3,      //(empty)
+
+        accepted = 16,     //u64 job id, u64 jobs ahead of it in the queue
+        crack = 17,       //hash, password
+        done = 18,       //u8 finished, u64 cracked, u64 targets, u64 candidates tested
+        error = 19,     //u32 exit status, message
+        report = 20    //Status of the daemon as 'key value' lines
+    };
+
+    //Class 'Payload' builds the payload of a frame field by field
+    class Payload final
+    {
+        private:
+            std::string bytes;
+
+        public:
+            //General methods
+            Payload& put(std::uint64_t, unsigned = 8);
+            Payload& put(std::string_view);
+            [[nodiscard]] const std::string& data() const noexcept;
+    };
+
+    //Class 'Reader' decodes the fields of a payload in order; a field that runs past the end makes ok() false
+    class Reader final
+    {
+        private:
+            std::string_view rest;
+            bool valid = true;
+
+        public:
+            //Special methods
+            explicit Reader(std::string_view);
+
+            //General methods
+            std::uint64_t number(unsigned = 8);
+            std::string text();
+            [[nodiscard]] bool ok() const noexcept;
+    };
+
+    bool send_frame(int, Frame, std::string_view);
+    bool read_frame(int, Frame&, std::string&);
+
+
+    // ***** PAYLOAD ***** //
+
+    //Append an integer of 'width' bytes (little endian)
+    inline Payload& Payload::put(std::uint64_t value, unsigned width)
+    {
+        for(unsigned i=0; i < width; ++i)
+            bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+
+        return *this;
+    }
+
+    //Append a string (length first)
+    inline Payload& Payload::put(std::string_view text)
+    {
+        put(text.size(), 4);
+        bytes.append(text);
+        return *this;
+    }
+
+    //Return the encoded payload
+    [[nodiscard]] inline const std::string& Payload::data() const noexcept
+    {
+        return bytes;
+    }
+
+
+    // ***** READER ***** //
+
+    //Constructor: decode 'payload' (which must outlive the reader)
+    inline Reader::Reader(std::string_view payload) : rest(payload)
+    {
+    }
+
+    //Decode an integer of 'width' bytes (little endian)
+    inline std::uint64_t Reader::number(unsigned width)
+    {
+        std::uint64_t value = 0;
+
+        if (rest.size() < width)
+        {
+            valid = false;
+            rest = {};
+            return 0;
+        }
+
+        for(unsigned i=0; i < width; ++i)
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(rest[i])) << (8 * i);
+
+        rest.remove_prefix(width);
+        return value;
+    }
+
+    //Decode a string
+    inline std::string Reader::text()
+    {
+        std::uint64_t length = number(4);
+
+        if (rest.size() < length)
+        {
+            valid = false;
+            rest = {};
+            return {};
+        }
+
+        std::string value(rest.substr(0, length));
+        rest.remove_prefix(length);
+        return value;
+    }
+
+    //Return whether every field decoded so far was complete
+    [[nodiscard]] inline bool Reader::ok() const noexcept
+    {
+        return valid;
+    }
+
+
+    // ***** FRAMES ***** //
+
+    //Write a whole frame to a socket -- returns false if the peer is gone (never raises SIGPIPE)
+    inline bool send_frame(int fd, Frame type, std::string_view payload)
+    {
+        if (payload.size() > max_payload)
+            return false;
+
+        std::string frame;
+        frame.reserve(frame_header + payload.size());
+        frame.push_back(static_cast<char>(type));
+        frame.append(Payload().put(payload.size(), 4).data());
+        frame.append(payload);
+
+        for(std::size_t sent = 0; sent < frame.size();)
+        {
+            ssize_t count = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+
+            if (count < 0 and errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+
+            sent += static_cast<std::size_t>(count);
+        }
+
+        return true;
+    }
+
+    //Read a whole frame from a socket (blocks) -- returns false at the end of the stream, on errors and on oversized frames
+    inline bool read_frame(int fd, Frame& type, std::string& payload)
+    {
+        auto read_all = [fd](char* buffer, std::size_t size)
+                        {
+                            for(std::size_t got = 0; got < size;)
+                            {
+                                ssize_t count = ::recv(fd, buffer + got, size - got, 0);
+
+                                if (count < 0 and errno == EINTR)
+                                    continue;
+                                if (count <= 0)
+                                    return false;
+
+                                got += static_cast<std::size_t>(count);
+                            }
+
+                            return true;
+                        };
+
+        char header[frame_header];
+
+        if (not read_all(header, sizeof(header)))
+            return false;
+
+        Reader length(std::string_view(header + 1, 4));
+        std::uint64_t size = length.number(4);
+
+        if (size > max_payload)
+            return false;
+
+        type = static_cast<Frame>(header[0]);
+        payload.resize(size);
+
+        return read_all(payload.data(), size);
+    }
+}
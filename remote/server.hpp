@@ -0,0 +1,632 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Socket path, requests
+#include <vector>               //Arguments of a request
+#include <list>                //Connections (threads are joined as they finish)
+#include <deque>              //Job queue
+#include <unordered_map>     //Owners of the hashes of a batch
+#include <optional>         //Work a job of a batch still has to see
+#include <memory>            //Connections are shared by their thread and their queued jobs
+#include <functional>       //Job factory
+#include <thread>          //Acceptor and connection threads
+#include <mutex>          //Guards the queue and the outgoing frames
+#include <condition_variable>   //Waking the runner
+#include <atomic>              //Connection and server state
+#include <chrono>             //Poll intervals
+#include <sstream>           //Hash lists of requests
+#include <iostream>         //Job log (std::clog)
+#include <cstring>         //std::strerror
+#include <cerrno>         //errno
+#include <algorithm>     //std::find_if, std::sort, std::unique
+#include <iterator>     //std::make_move_iterator
+
+//Native POSIX Libraries
+#include <unistd.h>       //close(), unlink()
+#include <poll.h>        //poll()
+#include <sys/socket.h> //socket(), bind(), listen(), accept(), shutdown()
+#include <sys/un.h>    //sockaddr_un
+#include <sys/stat.h> //chmod(), stat()
+
+//Custom Libraries
+#include "protocol.hpp"
+#include "../cracker/session.hpp"
+#include "../checkpoint/checkpoint.hpp"
+
+namespace remote
+{
+    //Turns the arguments of a request (command line options, e.g. {"--dict", "/srv/words.txt", "--rules", "best.rule"}) into a job,
+    //throwing cracker::SessionError if they are invalid. The potfile of the daemon is passed for '--markov-pot'/'--pcfg-pot'.
+    typedef std::function<cracker::Job(const std::vector<std::string>&, const potfile::Potfile*)> JobFactory;
+
+    //A client of the daemon. Replies come from its own thread, from the runner and from the workers' crack callback (under the session's
+    //crack lock), so send() only queues the frame: a writer thread of the connection does the socket I/O. A client that stops reading
+    //while it stays connected is dropped once 'max_outbox' bytes are waiting, instead of stalling the cracking loops.
+    struct Connection
+    {
+        static constexpr std::size_t max_outbox = std::size_t(64) << 20;
+
+        int fd;
+        std::mutex write_lock;                                    //Guards 'outbox', 'queued' and 'closing'
+        std::condition_variable ready;                           //A frame was queued or the connection is closing
+        std::deque<std::pair<Frame, std::string>> outbox;       //Frames the writer has not sent yet
+        std::size_t queued = 0;                                //Payload bytes in 'outbox'
+        bool closing = false;                                 //Set by the destructor: send what is queued, then stop
+        std::atomic<bool> open = true;                       //False once the client hung up (or was dropped)
+        std::atomic<bool> finished = false;                 //Its thread returned (and can be joined)
+        std::thread writer;
+
+        explicit Connection(int in_fd) : fd(in_fd), writer([this]() { drain(); }) {}
+
+        ~Connection()
+        {
+            {
+                std::lock_guard<std::mutex> guard(write_lock);
+                closing = true;
+            }
+
+            ready.notify_all();
+            writer.join();
+            ::close(fd);
+        }
+
+        //Queue a frame -- returns false if the client is gone
+        bool send(Frame type, std::string_view payload)
+        {
+            {
+                std::lock_guard<std::mutex> guard(write_lock);
+
+                if (not open)
+                    return false;
+
+                if (queued + payload.size() > max_outbox)
+                {
+                    //Too slow: hang up on it (its connection thread then sees the end of the stream and stops its job)
+                    open = false;
+                    outbox.clear();
+                    queued = 0;
+                    ::shutdown(fd, SHUT_RDWR);
+                    return false;
+                }
+
+                outbox.emplace_back(type, std::string(payload));
+                queued += payload.size();
+            }
+
+            ready.notify_all();
+            return true;
+        }
+
+        //Writer thread: send the queued frames in order until the connection closes (a failed send drops the rest)
+        void drain()
+        {
+            std::unique_lock<std::mutex> guard(write_lock);
+
+            while (true)
+            {
+                ready.wait(guard, [this]() { return closing or not outbox.empty(); });
+
+                if (outbox.empty())
+                    return;
+
+                std::pair<Frame, std::string> frame = std::move(outbox.front());
+                outbox.pop_front();
+                queued -= frame.second.size();
+
+                guard.unlock();
+                bool sent = send_frame(fd, frame.first, frame.second);
+                guard.lock();
+
+                if (not sent)
+                {
+                    open = false;
+                    outbox.clear();
+                    queued = 0;
+                }
+            }
+        }
+    };
+
+    //A submitted job waiting for the runner
+    struct Request
+    {
+        std::uint64_t id;
+        std::shared_ptr<Connection> client;
+        std::vector<std::string> args;
+        std::string hashes;
+    };
+
+    //A job of the running batch: its hashes and the part of the attack it has not seen yet
+    struct Member
+    {
+        Request request;
+        std::vector<std::string> keys;                            //Its hashes (keys of the session's result table)
+        std::optional<std::vector<cracker::Range>> owed;         //Ranges of the attack it still needs (nullopt: all of it)
+        std::uint64_t tested = 0;                               //Candidates tested while it was in the batch
+        bool done = false;                                     //Its done frame was sent
+    };
+
+    //Class 'Server' is the '--daemon': one cracker::Session (potfile, worker pool and mapped dictionaries stay warm between jobs) serving
+    //the jobs that clients submit over a Unix domain socket in the order they arrived. Jobs with identical options run as one batch: their
+    //hashes share one target table, every candidate is hashed once, and each crack is streamed back to every job that owns the hash as
+    //soon as it happens. A client that hangs up stops its job. Only the owner of the daemon can connect (the socket is created with mode
+    //0600).
+    class Server final
+    {
+        private:
+            std::string path;                                  //Socket path
+            int listener = -1;
+            cracker::Session session;
+            JobFactory factory;
+
+            std::mutex lock;                                 //Guards everything below
+            std::condition_variable wake;                   //A job was queued or the daemon is shutting down
+            std::deque<Request> queue;
+            std::deque<Request> joining;                  //Jobs that join the running batch after its current pass
+            std::vector<std::string> running_args;       //Options of the running batch
+            std::vector<std::pair<std::uint64_t, std::shared_ptr<Connection>>> running;   //Its jobs (empty if idle)
+            std::uint64_t next_id = 1;
+            std::uint64_t served = 0;                   //Jobs finished or stopped
+            std::atomic<bool> closing = false;         //'--shutdown' request, SIGINT or SIGTERM
+
+            std::list<std::pair<std::thread, std::shared_ptr<Connection>>> clients;   //Only touched by the acceptor (and after it stopped)
+
+            void accept_clients();
+            void serve_client(std::shared_ptr<Connection>);
+            void run_batch(std::vector<Request>&);
+            [[nodiscard]] std::string report();
+            [[nodiscard]] bool stopping() const;
+
+        public:
+            //Special methods
+            Server(std::string, cracker::SessionOptions, JobFactory);
+            ~Server();
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            //General methods
+            void serve();
+    };
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: open the session and listen on 'socket_path' (CAN THROW cracker::SessionError). A socket file left behind by a daemon
+    //that died is replaced; one that still answers is not.
+    inline Server::Server(std::string socket_path, cracker::SessionOptions options, JobFactory job_factory)
+        : path(std::move(socket_path)), session(std::move(options)), factory(std::move(job_factory))
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+
+        if (path.empty() or path.size() >= sizeof(address.sun_path))
+            throw cracker::SessionError("the socket path \"" + path + "\" is empty or too long", 1);
+
+        path.copy(address.sun_path, path.size());
+
+        //Stale socket: nobody accepts connections on it any more (anything that is not a socket is left alone: bind() fails on it)
+        struct stat info;
+        int probe = (::stat(path.c_str(), &info) == 0 and S_ISSOCK(info.st_mode) ? ::socket(AF_UNIX, SOCK_STREAM, 0) : -1);
+
+        if (probe >= 0)
+        {
+            bool alive = (::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+            ::close(probe);
+
+            if (alive)
+                throw cracker::SessionError("a daemon is already listening on \"" + path + "\"", 1);
+
+            ::unlink(path.c_str());
+        }
+
+        listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listener < 0 or ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 or
+            ::chmod(path.c_str(), 0600) != 0 or ::listen(listener, 64) != 0)
+        {
+            std::string reason = std::strerror(errno);
+
+            if (listener >= 0)
+                ::close(listener);
+
+            throw cracker::SessionError("cannot listen on \"" + path + "\": " + reason, 2);
+        }
+    }
+
+    //Destructor: stop listening and remove the socket file
+    inline Server::~Server()
+    {
+        ::close(listener);
+        ::unlink(path.c_str());
+    }
+
+
+    // ***** PRIVATE METHODS ***** //
+
+    //Return whether the daemon is shutting down
+    [[nodiscard]] inline bool Server::stopping() const
+    {
+        return closing.load() or checkpoint::interrupted();
+    }
+
+    //Acceptor thread: take new connections (one thread each) and join the threads of the clients that left
+    inline void Server::accept_clients()
+    {
+        pollfd listening = {listener, POLLIN, 0};
+
+        while (not stopping())
+        {
+            for(auto itr = clients.begin(); itr != clients.end();)
+            {
+                if (itr->second->finished)
+                {
+                    itr->first.join();
+                    itr = clients.erase(itr);
+                }
+                else
+                    ++itr;
+            }
+
+            if (::poll(&listening, 1, 200) <= 0)
+                continue;
+
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+
+            auto client = std::make_shared<Connection>(fd);
+            clients.emplace_back(std::thread([this, client]() { serve_client(client); }), client);
+        }
+
+        //Wake the runner in case a signal ended the daemon while it was idle
+        closing = true;
+        wake.notify_all();
+    }
+
+    //Connection thread: read the requests of one client until it hangs up
+    inline void Server::serve_client(std::shared_ptr<Connection> client)
+    {
+        Frame type;
+        std::string payload;
+
+        while (read_frame(client->fd, type, payload))
+        {
+            if (type == Frame::submit)
+            {
+                Reader fields(payload);
+                Request request{0, client, {}, {}};
+
+                for(std::uint64_t count = fields.number(4); fields.ok() and count != 0; --count)
+                    request.args.push_back(fields.text());
+
+                request.hashes = fields.text();
+
+                if (not fields.ok())
+                {
+                    client->send(Frame::error, Payload().put(1, 4).put("malformed job request").data());
+                    continue;
+                }
+
+                //Queued and acknowledged under the lock, so the accepted frame always comes before the job's first crack. A job with the
+                //options of the running batch joins it: the current pass is stopped so that the next one already tests its hashes.
+                std::lock_guard<std::mutex> guard(lock);
+                request.id = next_id++;
+
+                if (not running.empty() and request.args == running_args)
+                {
+                    client->send(Frame::accepted, Payload().put(request.id).put(0).data());
+                    joining.push_back(std::move(request));
+                    session.stop();
+                }
+                else
+                {
+                    client->send(Frame::accepted, Payload().put(request.id).put(queue.size() + not running.empty()).data());
+                    queue.push_back(std::move(request));
+                    wake.notify_all();
+                }
+            }
+            else if (type == Frame::status)
+                client->send(Frame::report, report());
+            else if (type == Frame::shutdown)
+            {
+                closing = true;
+                session.stop();
+                wake.notify_all();
+            }
+            else
+                client->send(Frame::error, Payload().put(1, 4).put("unknown request").data());
+        }
+
+        //Hung up: its running job stops (unless other jobs of the batch still need the pass), its queued jobs are skipped
+        client->open = false;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            bool member = false, needed = false;
+
+            for(const auto& [id, owner] : running)
+            {
+                member = member or (owner == client);
+                needed = needed or owner->open;
+            }
+
+            if (member and not needed)
+                session.stop();
+        }
+
+        client->finished = true;
+    }
+
+    //Run a batch of jobs with the same options and stream the results of each to its client. Every pass runs the job over the ranges that
+    //the first unfinished member still needs, against the hashes of all the members; a job that joins while a pass runs is admitted after
+    //it and owes the whole attack, so it gets the rest of the pass through the next passes and the part it missed in a catch-up pass.
+    inline void Server::run_batch(std::vector<Request>& requests)
+    {
+        cracker::Job job;
+        std::list<Member> members;                                           //Stable addresses for 'owners'
+        std::unordered_map<std::string, std::vector<Member*>> owners;       //Hash -> members that submitted it
+        std::optional<std::vector<cracker::Range>> full;                   //Every range of the attack (known once a pass started it)
+
+        auto fail = [](const Request& request, int status, const std::string& message)
+                    {
+                        request.client->send(Frame::error, Payload().put(status, 4).put(message).data());
+                        std::clog << "Job " << request.id << ": " << message << '\n';
+                    };
+
+        auto cracked = [this](const Member& member)
+                       {
+                           std::uint64_t count = 0;
+                           for(const std::string& key : member.keys)
+                               count += session.results().at(key).has_value();
+                           return count;
+                       };
+
+        auto finish = [&](Member& member, bool finished)
+                      {
+                          const std::uint64_t hits = cracked(member);
+                          member.done = true;
+                          member.request.client->send(Frame::done, Payload().put(finished, 1).put(hits).put(member.keys.size())
+                                                                            .put(member.tested).data());
+
+                          std::clog << "Job " << member.request.id << ": cracked " << hits << " of " << member.keys.size() << " targets with "
+                                    << member.tested << " candidates" << (finished ? "" : " (stopped)") << '\n';
+                      };
+
+        //Load the hashes of a job and report the ones that are already known (potfile hits, or cracked by an earlier pass of the batch)
+        auto admit = [&](Request&& request, std::optional<std::vector<cracker::Range>> owed)
+                     {
+                         std::istringstream hash_list(request.hashes);
+                         Member& member = members.emplace_back();
+                         member.request = std::move(request);
+                         member.owed = std::move(owed);
+
+                         session.load(hash_list, &member.keys);
+                         std::sort(member.keys.begin(), member.keys.end());
+                         member.keys.erase(std::unique(member.keys.begin(), member.keys.end()), member.keys.end());
+
+                         for(const std::string& key : member.keys)
+                         {
+                             owners[key].push_back(&member);
+
+                             if (const std::optional<std::string>& password = session.results().at(key))
+                                 member.request.client->send(Frame::crack, Payload().put(key).put(*password).data());
+                         }
+                     };
+
+        //The targets of the last batch are dropped (with a stop() that was meant for it)
+        session.clear();
+
+        try
+        {
+            job = factory(requests.front().args, session.potfile());
+        }
+        catch (const cracker::SessionError& error)
+        {
+            for(const Request& request : requests)
+                fail(request, error.status(), error.what());
+
+            std::lock_guard<std::mutex> guard(lock);
+            served += requests.size();
+            return;
+        }
+
+        for(Request& request : requests)
+            admit(std::move(request), std::nullopt);
+
+        if (requests.size() > 1)
+            std::clog << "Batch of " << requests.size() << " jobs\n";
+
+        //Cracks go to every job that owns the hash ('owners' only changes between passes)
+        session.on_crack([&owners](const cracker::Crack& crack)
+                         {
+                             auto itr = owners.find(crack.hash);
+
+                             if (itr != owners.end())
+                                 for(Member* member : itr->second)
+                                     member->request.client->send(Frame::crack, Payload().put(crack.hash).put(crack.password).data());
+                         });
+
+        //A pass that covered nothing and admitted nobody is retried once (a join may have stopped it just as it began), not forever
+        for(unsigned idle = 0; idle < 2;)
+        {
+            auto active = [](const Member& member) { return not member.done and member.request.client->open; };
+            auto lead = std::find_if(members.begin(), members.end(), active);
+
+            if (lead == members.end())
+                break;
+
+            //The first unfinished member decides what the pass covers: the others need at least as much of it
+            const bool whole = not lead->owed.has_value();
+            job.ranges = lead->owed.value_or(std::vector<cracker::Range>());
+            bool finished = false;
+
+            try
+            {
+                finished = session.run(job);
+            }
+            catch (const cracker::SessionError& error)
+            {
+                for(Member& member : members)
+                {
+                    if (active(member))
+                        fail(member.request, error.status(), error.what());
+
+                    member.done = true;
+                }
+
+                break;
+            }
+
+            const cracker::Report& report = session.last_report();
+            const std::uint64_t tested = session.status().tested;
+
+            if (whole and not full and not report.work.empty())
+                full = report.work;
+
+            //What this pass tested of the attack (everything if a whole pass finished)
+            const bool everything = (whole and finished);
+            std::vector<cracker::Range> covered;
+
+            if (not everything and (not whole or full))
+                covered = cracker::subtract(whole ? *full : job.ranges, report.left);
+
+            for(Member& member : members)
+            {
+                if (not active(member))
+                    continue;
+
+                member.tested += tested;
+
+                if (everything)
+                    member.owed.emplace();
+                else if (member.owed or full)
+                    member.owed = cracker::subtract(member.owed ? *member.owed : *full, covered);
+
+                if ((member.owed and member.owed->empty()) or cracked(member) == member.keys.size())
+                    finish(member, true);
+            }
+
+            if (stopping())
+                break;
+
+            //Admit the jobs that joined during the pass
+            std::deque<Request> joined;
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                joined.swap(joining);
+
+                for(const Request& request : joined)
+                    running.emplace_back(request.id, request.client);
+            }
+
+            for(Request& request : joined)
+            {
+                std::clog << "Job " << request.id << " joins the batch\n";
+                admit(std::move(request), full);
+            }
+
+            idle = (everything or not covered.empty() or not joined.empty() ? 0 : idle + 1);
+        }
+
+        session.on_crack(nullptr);
+
+        //Stopped (shutdown, or the batch made no progress): the jobs that are left end unfinished
+        for(Member& member : members)
+            if (not member.done and member.request.client->open)
+                finish(member, false);
+
+        std::lock_guard<std::mutex> guard(lock);
+        served += members.size();
+    }
+
+    //Describe the daemon for a status request ('key value' lines)
+    [[nodiscard]] inline std::string Server::report()
+    {
+        const cracker::Status status = session.status();
+        std::ostringstream text;
+        std::lock_guard<std::mutex> guard(lock);
+
+        text << "jobs_served " << served << '\n'
+             << "jobs_queued " << queue.size() << '\n'
+             << "running_jobs";
+
+        for(const auto& [id, client] : running)
+            text << ' ' << id;
+
+        text << (running.empty() ? " none\n" : "\n")
+             << "tested " << status.tested << '\n'
+             << "total " << status.total << '\n'
+             << "cracked " << status.cracked << '\n'
+             << "targets " << status.targets << '\n'
+             << "hashes_per_second " << static_cast<std::uint64_t>(status.hashes_per_second) << '\n';
+
+        return text.str();
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Serve jobs until a client sends a shutdown request or the process gets SIGINT/SIGTERM (a running job is stopped, not finished)
+    inline void Server::serve()
+    {
+        std::thread acceptor([this]() { accept_clients(); });
+        std::clog << "Daemon listening on \"" << path << "\"\n";
+
+        while (true)
+        {
+            std::vector<Request> batch;
+
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait_for(guard, std::chrono::milliseconds(200), [this]() { return stopping() or not queue.empty(); });
+
+                if (stopping())
+                    break;
+
+                //The next job, with every queued job that has the same options (jobs of clients that hung up are skipped)
+                for(auto itr = queue.begin(); itr != queue.end();)
+                {
+                    if (itr->client->open and (batch.empty() or itr->args == batch.front().args))
+                    {
+                        running.emplace_back(itr->id, itr->client);
+                        batch.push_back(std::move(*itr));
+                    }
+                    else if (itr->client->open)
+                    {
+                        ++itr;
+                        continue;
+                    }
+
+                    itr = queue.erase(itr);
+                }
+
+                if (batch.empty())
+                    continue;
+
+                running_args = batch.front().args;
+            }
+
+            run_batch(batch);
+
+            //Jobs that joined as the batch ended run next
+            std::lock_guard<std::mutex> guard(lock);
+            running.clear();
+            queue.insert(queue.begin(), std::make_move_iterator(joining.begin()), std::make_move_iterator(joining.end()));
+            joining.clear();
+        }
+
+        closing = true;
+        acceptor.join();
+
+        //Unblock the connection threads and wait for them
+        for(auto& [thread, client] : clients)
+        {
+            ::shutdown(client->fd, SHUT_RDWR);
+            thread.join();
+        }
+
+        clients.clear();
+        std::clog << "Daemon stopped after " << served << " jobs\n";
+    }
+}
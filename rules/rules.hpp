@@ -0,0 +1,302 @@
+#pragma once
+
+//Native C++ Libraries
+#include <string>                //Words and rule lines
+#include <string_view>          //Parsing rules, applying them without copying the word
+#include <vector>              //Compiled operations, rule sets
+#include <fstream>            //Rule files
+#include <algorithm>         //std::reverse, std::rotate, std::swap
+#include <stdexcept>        //std::invalid_argument, std::runtime_error
+#include <cctype>          //std::tolower, std::toupper
+
+namespace rules
+{
+    //Longest word a rule may produce (longer results are rejected, so 'd'/'p' chains cannot blow up)
+    constexpr std::size_t max_length = 256;
+
+    //One compiled rule function: its letter and up to two (already decoded) arguments
+    struct Op
+    {
+        char code;
+        unsigned char a = 0;
+        unsigned char b = 0;
+    };
+
+    //Class 'Rule' is one line of a rule file (hashcat/John syntax), compiled once into a list of operations and then applied to
+    //every dictionary word. Supported functions:
+    //  :  noop             l  lowercase          u  uppercase           c  capitalize          C  invert capitalize
+    //  t  toggle case      TN toggle at N        r  reverse             d  duplicate           pN append N copies
+    //  f  reflect          {  rotate left        }  rotate right        $X append X            ^X prepend X
+    //  [  delete first     ]  delete last        DN delete at N         xNM extract M from N   ONM omit M from N
+    //  iNX insert X at N   oNX overwrite at N    'N truncate at N       sXY replace X with Y   @X purge X
+    //  zN duplicate first N times                ZN duplicate last N times                     q  duplicate every character
+    //  k  swap first two   K  swap last two      *NM swap N and M
+    //  <N reject if longer than N               >N reject if shorter than N                    _N reject unless length is N
+    //  !X reject if it contains X               /X reject unless it contains X
+    //Positions and counts N/M are 0-9 then A-Z (10-35). Spaces between functions are ignored.
+    class Rule final
+    {
+        private:
+            std::vector<Op> ops;      //Compiled functions, applied in order
+            std::string text;        //The rule as written
+
+        public:
+            //Special methods
+            explicit Rule(std::string_view);
+
+            //General methods
+            bool apply(std::string_view, std::string&) const;
+            [[nodiscard]] const std::string& str() const noexcept;
+    };
+
+    //Class 'RuleSet' is the list of rules loaded from one or more rule files
+    class RuleSet final
+    {
+        private:
+            std::vector<Rule> rules;
+
+        public:
+            //General methods
+            void load(const std::string&);
+            void add(std::string_view);
+            [[nodiscard]] std::size_t size() const noexcept;
+            [[nodiscard]] bool empty() const noexcept;
+            [[nodiscard]] const Rule& operator[](std::size_t) const noexcept;
+            [[nodiscard]] std::vector<Rule>::const_iterator begin() const noexcept;
+            [[nodiscard]] std::vector<Rule>::const_iterator end() const noexcept;
+    };
+
+
+    // ***** HELPERS ***** //
+
+    namespace detail
+    {
+        //Decode a position/count argument (0-9, A-Z) -- CAN THROW std::invalid_argument
+        inline unsigned char position(char c)
+        {
+            if (c >= '0' and c <= '9')
+                return static_cast<unsigned char>(c - '0');
+            if (c >= 'A' and c <= 'Z')
+                return static_cast<unsigned char>(c - 'A' + 10);
+
+            throw std::invalid_argument(std::string("invalid position '") + c + "'");
+        }
+
+        //Number of arguments of a function and whether each of them is a position (true) or a character (false)
+        inline int arguments(char code, bool& first_is_position, bool& second_is_position)
+        {
+            first_is_position = second_is_position = true;
+
+            switch (code)
+            {
+                case ':': case 'l': case 'u': case 'c': case 'C': case 't': case 'r': case 'd': case 'f':
+                case '{': case '}': case '[': case ']': case 'q': case 'k': case 'K':
+                    return 0;
+
+                case 'T': case 'p': case 'D': case '\'': case 'z': case 'Z': case '<': case '>': case '_':
+                    return 1;
+
+                case '$': case '^': case '@': case '!': case '/':
+                    first_is_position = false;
+                    return 1;
+
+                case 'x': case 'O': case '*':
+                    return 2;
+
+                case 'i': case 'o':
+                    second_is_position = false;
+                    return 2;
+
+                case 's':
+                    first_is_position = second_is_position = false;
+                    return 2;
+
+                default:
+                    return -1;
+            }
+        }
+
+        inline char lower(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+        inline char upper(char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); }
+        inline char toggle(char c) { return (std::islower(static_cast<unsigned char>(c)) ? upper(c) : lower(c)); }
+    }
+
+
+    // ***** SPECIAL METHODS ***** //
+
+    //Constructor: compile a rule -- CAN THROW std::invalid_argument (unknown function, missing or bad argument)
+    inline Rule::Rule(std::string_view rule) : text(rule)
+    {
+        for(std::size_t i=0; i < rule.size();)
+        {
+            char code = rule[i++];
+
+            if (code == ' ' or code == '\t')
+                continue;
+
+            bool first_is_position, second_is_position;
+            int count = detail::arguments(code, first_is_position, second_is_position);
+
+            if (count < 0)
+                throw std::invalid_argument(std::string("unknown rule function '") + code + "'");
+            if (rule.size() - i < static_cast<std::size_t>(count))
+                throw std::invalid_argument(std::string("missing argument of rule function '") + code + "'");
+
+            Op op{code};
+
+            if (count >= 1)
+                op.a = (first_is_position ? detail::position(rule[i]) : static_cast<unsigned char>(rule[i]));
+            if (count >= 2)
+                op.b = (second_is_position ? detail::position(rule[i + 1]) : static_cast<unsigned char>(rule[i + 1]));
+
+            i += count;
+            ops.push_back(op);
+        }
+    }
+
+
+    // ***** GENERAL METHODS ***** //
+
+    //Apply the rule to a word, writing the result into 'out' -- returns false if the word is rejected
+    inline bool Rule::apply(std::string_view word, std::string& out) const
+    {
+        out.assign(word);
+
+        for(const Op& op : ops)
+        {
+            const std::size_t n = out.size();
+
+            switch (op.code)
+            {
+                case ':': break;
+                case 'l': for(char& c : out) c = detail::lower(c); break;
+                case 'u': for(char& c : out) c = detail::upper(c); break;
+                case 't': for(char& c : out) c = detail::toggle(c); break;
+
+                case 'c':
+                    for(char& c : out) c = detail::lower(c);
+                    if (n > 0) out[0] = detail::upper(out[0]);
+                    break;
+
+                case 'C':
+                    for(char& c : out) c = detail::upper(c);
+                    if (n > 0) out[0] = detail::lower(out[0]);
+                    break;
+
+                case 'T': if (op.a < n) out[op.a] = detail::toggle(out[op.a]); break;
+                case 'r': std::reverse(out.begin(), out.end()); break;
+                case 'd': out.append(out, 0, n); break;
+                case 'p': for(unsigned i=0; i < op.a and out.size() <= max_length; ++i) out.append(out, 0, n); break;
+                case 'f': out += std::string(out.rbegin(), out.rend()); break;
+                case '{': if (n > 1) std::rotate(out.begin(), out.begin() + 1, out.end()); break;
+                case '}': if (n > 1) std::rotate(out.rbegin(), out.rbegin() + 1, out.rend()); break;
+                case '$': out += static_cast<char>(op.a); break;
+                case '^': out.insert(out.begin(), static_cast<char>(op.a)); break;
+                case '[': if (n > 0) out.erase(0, 1); break;
+                case ']': if (n > 0) out.pop_back(); break;
+                case 'D': if (op.a < n) out.erase(op.a, 1); break;
+                case 'x': out = (op.a < n ? out.substr(op.a, op.b) : std::string()); break;
+                case 'O': if (op.a < n) out.erase(op.a, op.b); break;
+                case 'i': if (op.a <= n) out.insert(out.begin() + op.a, static_cast<char>(op.b)); break;
+                case 'o': if (op.a < n) out[op.a] = static_cast<char>(op.b); break;
+                case '\'': if (op.a < n) out.resize(op.a); break;
+                case 's': std::replace(out.begin(), out.end(), static_cast<char>(op.a), static_cast<char>(op.b)); break;
+                case '@': out.erase(std::remove(out.begin(), out.end(), static_cast<char>(op.a)), out.end()); break;
+                case 'z': if (n > 0) out.insert(0, op.a, out[0]); break;
+                case 'Z': if (n > 0) out.append(op.a, out[n - 1]); break;
+                case 'k': if (n > 1) std::swap(out[0], out[1]); break;
+                case 'K': if (n > 1) std::swap(out[n - 1], out[n - 2]); break;
+                case '*': if (op.a < n and op.b < n) std::swap(out[op.a], out[op.b]); break;
+
+                case 'q':
+                    out.resize(2 * n);
+                    for(std::size_t i=n; i-- > 0;)
+                        out[2*i] = out[2*i + 1] = out[i];
+                    break;
+
+                case '<': if (n > op.a) return false; break;
+                case '>': if (n < op.a) return false; break;
+                case '_': if (n != op.a) return false; break;
+                case '!': if (out.find(static_cast<char>(op.a)) != std::string::npos) return false; break;
+                case '/': if (out.find(static_cast<char>(op.a)) == std::string::npos) return false; break;
+            }
+
+            if (out.size() > max_length)
+                return false;
+        }
+
+        return true;
+    }
+
+    //Return the rule as written
+    [[nodiscard]] inline const std::string& Rule::str() const noexcept
+    {
+        return text;
+    }
+
+    //Load every rule of a rule file (blank lines and '#' comments are skipped) -- CAN THROW std::runtime_error
+    inline void RuleSet::load(const std::string& filename)
+    {
+        std::ifstream file(filename);
+        std::string line;
+        std::size_t number = 0;
+
+        if (not file.good())
+            throw std::runtime_error("the rule file \"" + filename + "\" could not be found");
+
+        while (std::getline(file, line))
+        {
+            ++number;
+
+            if (not line.empty() and line.back() == '\r')
+                line.pop_back();
+
+            if (line.empty() or line[0] == '#')
+                continue;
+
+            try
+            {
+                add(line);
+            }
+            catch (const std::invalid_argument& error)
+            {
+                throw std::runtime_error(filename + ":" + std::to_string(number) + ": " + error.what());
+            }
+        }
+    }
+
+    //Add a single rule -- CAN THROW std::invalid_argument
+    inline void RuleSet::add(std::string_view rule)
+    {
+        rules.emplace_back(rule);
+    }
+
+    //Return the number of rules
+    [[nodiscard]] inline std::size_t RuleSet::size() const noexcept
+    {
+        return rules.size();
+    }
+
+    //Return whether no rules were loaded (words are then tested as written)
+    [[nodiscard]] inline bool RuleSet::empty() const noexcept
+    {
+        return rules.empty();
+    }
+
+    //Return a rule
+    [[nodiscard]] inline const Rule& RuleSet::operator[](std::size_t i) const noexcept
+    {
+        return rules[i];
+    }
+
+    //Iterate over the rules
+    [[nodiscard]] inline std::vector<Rule>::const_iterator RuleSet::begin() const noexcept
+    {
+        return rules.begin();
+    }
+
+    [[nodiscard]] inline std::vector<Rule>::const_iterator RuleSet::end() const noexcept
+    {
+        return rules.end();
+    }
+}
@@ -0,0 +1,42 @@
+/*
+    Conformance test of every MD5 kernel of the password cracker against the RFC 1321 test vectors and hashlib++'s hl_md5.cpp
+    C++ Version: C++17
+
+    Compilation Instructions:
+        > Linux:   g++ -std=c++17 -O2 -pthread tests/selftest.cpp ./hashlib++_md5/hl_*.cpp -o selftest
+        (from the repository root; see the README for the one-line command that builds it together with the cracker)
+
+    Usage: ./selftest
+
+    Description: runs cracker::SelfTest (hashlib, the scalar kernel, Batch<4/8/16> through every way of queueing candidates and the
+    brute-force lanes), prints one line per kernel and exits with status code 1 if any kernel differs from the reference in any case.
+    Failed candidates are printed to std::clog as they are found. './cracker --selftest' runs the same checks.
+*/
+
+//Native C libraries
+#include <cstdlib>      //EXIT_SUCCESS, EXIT_FAILURE
+
+//Native C++ Libraries
+#include <iostream>     //Result table, failed candidates
+
+//Custom Libraries
+#include "../cracker/selftest.hpp"
+
+
+// DRIVER CODE //
+int main()
+{
+    cracker::SelfTest selftest(std::clog);
+    bool passed = selftest.run();
+
+    selftest.print(std::cout);
+
+    if (not passed)
+    {
+        std::cout << "FAILED: some kernels disagree with the reference MD5\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "All kernels match the reference\n";
+    return EXIT_SUCCESS;
+}